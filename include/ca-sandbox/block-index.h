@@ -0,0 +1,79 @@
+#ifndef BLOCK_INDEX_H_DEF
+#define BLOCK_INDEX_H_DEF
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/my-array.h"
+
+/// @file
+/// @brief  A 2D bucket index of CellBlock positions, for range queries which don't visit every
+///           CellBlock in the hashmap.
+///
+
+
+struct CellBlock;
+
+
+/// The number of CellBlock%s along each side of a bucket, so a bucket's occupancy fits in a u64
+const u32 BLOCK_INDEX_BUCKET_DIM = 8;
+
+const u32 BLOCK_INDEX_HASHMAP_SIZE = 256;
+
+
+/// A BLOCK_INDEX_BUCKET_DIM square of CellBlock positions
+struct BlockIndexBucket
+{
+  /// bucket_position * BLOCK_INDEX_BUCKET_DIM is the position of the first CellBlock in the bucket
+  s32vec2 bucket_position;
+
+  /// Bit (y * BLOCK_INDEX_BUCKET_DIM) + x is set if the CellBlock at (x, y) in the bucket exists
+  u64 occupied;
+
+  /// The number of CellBlock%s in the bucket, the number of bits set in occupied
+  u32 n_cell_blocks;
+
+  /// Position of this bucket in BlockIndex.buckets
+  u32 bucket_n;
+
+  CellBlock *cell_blocks[BLOCK_INDEX_BUCKET_DIM * BLOCK_INDEX_BUCKET_DIM];
+
+  /// The next bucket in this slot of the BlockIndex hashmap
+  BlockIndexBucket *next_bucket;
+};
+
+
+/// Index of the CellBlock%s in a CellBlocks, kept up to date as blocks are created and deleted.
+///
+/// Queries look up the buckets overlapping the range, or scan the list of buckets if there are
+///   fewer of those, so they cost at most the number of occupied buckets rather than the number of
+///   CellBlock%s.
+struct BlockIndex
+{
+  BlockIndexBucket *hashmap[BLOCK_INDEX_HASHMAP_SIZE];
+
+  /// Every bucket containing at least one CellBlock
+  Array::Array<BlockIndexBucket *> buckets;
+};
+
+
+void
+add_to_block_index(BlockIndex *block_index, CellBlock *cell_block);
+
+
+void
+remove_from_block_index(BlockIndex *block_index, s32vec2 cell_block_position);
+
+
+void
+get_cell_blocks_in_range(BlockIndex *block_index, s32vec2 start_block, s32vec2 end_block, Array::Array<CellBlock *>& result);
+
+
+b32
+get_block_index_bounds(BlockIndex *block_index, s32vec2 *lowest_block, s32vec2 *highest_block);
+
+
+void
+destroy_block_index(BlockIndex *block_index);
+
+
+#endif
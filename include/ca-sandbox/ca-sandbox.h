@@ -8,11 +8,16 @@
 #include "engine/opengl-general-buffers.h"
 
 #include "ca-sandbox/cell-drawing.h"
+#include "ca-sandbox/cell-texture-drawing.h"
+#include "ca-sandbox/cell-lod.h"
+#include "ca-sandbox/minimap.h"
 #include "ca-sandbox/view-panning.h"
 #include "ca-sandbox/cell-regions.h"
 #include "ca-sandbox/cell-tools.h"
 #include "ca-sandbox/screen-shader.h"
 #include "ca-sandbox/files-loaded-state.h"
+#include "ca-sandbox/checkpoint.h"
+#include "ca-sandbox/file-loading-thread.h"
 
 #include "ca-sandbox/ui/simulate-options-ui.h"
 #include "ca-sandbox/ui/simulation-ui.h"
@@ -20,6 +25,7 @@
 #include "ca-sandbox/ui/rule-ui.h"
 #include "ca-sandbox/ui/cell-regions-ui.h"
 #include "ca-sandbox/ui/cell-selections-ui.h"
+#include "ca-sandbox/ui/profiler-ui.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_internal.h"
@@ -51,6 +57,9 @@ struct CA_SandboxState
   GeneralIndexBuffer general_index_buffer;
 
   CellInstancing cell_instancing;
+  CellInstanceCache cell_instance_cache;
+  CellTextureDrawing cell_texture_drawing;
+  CellLOD cell_lod;
   CellDrawing cell_drawing;
 
   GLuint texture_shader_program;
@@ -58,6 +67,7 @@ struct CA_SandboxState
   GLuint minimap_framebuffer;
   GLuint minimap_texture;
   s32vec2 minimap_texture_size;
+  MinimapCache minimap_cache;
 
   ScreenShader screen_shader;
 
@@ -67,13 +77,19 @@ struct CA_SandboxState
   SimulateOptions simulate_options;
   CellInitialisationOptions cell_initialisation_options;
 
+  CheckpointWriter checkpoint_writer;
+
   Rule loaded_rule;
   RuleCreationThread rule_creation_thread;
 
+  FileLoadingThread rule_loading_thread;
+  FileLoadingThread cells_loading_thread;
+
   CellSelectionsUI cell_selections_ui;
   SimulationUI simulation_ui;
   UniverseUI universe_ui;
   RuleUI rule_ui;
+  ProfilerUI profiler_ui;
   CellsEditor cells_editor;
 
   CellRegions cell_regions;
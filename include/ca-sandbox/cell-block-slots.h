@@ -0,0 +1,76 @@
+#ifndef CELL_BLOCK_SLOTS_H_DEF
+#define CELL_BLOCK_SLOTS_H_DEF
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/my-array.h"
+
+#include "ca-sandbox/cell.h"
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/border.h"
+
+/// @file
+/// @brief  Tracks which visible CellBlock%s have a slot in a renderer's GPU storage, and which
+///           slots need re-uploading.
+///
+
+
+/// A visible CellBlock's slot
+struct CellBlockSlot
+{
+  CellBlock *cell_block;
+
+  /// Cleared at the start of each update, slots which aren't visible afterwards are freed
+  b32 visible;
+
+  /// The slot was added this update, so has nothing stored yet
+  b32 new_slot;
+};
+
+
+/// Moving a slot's data from one slot to another, to fill the gap left by a freed slot
+struct CellBlockSlotMove
+{
+  u32 from_slot_n;
+  u32 to_slot_n;
+};
+
+
+/// @brief The slots for the CellBlock%s visible in a view, kept between frames.
+///
+/// Slots are kept contiguous, so a renderer can draw all of them at once.  After each
+///   update_cell_block_slots() the renderer applies the moves, in order, to its stored slot data,
+///   then uploads the slots_to_upload.  A slot is only uploaded when it is new, or its block's
+///   cell_states differ from the copy taken at its last upload.
+///
+/// CellBlock::drawing_slot is a hint from the last CellBlockSlots to give the block a slot, it is
+///   checked against the slot before it is used.
+struct CellBlockSlots
+{
+  /// Changing either of these uploads every slot
+  u32 cell_block_dim;
+  Border border;
+
+  Array::Array<CellBlockSlot> slots;
+
+  /// The cell_states each slot was last uploaded with, cell_block_dim^2 per slot
+  Array::Array<CellState> uploaded_states;
+
+  Array::Array<CellBlockSlotMove> moves;
+  Array::Array<u32> slots_to_upload;
+};
+
+
+b32
+borders_equal(Border a, Border b);
+
+
+void
+update_cell_block_slots(CellBlockSlots *cell_block_slots, Universe *universe, Border border, s32vec2 start_block, s32vec2 end_block);
+
+
+void
+upload_all_cell_block_slots(CellBlockSlots *cell_block_slots);
+
+
+#endif
@@ -16,6 +16,8 @@
 ///   - ie.: block_pos = cell.pos / block_size
 /// - On simulation, each cell block is simulated as a whole
 /// - To iterate over all CellBlock%s / Cell%s just loop through the hashmap.
+/// - To find the CellBlock%s in a range of block positions, use get_cell_blocks_in_range() on the
+///     block_index.
 /// - Possible optimisation: CellBlocks store pointers to neighbours for quick access to border cell
 ///     states.
 ///
@@ -34,6 +36,18 @@ struct CellBlock
   /// Used by simulation.cpp to ensure the block is only simulated once per frame.
   u64 last_simulated_on_frame;
 
+  /// Used by checkpoint.cpp to find the blocks changed since the last checkpoint.  Hash of
+  ///   cell_states at the last checkpoint, or 0 if the block hasn't been checkpointed.
+  u64 checkpoint_hash;
+
+  /// Used by minimap.cpp to find the blocks changed since they were drawn to the minimap.  Hash of
+  ///   cell_states when the block was last drawn, or 0 if the block hasn't been drawn.
+  u64 minimap_hash;
+
+  /// Used by cell-block-slots.cpp to find the block's slot in the CellBlockSlots of the main view's
+  ///   renderer.  The slot + 1, or 0 if the block hasn't been given a slot.
+  u32 drawing_slot;
+
   /// The position of the block relative to the origin of the CA, in block space.
   s32vec2 block_position;
 
@@ -49,6 +63,10 @@ struct CellBlock
 };
 
 
+struct DenseGrid;
+struct BlockIndex;
+
+
 /// The initial length of the Universe hashmap.
 
 /// This is the number of CellBlock%s which can fit in the Universe with zero conflicts.
@@ -70,6 +88,24 @@ struct CellBlocks
 
   /// Currently only used for diagnostics
   u32 n_cell_blocks_in_use;
+
+  /// Different every time init_cell_hashmap() is called, so caches can tell a loaded or swapped
+  ///   Universe from the one they were built from, even if it is at the same address.
+  u64 generation;
+
+  /// Dense copy of the cells inside a TORUS or FIXED border used by simulate_cells(), allocated on
+  ///   first use.
+  DenseGrid *dense_grid;
+
+  /// Scratch tile of a CellBlock and its halo used by simulate_cells(), allocated on first use and
+  ///   grown when the cell_block_dim or the Neighbourhood reach needs a bigger tile.
+  CellState *halo_tile;
+
+  /// The number of CellState%s which fit in halo_tile.
+  u32 halo_tile_size;
+
+  /// Index of the CellBlock positions, for range queries without iterating the whole hashmap
+  BlockIndex *block_index;
 };
 
 
@@ -117,4 +153,8 @@ u32
 get_cell_index_in_block(CellBlocks *cell_blocks, s32vec2 cell_coord);
 
 
+u64
+hash_cell_block_states(CellState *cell_states, u32 n_cells);
+
+
 #endif
\ No newline at end of file
@@ -4,8 +4,10 @@
 #include "ca-sandbox/cell-blocks.h"
 #include "ca-sandbox/cells-editor.h"
 #include "ca-sandbox/border.h"
+#include "ca-sandbox/cell-block-slots.h"
 
 #include "engine/vectors.h"
+#include "engine/my-array.h"
 #include "engine/opengl-buffer.h"
 #include "engine/drawing.h"
 
@@ -19,14 +21,39 @@
 /// The cell vertices and indices are stored in the `general_buffer`, which is maintained in the
 ///   main() function.
 ///
+/// Cells coloured by their state are uploaded as 8 byte CompactCellInstance%s, a quarter of the size
+///   of a CellInstance, which cell-compact-instancing.glvs expands using a table of block positions
+///   and a palette of the state colours.  CellInstance%s are for cells of any colour, like the
+///   CellLOD's summaries, and for CellBlock%s larger than MAX_COMPACT_CELL_BLOCK_DIM.
+///
+
+
+/// CompactCellInstance::cell_n_and_state holds the cell's index in its block in the low
+///   COMPACT_CELL_N_BITS, enough for a cell_block_dim of 1024, and the palette index above them.
+const u32 COMPACT_CELL_N_BITS = 20;
+
+/// The palette index of cells outside the border, which cell-compact-instancing.glvs hides
+const u32 COMPACT_CELL_HIDDEN_STATE = (1 << (32 - COMPACT_CELL_N_BITS)) - 1;
+
+/// The largest cell_block_dim whose cell indices fit in COMPACT_CELL_N_BITS, larger CellBlock%s are
+///   drawn with CellInstance%s, see update_cell_instancing_format().
+const u32 MAX_COMPACT_CELL_BLOCK_DIM = 1 << (COMPACT_CELL_N_BITS / 2);
 
 
 /// Holds the OpenGL identifiers for cell drawing
 struct CellInstancing
 {
-  /// The buffer where the CellInstances are uploaded
+  /// The buffer where the CellInstances, or CompactCellInstances if compact, are uploaded
   OpenGL_Buffer buffer;
 
+  /// @brief CompactCellInstance::block_n indexes block_positions, an s32vec2 per block, read by
+  ///          cell-compact-instancing.glvs through the block_positions_texture buffer texture.
+  ///
+  /// block_positions is unused whilst buffer holds CellInstances.
+  b32 compact;
+  OpenGL_Buffer block_positions;
+  GLuint block_positions_texture;
+
   /// The position of the cell vertices within the general buffer
   u32 cell_general_vertices_position;
   u32 cell_n_vertices;  ///< Number of vertices stored in the general buffer
@@ -53,6 +80,35 @@ struct CellInstance
 };
 
 
+/// @brief The compact form of a CellInstance for a cell coloured by its state, 8 bytes instead of 32.
+struct CompactCellInstance
+{
+  /// Index into CellInstancing::block_positions
+  u32 block_n;
+
+  /// The cell's index in the block, (y * cell_block_dim) + x, and its state's index in the
+  ///   get_state_colour() palette, see COMPACT_CELL_N_BITS.
+  u32 cell_n_and_state;
+};
+
+
+/// @brief The CompactCellInstances, or CellInstances for large CellBlock%s, for the CellBlock%s
+///          visible in the main view, kept between frames.
+///
+/// Each visible CellBlock has a slot of cell_block_dim^2 instances in the buffer, with block_n the
+///   slot number, which is only re-uploaded when the block's cell_states change.  Cells outside the
+///   border are uploaded hidden, see write_cell_instance().
+///
+/// Slots are kept contiguous, so all of them are drawn with one instanced draw call.
+struct CellInstanceCache
+{
+  /// Shares the cell vertices with the main CellInstancing, with its own instance buffer
+  CellInstancing instancing;
+
+  CellBlockSlots slots;
+};
+
+
 struct CellDrawing
 {
   GLuint vao;
@@ -60,6 +116,18 @@ struct CellDrawing
   GLuint mat4_projection_matrix_uniform;
   GLuint cell_block_dim_uniform;
   GLuint cell_width_uniform;
+
+  /// For drawing CompactCellInstances
+  GLuint compact_vao;
+  GLuint compact_shader_program;
+  GLuint compact_projection_matrix_uniform;
+  GLuint compact_cell_block_dim_uniform;
+  GLuint compact_first_block_uniform;
+  GLuint compact_block_positions_uniform;
+  GLuint compact_palette_uniform;
+
+  /// A row of get_n_state_colours() colours
+  GLuint palette_texture;
 };
 
 
@@ -78,18 +146,67 @@ void
 init_cell_drawing(CellDrawing *cell_drawing, CellInstancing *cell_instancing, OpenGL_Buffer *general_vertex_buffer, OpenGL_Buffer *general_index_buffer);
 
 
+GLuint
+create_state_palette_texture();
+
+
+void
+create_compact_cell_instance_buffers(CellInstancing *cell_instancing, b32 streaming);
+
+
+b32
+update_cell_instancing_format(CellInstancing *cell_instancing, u32 cell_block_dim);
+
+
 void
 init_cell_instances_buffer_attributes(OpenGL_Buffer *cell_instances_buffer, OpenGL_Buffer *general_vertex_buffer, GLuint cell_instance_drawing_shader_program);
 
 
+CompactCellInstance
+get_compact_cell_instance(u32 block_n, u32 cell_n, u32 palette_n);
+
+
+void
+write_cell_instance(b32 compact, void *instances, u32 instance_n, u32 block_n, s32vec2 block_position, s32vec2 cell_position, u32 cell_block_dim, u32 palette_n);
+
+
+u32
+add_cell_block_instances(b32 compact, void *instances, u32 first_instance_n, u32 block_n, CellBlock *cell_block, u32 cell_block_dim, Border border);
+
+
 void
 upload_cell_instances(Universe *universe, Border border, CellInstancing *cell_instancing);
 
 
+void
+init_cell_instance_cache(CellInstanceCache *cell_instance_cache, CellInstancing *cell_instancing);
+
+
+void
+update_cell_instance_cache(CellInstanceCache *cell_instance_cache, Universe *universe, Border border, s32vec2 start_block, s32vec2 end_block);
+
+
 void
 draw_cell_instances(CellInstancing *cell_instancing);
 
 
+void
+draw_cell_instances_scaled(CellInstancing *cell_instancing,
+                           CellDrawing *cell_drawing,
+                           OpenGL_Buffer *general_vertex_buffer,
+                           mat4x4 projection_matrix,
+                           u32 cell_block_dim,
+                           r32 cell_width);
+
+
+void
+draw_compact_cell_instances(CellInstancing *cell_instancing,
+                            CellDrawing *cell_drawing,
+                            OpenGL_Buffer *general_vertex_buffer,
+                            mat4x4 projection_matrix,
+                            u32 cell_block_dim);
+
+
 void
 draw_cell_blocks(CellBlocks *cell_blocks,
                  CellInstancing *cell_instancing,
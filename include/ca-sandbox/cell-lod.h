@@ -0,0 +1,124 @@
+#ifndef CELL_LOD_H_DEF
+#define CELL_LOD_H_DEF
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/my-array.h"
+#include "engine/drawing.h"
+
+#include "ca-sandbox/cell.h"
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/cell-drawing.h"
+#include "ca-sandbox/rule.h"
+
+/// @file
+/// @brief  A pyramid of CellBlock summaries, for drawing zoomed out views at a level of detail
+///           where each cell is smaller than a pixel.
+///
+/// Level 0 has a summary for each CellBlock, and each node in level n summarises the 2x2 nodes
+///   below it in level n-1, so covers 2^n x 2^n CellBlock%s.  Zoomed out views draw one quad for
+///   each visible node in the lowest level where nodes are at least CELL_LOD_MIN_NODE_PIXELS wide,
+///   so the number of quads depends on the screen size rather than the size of the universe.
+///
+/// CellBlock summaries are refreshed a few at a time, cycling through the Universe, and only the
+///   ancestors of summaries which changed are recomputed.
+///
+
+
+/// Level n nodes cover 2^n x 2^n CellBlock%s
+const u32 MAX_CELL_LOD_LEVELS = 24;
+
+const u32 CELL_LOD_HASHMAP_SIZE = 1024;
+
+/// The LOD is drawn when cells are narrower than this many pixels
+const r32 CELL_LOD_MAX_PIXELS_PER_CELL = 1;
+
+const r32 CELL_LOD_MIN_NODE_PIXELS = 2;
+
+/// The number of cells summarised per frame, whilst the LOD is drawn
+const u32 CELL_LOD_REFRESH_CELLS_PER_FRAME = 1 << 18;
+
+
+struct CellLODSummary
+{
+  u64 n_non_null_cells;
+
+  /// A common NULL state and a common non-NULL state in the node's cells, only meaningful if the
+  ///   node has cells of that kind.  CellBlock%s which don't exist count as NULL cells.
+  CellState null_state;
+  CellState non_null_state;
+};
+
+
+struct CellLODNode
+{
+  /// In units of 2^level CellBlock%s
+  s32vec2 position;
+
+  CellLODSummary summary;
+
+  /// Position of this node in CellLODLevel.nodes
+  u32 node_n;
+
+  /// In the level's dirty_nodes, waiting to be recomputed from its children
+  b32 dirty;
+
+  /// The next node in this slot of the level's hashmap
+  CellLODNode *next_node;
+};
+
+
+struct CellLODLevel
+{
+  CellLODNode *hashmap[CELL_LOD_HASHMAP_SIZE];
+
+  Array::Array<CellLODNode *> nodes;
+
+  /// Nodes with a child which changed
+  Array::Array<CellLODNode *> dirty_nodes;
+};
+
+
+struct CellLOD
+{
+  /// Shares the cell vertices with the main CellInstancing, with its own instance buffer
+  CellInstancing instancing;
+
+  CellLODLevel levels[MAX_CELL_LOD_LEVELS];
+
+  /// Changing any of these rebuilds the pyramid, universe_generation is the Universe::generation
+  u64 universe_generation;
+  u32 cell_block_dim;
+  Array::Array<CellState> null_states;
+
+  /// Where the round robin refresh continues from next frame, in the BlockIndex buckets and the
+  ///   level 0 nodes
+  u32 refresh_bucket_n;
+  u32 refresh_node_n;
+
+  /// The level drawn last frame, or -1 if the LOD wasn't drawn
+  s32 level_drawn;
+};
+
+
+void
+init_cell_lod(CellLOD *cell_lod, CellInstancing *cell_instancing);
+
+
+s32
+get_cell_lod_level(u32 cell_block_dim, r32 pixels_per_cell_block);
+
+
+void
+update_cell_lod(CellLOD *cell_lod, Universe *universe, RuleConfiguration *rule_configuration, s32 level);
+
+
+void
+upload_cell_lod_instances(CellLOD *cell_lod, s32 level, s32vec2 start_block, s32vec2 end_block);
+
+
+void
+destroy_cell_lod(CellLOD *cell_lod);
+
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef CELL_TEXTURE_DRAWING_H_DEF
+#define CELL_TEXTURE_DRAWING_H_DEF
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/opengl-buffer.h"
+#include "engine/drawing.h"
+
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/cell-drawing.h"
+#include "ca-sandbox/cell-block-slots.h"
+#include "ca-sandbox/border.h"
+
+#include <GL/glew.h>
+
+/// @file
+/// @brief Drawing the main view by uploading the CellStates as textures, coloured by a palette.
+///
+/// An alternative to the CellInstanceCache: each visible CellBlock's cell_states are uploaded
+///   unchanged to a slot in an integer texture atlas, 4 bytes per cell instead of an 8 byte
+///   CompactCellInstance.  Each block is drawn as one quad, and cell-texture.glfs looks up the
+///   colour of each cell's state in the create_state_palette_texture() palette.
+///
+/// Only uses OpenGL 3.3 core features, so works with software rasterisers like Mesa llvmpipe.
+///
+
+
+/// Slots per row of the atlas, fewer if the atlas would be wider than GL_MAX_TEXTURE_SIZE
+const u32 CELL_TEXTURE_ATLAS_SLOTS_PER_ROW = 64;
+
+
+struct CellTextureDrawing
+{
+  /// false if the shaders failed to compile, the CellInstanceCache should be used instead
+  b32 available;
+
+  GLuint vao;
+  GLuint shader_program;
+  GLuint projection_matrix_uniform;
+  GLuint cell_block_dim_uniform;
+  GLuint atlas_slots_per_row_uniform;
+  GLuint cell_states_atlas_uniform;
+  GLuint palette_uniform;
+
+  /// Shares the cell quad in the general buffers with the CellInstancing
+  u32 cell_general_indices_position;
+  u32 cell_n_indices;
+
+  /// GL_R32UI texture, slot n is at (n % atlas_slots_per_row, n / atlas_slots_per_row) in blocks
+  GLuint cell_states_atlas;
+  u32 atlas_cell_block_dim;
+  u32 atlas_slots_per_row;
+  u32 atlas_n_rows;
+  u32 max_texture_size;
+
+  /// A row of get_n_state_colours() colours
+  GLuint palette_texture;
+
+  /// The block_position of each slot, one per instance
+  OpenGL_Buffer block_positions_buffer;
+
+  CellBlockSlots slots;
+
+  /// The number of slots which fit in the atlas, all of them unless GL_MAX_TEXTURE_SIZE is reached
+  u32 n_slots_drawn;
+};
+
+
+b32
+init_cell_texture_drawing(CellTextureDrawing *cell_texture_drawing, CellInstancing *cell_instancing);
+
+
+void
+update_cell_texture_drawing(CellTextureDrawing *cell_texture_drawing, Universe *universe, Border border, s32vec2 start_block, s32vec2 end_block);
+
+
+void
+draw_cell_textures(CellTextureDrawing *cell_texture_drawing, OpenGL_Buffer *general_vertex_buffer, OpenGL_Buffer *general_index_buffer, mat4x4 projection_matrix);
+
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef CHECKPOINT_H_DEF
+#define CHECKPOINT_H_DEF
+
+#include "engine/types.h"
+#include "engine/my-array.h"
+
+#include "ca-sandbox/cell.h"
+#include "ca-sandbox/universe.h"
+
+#include <pthread.h>
+
+/// @file
+/// @brief  Incremental checkpointing of a Universe to an append-only delta log.
+///
+
+
+/// Checkpoint logs are binary files, made up of a header followed by a sequence of records:
+///
+///   CheckpointLogHeader
+///   (Records follow, one per checkpoint)
+///
+///   CheckpointRecordHeader
+///   n_changed_blocks x (s32vec2 block_position, CellState cell_states[cell_block_dim ^2])
+///   n_deleted_blocks x (s32vec2 block_position)
+///
+/// The first record after a log is started contains every CellBlock in the Universe, subsequent
+///   records only contain the CellBlock%s which have changed since the previous record.  The state
+///   at any checkpoint is reconstructed by replaying all the records up to and including it.
+
+
+const u32 CHECKPOINT_LOG_VERSION = 1;
+const char CHECKPOINT_LOG_MAGIC[8] = "CA-CKPT";
+const u32 CHECKPOINT_RECORD_MAGIC = 0x544b4843;
+
+
+struct CheckpointLogHeader
+{
+  char magic[8];
+  u32 version;
+  u32 cell_block_dim;
+};
+
+
+struct CheckpointRecordHeader
+{
+  u32 magic;
+  u32 n_changed_blocks;
+  u32 n_deleted_blocks;
+  u32 padding;
+  u64 simulation_step;
+};
+
+
+/// Copy of the CellBlock%s which changed since the last checkpoint, taken on the main thread so the
+///   writer thread can serialise it while the simulation continues.
+struct CheckpointSnapshot
+{
+  u64 simulation_step;
+  u32 cell_block_dim;
+
+  Array::Array<s32vec2> changed_block_positions;
+
+  /// cell_block_dim ^2 CellState%s per entry in changed_block_positions
+  Array::Array<CellState> changed_block_states;
+
+  Array::Array<s32vec2> deleted_block_positions;
+};
+
+
+struct CheckpointWriter
+{
+  char filename[1024];
+
+  /// Set once the log file header has been written, cleared to start a new log.
+  b32 log_started;
+
+  /// The Universe::generation and cell_block_dim the log was started for.  Records for any other
+  ///   Universe need a new log, as they couldn't be replayed against this one.
+  u64 universe_generation;
+  u32 cell_block_dim;
+
+  /// The positions of all the CellBlock%s in the Universe at the last checkpoint, used to find the
+  ///   deleted CellBlock%s.
+  Array::Array<s32vec2> checkpointed_block_positions;
+
+  CheckpointSnapshot snapshot;
+
+  b32 currently_running;
+  b32 thread_started;
+  pthread_t thread;
+
+  b32 error;
+
+  u64 last_checkpoint_step;
+  u32 last_n_changed_blocks;
+  u32 last_n_deleted_blocks;
+  u32 last_write_time;
+};
+
+
+b32
+start_checkpoint_log(CheckpointWriter *checkpoint_writer, const char *filename, Universe *universe);
+
+
+b32
+checkpoint_universe(CheckpointWriter *checkpoint_writer, Universe *universe, u64 simulation_step);
+
+
+void
+wait_for_checkpoint_writer(CheckpointWriter *checkpoint_writer);
+
+
+void
+destroy_checkpoint_writer(CheckpointWriter *checkpoint_writer);
+
+
+Universe *
+restore_universe_from_checkpoint_log(const char *filename, u64 simulation_step, u64 *restored_step, u64 *restored_log_size);
+
+
+b32
+resume_checkpoint_log(CheckpointWriter *checkpoint_writer, Universe *universe, u64 log_size, u64 simulation_step);
+
+
+#endif
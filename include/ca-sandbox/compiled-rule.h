@@ -0,0 +1,93 @@
+#ifndef COMPILED_RULE_H_DEF
+#define COMPILED_RULE_H_DEF
+
+#include "engine/types.h"
+
+#include "ca-sandbox/rule.h"
+
+/// @file
+/// @brief  Saving and loading `.rulec` compiled rule files
+///
+
+
+/// Compiled rule files are binary files containing a RuleConfiguration, and optionally the built
+///   rule tree, so large rules don't need to be parsed and re-built every time they are loaded.
+///
+/// Each section is stored in the same layout as it is in memory, at an 8 byte aligned offset given
+///   in the header, so loading a section from the mmap-ed file is a single copy.
+///
+///   CompiledRuleHeader
+///   n_states x CompiledNamedState
+///   state_names_size bytes of state name text, referenced by CompiledNamedState.name_offset
+///   n_null_states x CellState
+///   n_rule_patterns x RulePattern (each rule_pattern_size bytes)
+///   n_rule_nodes x RuleNode (each rule_node_size bytes)
+///
+/// The version must be incremented whenever the layout of any of these structs changes.
+
+
+const u32 COMPILED_RULE_VERSION = 1;
+const char COMPILED_RULE_MAGIC[8] = "CA-RULE";
+const char COMPILED_RULE_FILE_EXTENSION[] = ".rulec";
+
+
+struct CompiledRuleHeader
+{
+  char magic[8];
+  u32 version;
+
+  /// sizeof(CompiledRuleHeader) when the file was written
+  u32 header_size;
+
+  u64 file_size;
+
+  u32 neighbourhood_region_shape;
+  u32 neighbourhood_region_size;
+  u32 n_inputs;
+
+  u32 n_states;
+  u32 next_unused_state;
+  u32 state_names_size;
+  u32 n_null_states;
+
+  u32 n_rule_patterns;
+  u32 rule_pattern_size;
+
+  /// 0 if the rule tree is not included in the file
+  u32 n_rule_nodes;
+  u32 rule_node_size;
+  u32 root_node;
+
+  u64 named_states_offset;
+  u64 state_names_offset;
+  u64 null_states_offset;
+  u64 rule_patterns_offset;
+  u64 rule_nodes_offset;
+};
+
+
+struct CompiledNamedState
+{
+  CellState value;
+  u32 name_offset;
+  u32 name_length;
+};
+
+
+b32
+is_compiled_rule_filename(const char *filename);
+
+
+void
+get_compiled_rule_filename(const char *rule_filename, char *result, u32 result_size);
+
+
+b32
+save_compiled_rule_file(const char *filename, Rule *rule, b32 include_rule_tree = true);
+
+
+b32
+load_compiled_rule_file(const char *filename, Rule *rule);
+
+
+#endif
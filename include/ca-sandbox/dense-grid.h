@@ -0,0 +1,75 @@
+#ifndef DENSE_GRID_H_DEF
+#define DENSE_GRID_H_DEF
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+
+#include "ca-sandbox/cell.h"
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/universe.h"
+#include "ca-sandbox/border.h"
+
+/// @file
+/// @brief  A dense copy of the cells inside a bounded Border, so a simulation step can read every
+///           neighbour at a fixed offset instead of looking up its CellBlock.
+///
+
+
+/// The most cells a DenseGrid can hold, so its size in bytes fits in a u32
+const u64 MAX_DENSE_GRID_CELLS = MAX_U32 / sizeof(CellState);
+
+/// @brief The DenseGrid is only used when at least this percentage of the CellBlock%s overlapping
+///          the border exist.
+///
+/// Re-filling the grid costs the area of the whole border, so the CellBlock%s of a sparse pattern
+///   in a large border are simulated from the hashmap instead.
+const u32 DENSE_GRID_MIN_BLOCKS_PERCENT = 25;
+
+
+/// The cells inside a bounded Border copied into one row-major array.  For a TORUS border there is
+///   a halo of cells around the edges holding the cells the neighbourhood region reaches across
+///   the wrap.
+///
+/// Re-filled from the CellBlock%s at the start of each simulation step by update_dense_grid(), the
+///   CellBlock%s remain the canonical copy of the Universe.
+struct DenseGrid
+{
+  /// The global cell position of the first cell inside the border
+  s32vec2 origin;
+
+  /// The number of cells inside the border
+  s32vec2 size;
+
+  /// The number of halo cells on each side
+  s32vec2 halo;
+
+  /// Dimensions of the cells array, size + 2*halo
+  s32 width;
+  s32 height;
+
+  CellState *cells;
+  u32 n_cells_allocated;
+
+  /// The CellBlock%s overlapping the border, row-major from min_block.  0 where the block doesn't
+  ///   exist.
+  s32vec2 min_block;
+  s32vec2 n_blocks;
+
+  CellBlock **blocks;
+  u32 n_blocks_allocated;
+};
+
+
+b32
+update_dense_grid(DenseGrid *grid, Universe *universe, Border *border, s32vec2 reach, CellState unloaded_state);
+
+
+CellState *
+get_dense_grid_cell(DenseGrid *grid, s32vec2 global_cell_position);
+
+
+void
+destroy_dense_grid(DenseGrid *grid);
+
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef FILE_LOADING_THREAD_H_DEF
+#define FILE_LOADING_THREAD_H_DEF
+
+#include "engine/types.h"
+#include "engine/my-array.h"
+#include "engine/progress.h"
+
+#include "ca-sandbox/rule.h"
+#include "ca-sandbox/universe.h"
+#include "ca-sandbox/simulate.h"
+#include "ca-sandbox/named-states.h"
+
+#include <pthread.h>
+
+/// @file
+/// @brief  Loads .rule and .cells files on a separate thread, so the GUI keeps running.
+///
+/// The files are parsed into structures owned by the FileLoadingThread.  Once finished is set, the
+///   main thread collects the result between frames with swap_in_loaded_rule() or by taking
+///   loaded_universe, so the simulation and drawing never see a partially loaded file.
+///
+
+
+enum struct FileLoadingType
+{
+  RULE,
+  CELLS
+};
+
+
+struct FileLoadingThread
+{
+  FileLoadingType type;
+  char filename[1024];
+
+  /// The rule being loaded, when type is RULE.
+  Rule loaded_rule;
+
+  /// The named states of the currently loaded rule, needed to read the .cells file.  Must not be
+  ///   modified whilst loading.
+  NamedStates *named_states;
+
+  /// The universe being loaded, and the options loaded with it, when type is CELLS.
+  Universe *loaded_universe;
+  SimulateOptions simulate_options;
+  CellInitialisationOptions cell_initialisation_options;
+  Array::Array<char> error_message;
+
+  /// Whether the load succeeded, only valid once finished is set.
+  b32 success;
+
+  b32 currently_running;
+
+  /// Set by the loading thread when the result is ready to be collected by the main thread.
+  b32 finished;
+
+  b32 thread_started;
+  pthread_t thread;
+
+  u32 last_load_total_time;
+
+  Progress progress;
+};
+
+
+b32
+start_rule_loading_thread(FileLoadingThread *file_loading_thread, const char *filename);
+
+
+b32
+start_cells_loading_thread(FileLoadingThread *file_loading_thread, const char *filename, NamedStates *named_states);
+
+
+void
+finish_file_loading_thread(FileLoadingThread *file_loading_thread);
+
+
+void
+swap_in_loaded_rule(FileLoadingThread *file_loading_thread, Rule *rule);
+
+
+void
+copy_cell_initialisation_options(CellInitialisationOptions *dest, CellInitialisationOptions *src);
+
+
+#endif
@@ -4,6 +4,7 @@
 #include "engine/types.h"
 #include "engine/comparison-operator.h"
 #include "engine/my-array.h"
+#include "engine/progress.h"
 
 #include "ca-sandbox/cell.h"
 #include "ca-sandbox/neighbourhood-region.h"
@@ -123,7 +124,7 @@ struct RuleConfiguration
 
 
 b32
-load_rule_file(const char *filename, RuleConfiguration *rule_config);
+load_rule_file(const char *filename, RuleConfiguration *rule_config, Progress *progress = 0);
 
 
 #endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "engine/types.h"
 #include "engine/text.h"
+#include "engine/progress.h"
 
 #include "ca-sandbox/cell-blocks.h"
 #include "ca-sandbox/simulate.h"
@@ -25,7 +26,7 @@
 
 
 Universe *
-load_universe(const char *filename, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, NamedStates *named_states, Array::Array<char>& error_message);
+load_universe(const char *filename, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, NamedStates *named_states, Array::Array<char>& error_message, Progress *progress = 0);
 
 
 void
@@ -3,6 +3,7 @@
 
 #include "ca-sandbox/cell-blocks.h"
 #include "ca-sandbox/cell-drawing.h"
+#include "ca-sandbox/border.h"
 
 #include "engine/vectors.h"
 #include "engine/opengl-buffer.h"
@@ -10,6 +11,37 @@
 #include <GL/glew.h>
 
 
+/// @brief What has been drawn to the main minimap texture, so each frame only the CellBlock%s which
+///          changed are redrawn.
+///
+/// The texture is kept between frames.  Changed blocks are found by comparing
+///   hash_cell_block_states() against CellBlock::minimap_hash, and drawn over their old pixels.
+///   The whole minimap is redrawn when the universe bounds, border or texture change, or when a
+///   CellBlock is deleted, as that leaves a gap the CellInstances can't clear.
+struct MinimapCache
+{
+  /// Shares the cell vertices with the main CellInstancing, with its own instance buffer
+  CellInstancing instancing;
+
+  /// Changing any of these redraws the whole minimap, universe_generation is the
+  ///   Universe::generation
+  GLuint texture;
+  s32vec2 texture_size;
+  u64 universe_generation;
+  u32 cell_block_dim;
+  Border border;
+  s32vec2 lowest_block;
+  s32vec2 highest_block;
+
+  /// The number of CellBlock%s drawn to the texture.  If there are fewer than this which have
+  ///   been drawn before, one has been deleted.
+  u32 n_cell_blocks_drawn;
+
+  /// The number of CellBlock%s drawn by the last update
+  u32 n_cell_blocks_redrawn;
+};
+
+
 GLuint
 create_minimap_framebuffer();
 
@@ -22,6 +54,14 @@ void
 draw_minimap_texture(CellBlocks *cell_blocks, CellInstancing *cell_instancing, CellDrawing *cell_drawing, OpenGL_Buffer *general_vertex_buffer, GLuint framebuffer, GLuint texture, s32vec2 texture_size);
 
 
+void
+init_minimap_cache(MinimapCache *minimap_cache, CellInstancing *cell_instancing);
+
+
+void
+update_minimap_texture(MinimapCache *minimap_cache, Universe *universe, Border border, CellDrawing *cell_drawing, OpenGL_Buffer *general_vertex_buffer, GLuint framebuffer, GLuint texture, s32vec2 texture_size);
+
+
 void
 draw_minimap_texture_to_screen(GLuint framebuffer, GLuint texture, s32vec2 texture_size, GLuint texture_shader, GLuint rendered_texture_uniform);
 
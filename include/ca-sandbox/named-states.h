@@ -19,10 +19,27 @@ struct NamedState
 };
 
 
+/// A perfect hash table of the state names, so state names can be looked up without comparing
+///   against every NamedState.  Built by build_state_name_table().
+struct StateNameTable
+{
+  /// Each slot holds the index of the state in NamedStates::states plus one, or 0 if the slot is
+  ///   empty.  No two state names hash to the same slot.
+  Array::Array<u32> slots;
+  u32 mask;
+  u32 seed;
+
+  /// The number of states when the table was built, the table is not used if this doesn't match.
+  u32 n_states;
+};
+
+
 struct NamedStates
 {
   Array::Array<NamedState> states;
   CellState next_unused_state;
+
+  StateNameTable name_table;
 };
 
 
@@ -30,6 +47,14 @@ CellState
 get_next_unused_state_value(NamedStates *named_states);
 
 
+void
+build_state_name_table(NamedStates *named_states);
+
+
+b32
+state_value_from_name(NamedStates *named_states, String state_name, CellState *resulting_state);
+
+
 b32
 is_state_character(char character);
 
@@ -66,6 +91,10 @@ vec4
 get_state_colour(CellState state);
 
 
+u32
+get_n_state_colours();
+
+
 u32
 get_longest_state_name_length(NamedStates *named_states);
 
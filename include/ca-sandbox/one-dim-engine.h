@@ -0,0 +1,78 @@
+#ifndef ONE_DIM_ENGINE_H_DEF
+#define ONE_DIM_ENGINE_H_DEF
+
+#include "engine/types.h"
+
+#include "ca-sandbox/cell.h"
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/universe.h"
+#include "ca-sandbox/border.h"
+#include "ca-sandbox/rule.h"
+
+/// @file
+/// @brief  Simulation of ONE_DIM rules on a single contiguous row of cells, with a space-time
+///           history of the previous generations.
+///
+
+
+const u32 DEFAULT_ONE_DIM_HISTORY_LENGTH = 1024;
+
+
+/// Simulates one row of a Universe with a ONE_DIM rule, without the CellBlock%s.
+///
+/// The row is padded either side by the rule's input reach, filled according to the border type
+///   before each step.  With an INFINITE border the row grows when non-null cells reach the
+///   padding.
+///
+/// Each generation is written into a ring buffer history, which can be copied into a Universe with
+///   copy_one_dim_history_to_universe() to be drawn as a space-time image.
+struct OneDimEngine
+{
+  BorderType border_type;
+
+  /// Global cell position of the first cell in the row
+  s32vec2 origin;
+  u32 n_cells;
+
+  /// The rule's input reach, the number of cells of padding either side of the row
+  u32 padding;
+
+  /// The state used for padding and cells which aren't loaded
+  CellState unloaded_state;
+
+  /// The current and next generations, each n_cells + 2*padding long.  row[padding] is the first
+  ///   cell.
+  CellState *row;
+  CellState *next_row;
+
+  /// The number of generations simulated since the engine was initialised
+  u64 generation;
+
+  /// The last history_length generations, each n_cells long.  Generation g is at row
+  ///   g % history_length.
+  CellState *history;
+  u32 history_length;
+};
+
+
+b32
+init_one_dim_engine(OneDimEngine *engine, Rule *rule, Universe *universe, Border *border, s32 row_y, u32 history_length = DEFAULT_ONE_DIM_HISTORY_LENGTH);
+
+
+void
+step_one_dim_engine(OneDimEngine *engine, Rule *rule);
+
+
+CellState *
+get_one_dim_history_row(OneDimEngine *engine, u64 generation);
+
+
+void
+copy_one_dim_history_to_universe(OneDimEngine *engine, Universe *universe, CellInitialisationOptions *cell_initialisation_options);
+
+
+void
+destroy_one_dim_engine(OneDimEngine *engine);
+
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "engine/my-array.h"
 #include "engine/text.h"
+#include "engine/progress.h"
 
 #include "ca-sandbox/cell.h"
 #include "ca-sandbox/border.h"
@@ -32,6 +33,120 @@ struct RuleNode
 };
 
 
+/// Rules with more states than this use the RulePatterns directly, instead of RulePatternMasks
+const u32 MAX_RULE_PATTERN_MASK_STATES = 64;
+
+/// Rules with more patterns than this test every pattern, instead of using
+///   Rule.input_state_patterns to find the candidate patterns
+const u32 MAX_RULE_PATTERN_CANDIDATES = 64;
+
+
+/// Bit masks of the states which satisfy a PatternCellState, bit n is set for state n.
+struct PatternInputMasks
+{
+  /// States which pass a STATE or NOT_STATE cell, all states for other cells
+  u64 match_states;
+
+  /// States counted by an OR_STATE cell
+  u64 or_states;
+
+  /// States counted for count_matching by a WILDCARD cell
+  u64 count_matching_states;
+};
+
+
+/// A RulePattern compiled by compile_rule_patterns(), so matching an input against the pattern is
+///   an AND of each input's state bit with the masks, instead of searching the CellStateGroups.
+///
+struct RulePatternMasks
+{
+  CellState result;
+
+  b32 count_matching_enabled;
+  ComparisonOp comparison;
+  u32 comparison_n;
+
+  b32 or_matching_enabled;
+
+  /// One per input
+  PatternInputMasks inputs[];
+};
+
+
+/// Child position of a node in a lazily built rule tree which has not been created yet
+const u32 UNBUILT_RULE_NODE = 0xFFFFFFFF;
+
+
+/// Compact copy of the rule tree used by execute_transition_function(), built from the
+///   rule_nodes_table by build_compact_rule_tree().
+///
+/// Each non-leaf node is stored as just its n_states child entries.  A child entry is either the
+///   offset of the child node's entries within the children array, or, if the top bit is set, the
+///   leaf value in the remaining bits; so leaves take no space of their own.
+///
+/// If all the offsets and leaf values fit in 15 bits, u16 entries are used in children_16,
+///   otherwise u32 entries are used in children_32.
+///
+struct CompactRuleTree
+{
+  b32 built;
+  b32 narrow;
+
+  /// Entry for the root node, using the same encoding as the children
+  u32 root;
+
+  Array::Array<u16> children_16;
+  Array::Array<u32> children_32;
+};
+
+
+const u32 COMPACT_RULE_LEAF_BIT_16 = 1 << 15;
+const u32 COMPACT_RULE_LEAF_BIT_32 = 1u << 31;
+
+
+/// The parts of the RuleConfiguration a rule tree was built from, so the tree can be rebuilt
+///   incrementally after the rule patterns are edited.
+///
+struct RuleTreeSource
+{
+  b32 valid;
+
+  NeighbourhoodRegionShape neighbourhood_region_shape;
+  u32 neighbourhood_region_size;
+  u32 n_states;
+
+  RulePatterns rule_patterns;
+};
+
+
+/// Counters recorded by execute_transition_function() whilst Rule.collect_traversal_stats is set,
+///   used to see where the time goes in a rule tree.
+///
+/// The arrays are sized by reset_rule_traversal_stats(), no counting is done if node_visits doesn't
+///   match the size of the current rule_nodes_table.
+///
+struct RuleTraversalStats
+{
+  /// Number of calls to execute_transition_function()
+  u64 n_traversals;
+
+  /// Sum of the number of inputs read over all traversals
+  u64 total_depth;
+
+  /// Traversals which stopped because a neighbour was outside a FIXED border
+  u64 n_border_early_outs;
+
+  /// depth_histogram[n] is the number of traversals which read n inputs, size Rule.n_inputs + 1
+  Array::Array<u64> depth_histogram;
+
+  /// Number of times each node in the rule_nodes_table was visited
+  Array::Array<u64> node_visits;
+
+  /// Number of traversals ending at a leaf with each output state, indexed by state value
+  Array::Array<u64> leaf_state_hits;
+};
+
+
 /// - A Rule is represented by a tree data structure, where each node represents the state of a
 ///     neighbour, and the child to look at for the next neighbour.  The tree has a (max) depth of
 ///     the number of inputs to the transition function, i.e: the number of neighbour nodes +1 for
@@ -56,18 +171,49 @@ struct Rule
   /// Number of inputs to the transition function, i.e: number of neighbours + centre cell
   u32 n_inputs;
 
+  /// Cell delta of each input from the centre cell, in input order.  Must be re-built with
+  ///   build_rule_input_deltas() whenever n_inputs is set.
+  Array::Array<s32vec2> input_deltas;
+
+  /// The furthest any input is from the centre cell along each axis
+  s32vec2 input_reach;
+
+  /// input_deltas as offsets into the cell states of a CellBlock of input_offsets_block_dim, for
+  ///   cells whose inputs are all within the same CellBlock.  See update_rule_input_offsets().
+  Array::Array<s32> input_offsets;
+  u32 input_offsets_block_dim;
+
   /// Array of all RuleNodes making up this rule.
   Array::Array<RuleNode, true> rule_nodes_table;
 
   /// Position of the rule tree's root node within the rule_nodes_table.
   u32 root_node;
-};
 
+  /// Traversal copy of the rule_nodes_table, must be re-built whenever the table changes
+  CompactRuleTree compact_tree;
 
-struct Progress
-{
-  u64 total;
-  u64 done;
+  /// Copy of the configuration the rule tree was built from
+  RuleTreeSource tree_source;
+
+  /// The rule patterns compiled at the start of the last build, if the rule has few enough states
+  b32 pattern_masks_compiled;
+  Array::Array<RulePatternMasks, true> pattern_masks;
+
+  /// Bit n of input_state_patterns[input_n * n_states + state] is set if pattern n can match with
+  ///   that state at input_n, empty if there are too many patterns.
+  Array::Array<u64> input_state_patterns;
+
+  /// The rule tree is being built lazily: nodes are only created by execute_transition_function()
+  ///   when a path is first traversed, children not traversed yet are UNBUILT_RULE_NODE.  Non-leaf
+  ///   nodes are not shared in a lazy tree.
+  b32 lazy_rule_tree;
+
+  /// Position of the leaf node for each leaf value in a lazy tree, or UNBUILT_RULE_NODE
+  Array::Array<u32> lazy_leaf_nodes;
+
+  /// Record RuleTraversalStats in execute_transition_function(), this slows down the simulation.
+  b32 collect_traversal_stats;
+  RuleTraversalStats traversal_stats;
 };
 
 
@@ -80,6 +226,10 @@ struct RuleCreationThread
 
   u32 last_build_total_time;
 
+  /// Start a lazy rule tree instead of enumerating every input, for rules with too many inputs to
+  ///   build up front.  See Rule.lazy_rule_tree.
+  b32 build_lazily;
+
   Progress progress;
 };
 
@@ -88,10 +238,42 @@ b32
 is_null_state(RuleConfiguration *rule_configuration, CellState state);
 
 
+void
+build_rule_tree(RuleCreationThread *rule_creation_thread);
+
+
+void
+build_rule_input_deltas(Rule *rule);
+
+
+void
+update_rule_input_offsets(Rule *rule, u32 cell_block_dim);
+
+
+void
+save_rule_tree_source(Rule *rule);
+
+
+void
+reorder_rule_tree(Rule *rule, Array::Array<u64> *node_visits = 0);
+
+
 b32
 start_build_rule_tree_thread(RuleCreationThread *rule_creation_thread, Rule *result);
 
 
+void
+build_compact_rule_tree(Rule *rule);
+
+
+void
+destroy_compact_rule_tree(CompactRuleTree *compact_tree);
+
+
+u32
+get_compact_rule_tree_size(CompactRuleTree *compact_tree);
+
+
 void
 destroy_rule_tree(Rule *rule);
 
@@ -100,8 +282,20 @@ void
 print_rule_tree(Rule *rule_tree);
 
 
+void
+reset_rule_traversal_stats(Rule *rule);
+
+
+void
+free_rule_traversal_stats(RuleTraversalStats *stats);
+
+
 CellState
 execute_transition_function(Border *border, Universe *universe, Rule *rule, s32vec2 cell_block_position, s32vec2 cell_position);
 
 
+CellState
+execute_transition_function_in_block(Rule *rule, CellState *cell_previous_states, u32 cell_index);
+
+
 #endif
\ No newline at end of file
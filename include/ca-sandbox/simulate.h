@@ -26,4 +26,8 @@ void
 simulate_cells(SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, Rule *rule, Universe *universe, u64 current_frame);
 
 
+void
+transition_cell_row(Rule *rule, CellState *row, u32 n_cells, CellState *output);
+
+
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef PROFILER_UI_H_DEF
+#define PROFILER_UI_H_DEF
+
+#include "engine/types.h"
+#include "engine/profiler.h"
+
+#include "interface/file-picker.h"
+
+/// @file
+///
+
+
+struct ProfilerUI
+{
+  /// The length of time shown in the timeline, in milliseconds
+  r32 timeline_length_ms;
+
+  /// Stop the timeline from following the latest events
+  b32 timeline_frozen;
+  u64 timeline_end_time;
+
+  char export_filename[FILE_NAME_LIMIT];
+};
+
+
+void
+do_profiler_ui(ProfilerUI *profiler_ui, Profiler *profiler);
+
+
+#endif
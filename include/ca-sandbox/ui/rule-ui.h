@@ -5,6 +5,7 @@
 
 #include "ca-sandbox/rule.h"
 #include "ca-sandbox/files-loaded-state.h"
+#include "ca-sandbox/file-loading-thread.h"
 
 /// @file
 ///
@@ -15,11 +16,20 @@ struct RuleUI
 {
   FilePicker file_picker;
   b32 save_rule_file;
+
+  /// Save the rule configuration and rule tree to a .rulec file alongside the rule file
+  b32 save_compiled_rule_file;
+
+  /// Result of the last rule tree sharing analysis, valid whilst sharing_analysis_n_nodes matches
+  ///   the size of the rule_nodes_table
+  u32 sharing_analysis_n_nodes;
+  u64 sharing_analysis_n_child_references;
+  r64 sharing_analysis_unshared_tree_size;
 };
 
 
 void
-do_rule_ui(RuleUI *rule_ui, Rule *rule, RuleCreationThread *rule_creation_thread, FilesLoadedState *files_loaded_state);
+do_rule_ui(RuleUI *rule_ui, Rule *rule, RuleCreationThread *rule_creation_thread, FileLoadingThread *rule_loading_thread, FilesLoadedState *files_loaded_state);
 
 
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define SIMULATION_UI_H_DEF
 
 #include "ca-sandbox/files-loaded-state.h"
+#include "ca-sandbox/checkpoint.h"
 
 #include "engine/types.h"
 #include "engine/text.h"
@@ -44,11 +45,26 @@ struct SimulationUI
 
   u32 simulation_delta_cumulative_average;
   u32 simulation_delta_cumulative_average_n;
+
+  /// Write incremental checkpoints of the universe to a log while simulating
+  b32 checkpointing;
+
+  /// The number of simulation steps between checkpoints
+  s32 checkpoint_interval;
+
+  /// Set when a new simulation run is started, so the next checkpoint starts a new log
+  b32 start_new_checkpoint_log;
+
+  /// Restore the universe from the checkpoint log this frame
+  b32 restore_checkpoint;
+
+  /// The simulation step to restore, the last checkpoint at or before this step is used
+  s32 restore_checkpoint_step;
 };
 
 
 void
-do_simulation_ui(SimulationUI *simulation_ui, u64 frame_start, b32 rule_tree_built, FilesLoadedState *files_loaded_state, b32 *save_universe);
+do_simulation_ui(SimulationUI *simulation_ui, u64 frame_start, b32 rule_tree_built, FilesLoadedState *files_loaded_state, b32 *save_universe, CheckpointWriter *checkpoint_writer);
 
 
 #endif
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "ca-sandbox/cell-blocks.h"
 #include "ca-sandbox/simulate.h"
 #include "ca-sandbox/files-loaded-state.h"
+#include "ca-sandbox/file-loading-thread.h"
 
 #include "ca-sandbox/ui/new-universe-ui.h"
 
@@ -27,13 +28,16 @@ struct UniverseUI
 
   u32 edited_cell_block_dim;
 
+  /// Draw the main view with the CellTextureDrawing instead of the CellInstanceCache
+  b32 draw_cells_as_textures;
+
   b32 loading_error;
   Array::Array<char> loading_error_message;
 };
 
 
 void
-do_universe_ui(UniverseUI *universe_ui, Universe **universe, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, NamedStates *named_states, FilesLoadedState *files_laoded_state);
+do_universe_ui(UniverseUI *universe_ui, Universe **universe, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, NamedStates *named_states, FilesLoadedState *files_laoded_state, FileLoadingThread *cells_loading_thread);
 
 
 void
@@ -39,6 +39,14 @@ UniversePosition
 screen_position_to_universe_position(ViewPanning *view_panning, vec2 screen_mouse_position);
 
 
+void
+get_visible_cell_blocks(ViewPanning *view_panning, s32vec2 *start_block, s32vec2 *end_block);
+
+
+r32
+get_pixels_per_cell_block(ViewPanning *view_panning, s32vec2 window_size);
+
+
 void
 centre_universe(ViewPanning *view_panning, Universe *universe, s32vec2 window_size);
 
@@ -86,6 +86,20 @@ ipow(u64 base, u64 exp)
 }
 
 
+/// Rounds towards negative infinity, unlike /
+inline s32
+floor_divide(s32 numerator, s32 denominator)
+{
+  s32 result = numerator / denominator;
+  if ((numerator % denominator) != 0 && (numerator < 0) != (denominator < 0))
+  {
+    result -= 1;
+  }
+
+  return result;
+}
+
+
 template <typename T>
 T
 sign(T x)
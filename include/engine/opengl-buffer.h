@@ -14,6 +14,9 @@
 ///   - This means element indices are not constant, and an element's position in the buffer can not be assumed.
 /// - On element addition, element is prepended to end of the elements.
 /// - If buffer reaches capacity, new buffer is allocated with twice the previous capacity, and elements are copied into it.
+///
+/// Buffers created with create_opengl_stream_buffer() are instead re-written in bulk each time they
+///   are used, see opengl_buffer_map_stream().
 
 
 /// The initial size for all OpenGL_Buffer%s created with create_opengl_buffer()
@@ -22,6 +25,10 @@ const u32 INITIAL_GL_BUFFER_TOTAL_ELEMENTS = 16;
 /// The maximum size in bytes of an OpenGL_Buffer
 const u32 MAX_BUFFER_SIZE = MAX_U32;
 
+/// The number of regions a streaming OpenGL_Buffer cycles through, so the CPU can write one whilst
+///   the GPU is still drawing from the others
+const u32 OPENGL_BUFFER_STREAM_REGIONS = 3;
+
 
 /// Holds state and references for an allocated OpenGL buffer
 struct OpenGL_Buffer
@@ -35,6 +42,20 @@ struct OpenGL_Buffer
   GLenum binding_target;  ///< OpenGL binding target to be used
   GLenum usage;  ///< OpenGL usage pattern
 
+  /// @brief The element the elements_used start from, attribute pointers must be offset by this.
+  ///
+  /// Always 0, apart from in streaming buffers, where it is the start of the current region.
+  u32 first_element;
+
+  /// @brief Streaming buffers hold OPENGL_BUFFER_STREAM_REGIONS regions of total_elements each.
+  ///
+  /// Each opengl_buffer_map_stream() moves on to the next region, waiting on its fence if the GPU
+  ///   could still be reading it.
+  b32 streaming;
+  u32 stream_region;
+  GLsync stream_fences[OPENGL_BUFFER_STREAM_REGIONS];
+  void *stream_mapping;
+
   /// @brief The function to be called after re-allocating the buffer, needed for re-assigning the
   ///          attributes.
   void (*setup_attributes_function)(OpenGL_Buffer *);
@@ -45,6 +66,22 @@ void
 create_opengl_buffer(OpenGL_Buffer *buffer, u32 element_size, GLenum binding_target, GLenum usage, u32 size = 0);
 
 
+void
+create_opengl_stream_buffer(OpenGL_Buffer *buffer, u32 element_size, GLenum binding_target, u32 size = 0);
+
+
+void
+destroy_opengl_buffer(OpenGL_Buffer *buffer);
+
+
+void *
+opengl_buffer_map_stream(OpenGL_Buffer *buffer, u32 max_elements);
+
+
+void
+opengl_buffer_unmap_stream(OpenGL_Buffer *buffer, u32 n_elements);
+
+
 void
 opengl_buffer_extend(OpenGL_Buffer *buffer, u32 minimum_new_total_elements = 0);
 
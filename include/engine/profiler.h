@@ -0,0 +1,90 @@
+#ifndef PROFILER_H_DEF
+#define PROFILER_H_DEF
+
+#include "engine/types.h"
+
+/// @file
+/// @brief  Lightweight scoped timing instrumentation
+///
+/// PROFILE_SCOPE("name") records the time from where it is declared to the end of the enclosing
+///   scope, as a ProfileEvent in the global_profiler ring buffer.  Events can be recorded from any
+///   thread.
+///
+/// The name is stored as a pointer, so must be a string literal.  The ring buffer must be cleared
+///   with clear_profiler() before the library containing the literals is unloaded.
+///
+
+
+/// Must be a power of two
+const u32 PROFILER_MAX_EVENTS = 1 << 14;
+
+
+struct ProfileEvent
+{
+  const char *name;
+
+  /// Time in micro-seconds, from get_us()
+  u64 start_time;
+  u32 duration;
+
+  /// Small integer identifying the thread, assigned in the order threads first record an event.
+  u16 thread_id;
+
+  /// The number of enclosing PROFILE_SCOPEs on the same thread.
+  u16 depth;
+};
+
+
+struct Profiler
+{
+  /// Events are not recorded whilst paused.
+  b32 paused;
+
+  /// The total number of events recorded, event n is stored in events[n % PROFILER_MAX_EVENTS].
+  u64 n_events_recorded;
+
+  /// The number of threads which have recorded events, thread ids are below this.
+  u32 n_threads;
+
+  ProfileEvent events[PROFILER_MAX_EVENTS];
+};
+
+
+extern Profiler global_profiler;
+
+
+void
+clear_profiler(Profiler *profiler);
+
+
+u32
+get_profiler_thread_id(Profiler *profiler);
+
+
+/// Returns the events currently in the ring buffer, oldest first, in *first_event and *n_events.
+///   events[(first_event + n) % PROFILER_MAX_EVENTS] is the nth event.
+void
+get_profile_events_range(Profiler *profiler, u64 *first_event, u32 *n_events);
+
+
+b32
+export_chrome_trace(Profiler *profiler, const char *filename);
+
+
+struct ProfileScope
+{
+  const char *name;
+  u64 start_time;
+  b32 recording;
+
+  ProfileScope(const char *scope_name);
+  ~ProfileScope();
+};
+
+
+#define PROFILE_SCOPE_VARIABLE_(line) profile_scope_##line
+#define PROFILE_SCOPE_VARIABLE(line) PROFILE_SCOPE_VARIABLE_(line)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_SCOPE_VARIABLE(__LINE__)(name)
+
+
+#endif
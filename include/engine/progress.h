@@ -0,0 +1,18 @@
+#ifndef PROGRESS_H_DEF
+#define PROGRESS_H_DEF
+
+#include "engine/types.h"
+
+/// @file
+/// @brief  Progress counter, written by a worker thread and read by the GUI.
+///
+
+
+struct Progress
+{
+  u64 total;
+  u64 done;
+};
+
+
+#endif
@@ -0,0 +1,520 @@
+#include "engine/types.h"
+#include "engine/util.h"
+#include "engine/print.h"
+#include "engine/timing.h"
+#include "engine/allocate.h"
+#include "engine/my-array.h"
+
+#include "ca-sandbox/rule.h"
+#include "ca-sandbox/load-rule.h"
+#include "ca-sandbox/load-universe.h"
+#include "ca-sandbox/simulate.h"
+#include "ca-sandbox/cell-blocks.h"
+
+#include "header-libs/tinydir.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/// @file
+/// @brief  ca-bench: Simulation throughput benchmarks over the rules/ and cells/ directories
+///
+/// Every .rule file is paired with every .cells file which loads successfully with the rule's
+///   named states, and with random-soup universes of several sizes.  Each pairing is simulated for
+///   a fixed number of steps, and the results are written as JSON.
+///
+
+
+const u32 DEFAULT_BENCH_STEPS = 100;
+const u32 DEFAULT_SOUP_SIZES[] = {64, 256};
+
+/// A single-block random soup with a cell_block_dim this large covers the per-block scratch space
+///   sized from the cell_block_dim read from a cells file.
+const u32 DEFAULT_LARGE_BLOCK_SOUP_DIM = 2048;
+
+/// Fixed so the random soups are the same on every run.
+const u32 SOUP_RANDOM_SEED = 1;
+
+
+struct CA_BenchOptions
+{
+  const char *rules_directory;
+  const char *cells_directory;
+  const char *output_filename;
+
+  u64 n_steps;
+
+  /// Side lengths of the random soup universes, in cells.
+  Array::Array<u32> soup_sizes;
+
+  /// cell_block_dim, and side length, of the single-block random soup, 0 to disable.
+  u32 large_block_soup_dim;
+};
+
+
+struct BenchResult
+{
+  u64 simulate_time;
+  u64 total_cell_blocks_simulated;
+  u32 final_n_cell_blocks;
+  u32 cell_block_dim;
+};
+
+
+void
+print_usage(const char *program_name)
+{
+  print("Usage: %s [options]\n", program_name);
+  print("\n");
+  print("Options:\n");
+  print("  -n, --steps <n>            Number of simulation steps per benchmark (default %u)\n", DEFAULT_BENCH_STEPS);
+  print("  -r, --rules <directory>    Directory of .rule files (default rules)\n");
+  print("  -c, --cells <directory>    Directory of .cells files (default cells)\n");
+  print("  -s, --soup-sizes <list>    Comma separated side lengths, in cells, of the random soup\n");
+  print("                               universes (default 64,256), 0 to disable\n");
+  print("  -l, --large-block <dim>    cell_block_dim of a single-block random soup universe\n");
+  print("                               (default %u), 0 to disable\n", DEFAULT_LARGE_BLOCK_SOUP_DIM);
+  print("  -o, --output <file>        JSON output file (default ca-bench.json)\n");
+  print("  -h, --help                 Print this message\n");
+}
+
+
+b32
+read_soup_sizes(const char *argument, Array::Array<u32>& soup_sizes)
+{
+  b32 success = true;
+
+  Array::clear(soup_sizes);
+
+  const char *position = argument;
+  while (*position != '\0' && success)
+  {
+    char *end;
+    u32 size = strtoul(position, &end, 10);
+
+    if (end == position || (*end != ',' && *end != '\0'))
+    {
+      print("Error: Invalid soup sizes \"%s\".\n", argument);
+      success &= false;
+    }
+    else
+    {
+      if (size > 0)
+      {
+        Array::add(soup_sizes, size);
+      }
+
+      position = *end == ',' ? end + 1 : end;
+    }
+  }
+
+  return success;
+}
+
+
+b32
+read_arguments(int argc, const char *argv[], CA_BenchOptions *options)
+{
+  b32 success = true;
+
+  options->rules_directory = "rules";
+  options->cells_directory = "cells";
+  options->output_filename = "ca-bench.json";
+  options->n_steps = DEFAULT_BENCH_STEPS;
+  Array::add_n(options->soup_sizes, (u32 *)DEFAULT_SOUP_SIZES, array_count(DEFAULT_SOUP_SIZES));
+  options->large_block_soup_dim = DEFAULT_LARGE_BLOCK_SOUP_DIM;
+
+  for (s32 arg_n = 1;
+       arg_n < argc && success;
+       ++arg_n)
+  {
+    const char *argument = argv[arg_n];
+    const char *value = arg_n + 1 < argc ? argv[arg_n + 1] : 0;
+
+    if (strcmp(argument, "-h") == 0 || strcmp(argument, "--help") == 0)
+    {
+      success &= false;
+    }
+    else if (value == 0)
+    {
+      print("Error: Unknown option, or option without a value \"%s\".\n", argument);
+      success &= false;
+    }
+    else
+    {
+      ++arg_n;
+
+      if (strcmp(argument, "-n") == 0 || strcmp(argument, "--steps") == 0)
+      {
+        char *end;
+        options->n_steps = strtoull(value, &end, 10);
+        if (*end != '\0' || options->n_steps == 0)
+        {
+          print("Error: Invalid number of steps \"%s\".\n", value);
+          success &= false;
+        }
+      }
+      else if (strcmp(argument, "-r") == 0 || strcmp(argument, "--rules") == 0)
+      {
+        options->rules_directory = value;
+      }
+      else if (strcmp(argument, "-c") == 0 || strcmp(argument, "--cells") == 0)
+      {
+        options->cells_directory = value;
+      }
+      else if (strcmp(argument, "-s") == 0 || strcmp(argument, "--soup-sizes") == 0)
+      {
+        success &= read_soup_sizes(value, options->soup_sizes);
+      }
+      else if (strcmp(argument, "-l") == 0 || strcmp(argument, "--large-block") == 0)
+      {
+        char *end;
+        options->large_block_soup_dim = strtoul(value, &end, 10);
+        if (*end != '\0')
+        {
+          print("Error: Invalid large block cell_block_dim \"%s\".\n", value);
+          success &= false;
+        }
+      }
+      else if (strcmp(argument, "-o") == 0 || strcmp(argument, "--output") == 0)
+      {
+        options->output_filename = value;
+      }
+      else
+      {
+        print("Error: Unknown option \"%s\".\n", argument);
+        success &= false;
+      }
+    }
+  }
+
+  return success;
+}
+
+
+/// Adds the paths of all files in directory ending in extension to filenames, sorted by name.  Each
+///   path is heap allocated.
+void
+list_files_with_extension(const char *directory, const char *extension, Array::Array<char *>& filenames)
+{
+  tinydir_dir directory_listing = {};
+
+  if (tinydir_open_sorted(&directory_listing, directory) == -1)
+  {
+    print("Error: Failed to open directory %s.\n", directory);
+  }
+  else
+  {
+    for (u32 file_n = 0;
+         file_n < directory_listing.n_files;
+         ++file_n)
+    {
+      tinydir_file file = {};
+
+      if (tinydir_readfile_n(&directory_listing, &file, file_n) == 0 &&
+          !file.is_dir &&
+          strcmp(file.extension, extension) == 0)
+      {
+        u32 path_length = strlen(file.path) + 1;
+        char *path = allocate(char, path_length);
+        memcpy(path, file.path, path_length);
+        Array::add(filenames, path);
+      }
+    }
+
+    tinydir_close(&directory_listing);
+  }
+}
+
+
+/// The peak resident set size of the whole process, so it covers every pairing benchmarked so far.
+u64
+get_peak_memory_kb()
+{
+  struct rusage usage = {};
+  getrusage(RUSAGE_SELF, &usage);
+
+  u64 result = usage.ru_maxrss;
+  return result;
+}
+
+
+BenchResult
+run_bench(SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, Rule *rule, Universe *universe, u64 n_steps)
+{
+  BenchResult result = {};
+  result.cell_block_dim = universe->cell_block_dim;
+
+  u64 simulate_start_time = get_us();
+  for (u64 step = 1;
+       step <= n_steps;
+       ++step)
+  {
+    simulate_cells(simulate_options, cell_initialisation_options, rule, universe, step);
+    result.total_cell_blocks_simulated += universe->n_cell_blocks_in_use;
+  }
+  result.simulate_time = get_us() - simulate_start_time;
+
+  result.final_n_cell_blocks = universe->n_cell_blocks_in_use;
+
+  return result;
+}
+
+
+/// Creates a square TORUS universe, of at least size x size cells in blocks of cell_block_dim, with
+///   every cell in a random state of the rule.
+Universe *
+create_random_soup(RuleConfiguration *rule_config, u32 size, u32 cell_block_dim, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options)
+{
+  NamedStates *named_states = &rule_config->named_states;
+
+  Universe *result = allocate(Universe, 1);
+  init_cell_hashmap(result);
+  result->cell_block_dim = cell_block_dim;
+
+  s32 n_blocks = (size + result->cell_block_dim - 1) / result->cell_block_dim;
+
+  *simulate_options = default_simulation_options();
+  simulate_options->border.type = BorderType::TORUS;
+  simulate_options->border.min_corner_block = (s32vec2){0, 0};
+  simulate_options->border.min_corner_cell = (s32vec2){0, 0};
+  simulate_options->border.max_corner_block = (s32vec2){n_blocks, n_blocks};
+  simulate_options->border.max_corner_cell = (s32vec2){0, 0};
+
+  cell_initialisation_options->type = CellInitialisationType::RANDOM;
+  Array::clear(cell_initialisation_options->set_of_initial_states);
+  for (u32 state_n = 0;
+       state_n < named_states->states.n_elements;
+       ++state_n)
+  {
+    Array::add(cell_initialisation_options->set_of_initial_states, named_states->states[state_n].value);
+  }
+
+  srand(SOUP_RANDOM_SEED);
+
+  for (s32 y = 0;
+       y < n_blocks;
+       ++y)
+  {
+    for (s32 x = 0;
+         x < n_blocks;
+         ++x)
+    {
+      create_cell_block(result, cell_initialisation_options, (s32vec2){x, y});
+    }
+  }
+
+  // The blocks created whilst simulating are outside the soup, where the TORUS border wraps, so they
+  //   start in a null state.
+  Array::clear(cell_initialisation_options->set_of_initial_states);
+  CellState initial_state = 0;
+  if (rule_config->null_states.n_elements > 0)
+  {
+    initial_state = rule_config->null_states[0];
+  }
+  Array::add(cell_initialisation_options->set_of_initial_states, initial_state);
+
+  return result;
+}
+
+
+void
+write_json_string(FILE *file, const char *string)
+{
+  fputc('"', file);
+  for (const char *c = string;
+       *c != '\0';
+       ++c)
+  {
+    if (*c == '"' || *c == '\\')
+    {
+      fputc('\\', file);
+    }
+    fputc(*c, file);
+  }
+  fputc('"', file);
+}
+
+
+void
+write_bench_result(FILE *file, b32 *first_result, const char *cells_name, u64 n_steps, BenchResult *bench_result)
+{
+  r64 simulate_seconds = bench_result->simulate_time * (1.0/1000000.0);
+  u64 cells_per_block = (u64)bench_result->cell_block_dim * bench_result->cell_block_dim;
+
+  r64 cells_per_second = 0;
+  if (simulate_seconds > 0)
+  {
+    cells_per_second = (bench_result->total_cell_blocks_simulated * cells_per_block) / simulate_seconds;
+  }
+
+  fprintf(file, "%s\n      {\"cells\": ", *first_result ? "" : ",");
+  write_json_string(file, cells_name);
+  fprintf(file, ", \"steps\": %lu, \"cell_block_dim\": %u, \"simulate_us\": %lu, "
+                "\"blocks_per_step\": %.2f, \"final_blocks\": %u, \"cells_per_second\": %.0f}",
+          n_steps, bench_result->cell_block_dim, bench_result->simulate_time,
+          (r64)bench_result->total_cell_blocks_simulated / n_steps, bench_result->final_n_cell_blocks,
+          cells_per_second);
+
+  *first_result = false;
+
+  print("  %-28s %12.0f cells/s  %8.2f blocks/step\n", cells_name, cells_per_second, (r64)bench_result->total_cell_blocks_simulated / n_steps);
+}
+
+
+void
+bench_random_soup(FILE *file, b32 *first_result, const char *soup_name, Rule *rule, u32 size, u32 cell_block_dim, u64 n_steps)
+{
+  SimulateOptions simulate_options = {};
+  CellInitialisationOptions cell_initialisation_options = {};
+  Universe *universe = create_random_soup(&rule->config, size, cell_block_dim, &simulate_options, &cell_initialisation_options);
+
+  BenchResult bench_result = run_bench(&simulate_options, &cell_initialisation_options, rule, universe, n_steps);
+  write_bench_result(file, first_result, soup_name, n_steps, &bench_result);
+
+  destroy_cell_hashmap(universe);
+  un_allocate(universe);
+  Array::free_array(cell_initialisation_options.set_of_initial_states);
+}
+
+
+int
+main(int argc, const char *argv[])
+{
+  s32 result = 0;
+
+  CA_BenchOptions options = {};
+  b32 success = read_arguments(argc, argv, &options);
+
+  FILE *output_file = 0;
+  if (success)
+  {
+    output_file = fopen(options.output_filename, "w");
+    if (output_file == 0)
+    {
+      print("Error: Failed to open %s for writing.\n", options.output_filename);
+      success &= false;
+    }
+  }
+
+  if (!success)
+  {
+    print_usage(argv[0]);
+    result = 1;
+  }
+  else
+  {
+    Array::Array<char *> rule_filenames = {};
+    Array::Array<char *> cells_filenames = {};
+    list_files_with_extension(options.rules_directory, "rule", rule_filenames);
+    list_files_with_extension(options.cells_directory, "cells", cells_filenames);
+
+    static Rule rule = {};
+    RuleCreationThread rule_creation_thread = {};
+    rule_creation_thread.rule = &rule;
+
+    b32 first_rule = true;
+
+    fprintf(output_file, "{\n  \"steps\": %lu,\n  \"rules\": [", options.n_steps);
+
+    for (u32 rule_n = 0;
+         rule_n < rule_filenames.n_elements;
+         ++rule_n)
+    {
+      const char *rule_filename = rule_filenames[rule_n];
+
+      destroy_rule_tree(&rule);
+      if (!load_rule_file(rule_filename, &rule.config))
+      {
+        print("Error: Failed to load rule file %s, skipping.\n", rule_filename);
+      }
+      else
+      {
+        build_rule_tree(&rule_creation_thread);
+
+        print("\nBenchmarking %s\n", rule_filename);
+
+        fprintf(output_file, "%s\n    {\"rule\": ", first_rule ? "" : ",");
+        write_json_string(output_file, rule_filename);
+        fprintf(output_file, ", \"n_states\": %u, \"rule_nodes\": %u, \"build_us\": %u, \"results\": [",
+                rule.config.named_states.states.n_elements, rule.rule_nodes_table.n_elements,
+                rule_creation_thread.last_build_total_time);
+        first_rule = false;
+
+        b32 first_result = true;
+
+        for (u32 cells_n = 0;
+             cells_n < cells_filenames.n_elements;
+             ++cells_n)
+        {
+          const char *cells_filename = cells_filenames[cells_n];
+
+          SimulateOptions simulate_options = default_simulation_options();
+          CellInitialisationOptions cell_initialisation_options = {};
+          default_cell_initialisation_options(&cell_initialisation_options);
+          Array::Array<char> error_message = {};
+
+          // Only the cells files using the rule's state names are paired with it
+          Universe *universe = load_universe(cells_filename, &simulate_options, &cell_initialisation_options, &rule.config.named_states, error_message);
+          if (universe != 0)
+          {
+            BenchResult bench_result = run_bench(&simulate_options, &cell_initialisation_options, &rule, universe, options.n_steps);
+            write_bench_result(output_file, &first_result, cells_filename, options.n_steps, &bench_result);
+
+            destroy_cell_hashmap(universe);
+            un_allocate(universe);
+          }
+
+          Array::free_array(error_message);
+          Array::free_array(cell_initialisation_options.set_of_initial_states);
+        }
+
+        for (u32 soup_n = 0;
+             soup_n < options.soup_sizes.n_elements;
+             ++soup_n)
+        {
+          u32 soup_size = options.soup_sizes[soup_n];
+
+          char soup_name[64];
+          snprintf(soup_name, array_count(soup_name), "random-soup-%u", soup_size);
+
+          bench_random_soup(output_file, &first_result, soup_name, &rule, soup_size, DEFAULT_CELL_BLOCK_DIM, options.n_steps);
+        }
+
+        if (options.large_block_soup_dim > 0)
+        {
+          char soup_name[64];
+          snprintf(soup_name, array_count(soup_name), "random-soup-block-dim-%u", options.large_block_soup_dim);
+
+          bench_random_soup(output_file, &first_result, soup_name, &rule, options.large_block_soup_dim, options.large_block_soup_dim, options.n_steps);
+        }
+
+        fprintf(output_file, "\n    ]}");
+      }
+    }
+
+    fprintf(output_file, "\n  ],\n  \"peak_rss_kb\": %lu\n}\n", get_peak_memory_kb());
+    fclose(output_file);
+
+    print("\nWritten results to %s\n", options.output_filename);
+
+    for (u32 filename_n = 0;
+         filename_n < rule_filenames.n_elements;
+         ++filename_n)
+    {
+      un_allocate(rule_filenames[filename_n]);
+    }
+    for (u32 filename_n = 0;
+         filename_n < cells_filenames.n_elements;
+         ++filename_n)
+    {
+      un_allocate(cells_filenames[filename_n]);
+    }
+    Array::free_array(rule_filenames);
+    Array::free_array(cells_filenames);
+  }
+
+  return result;
+}
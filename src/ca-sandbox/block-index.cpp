@@ -0,0 +1,269 @@
+#include "ca-sandbox/block-index.h"
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/maths.h"
+#include "engine/assert.h"
+#include "engine/allocate.h"
+#include "engine/my-array.h"
+
+#include "ca-sandbox/cell-blocks.h"
+
+/// @file
+/// @brief  A 2D bucket index of CellBlock positions
+///
+
+
+void
+get_bucket_position(s32vec2 cell_block_position, s32vec2 *bucket_position, u32 *bit_n)
+{
+  *bucket_position = {floor_divide(cell_block_position.x, BLOCK_INDEX_BUCKET_DIM),
+                      floor_divide(cell_block_position.y, BLOCK_INDEX_BUCKET_DIM)};
+
+  s32vec2 position_in_bucket = vec2_subtract(cell_block_position, vec2_multiply(*bucket_position, (s32)BLOCK_INDEX_BUCKET_DIM));
+  *bit_n = (position_in_bucket.y * BLOCK_INDEX_BUCKET_DIM) + position_in_bucket.x;
+}
+
+
+/// Returns the slot the bucket is in, or the empty slot at the end of its hash chain
+BlockIndexBucket **
+get_block_index_bucket_slot(BlockIndex *block_index, s32vec2 bucket_position)
+{
+  u32 bucket_hash = bucket_position.x * 7 + bucket_position.y * 13;
+  bucket_hash %= BLOCK_INDEX_HASHMAP_SIZE;
+
+  BlockIndexBucket **result = block_index->hashmap + bucket_hash;
+
+  while (*result != 0 &&
+         !vec2_eq((*result)->bucket_position, bucket_position))
+  {
+    result = &(*result)->next_bucket;
+  }
+
+  return result;
+}
+
+
+void
+add_to_block_index(BlockIndex *block_index, CellBlock *cell_block)
+{
+  s32vec2 bucket_position;
+  u32 bit_n;
+  get_bucket_position(cell_block->block_position, &bucket_position, &bit_n);
+
+  BlockIndexBucket **bucket_slot = get_block_index_bucket_slot(block_index, bucket_position);
+  if (*bucket_slot == 0)
+  {
+    BlockIndexBucket *bucket = allocate(BlockIndexBucket, 1);
+    bucket->bucket_position = bucket_position;
+    bucket->bucket_n = block_index->buckets.n_elements;
+    Array::add(block_index->buckets, bucket);
+
+    *bucket_slot = bucket;
+  }
+
+  BlockIndexBucket *bucket = *bucket_slot;
+  u64 bit = (u64)1 << bit_n;
+
+  if (!(bucket->occupied & bit))
+  {
+    bucket->occupied |= bit;
+    bucket->n_cell_blocks += 1;
+  }
+  bucket->cell_blocks[bit_n] = cell_block;
+}
+
+
+void
+remove_from_block_index(BlockIndex *block_index, s32vec2 cell_block_position)
+{
+  s32vec2 bucket_position;
+  u32 bit_n;
+  get_bucket_position(cell_block_position, &bucket_position, &bit_n);
+
+  BlockIndexBucket **bucket_slot = get_block_index_bucket_slot(block_index, bucket_position);
+  BlockIndexBucket *bucket = *bucket_slot;
+  u64 bit = (u64)1 << bit_n;
+
+  if (bucket != 0 &&
+      bucket->occupied & bit)
+  {
+    bucket->occupied &= ~bit;
+    bucket->n_cell_blocks -= 1;
+    bucket->cell_blocks[bit_n] = 0;
+
+    if (bucket->n_cell_blocks == 0)
+    {
+      // Preserve any chain
+      *bucket_slot = bucket->next_bucket;
+
+      Array::remove(block_index->buckets, bucket->bucket_n);
+      if (bucket->bucket_n < block_index->buckets.n_elements)
+      {
+        block_index->buckets[bucket->bucket_n]->bucket_n = bucket->bucket_n;
+      }
+
+      un_allocate(bucket);
+    }
+  }
+}
+
+
+/// Returns the bits of a bucket's occupied mask which are inside the range of CellBlock%s
+u64
+get_bucket_range_mask(s32vec2 bucket_position, s32vec2 start_block, s32vec2 end_block)
+{
+  s32vec2 bucket_start = vec2_multiply(bucket_position, (s32)BLOCK_INDEX_BUCKET_DIM);
+
+  s32vec2 start = vec2_max(vec2_subtract(start_block, bucket_start), (s32vec2){0, 0});
+  s32vec2 end = vec2_min(vec2_subtract(end_block, bucket_start), (s32vec2){BLOCK_INDEX_BUCKET_DIM - 1, BLOCK_INDEX_BUCKET_DIM - 1});
+
+  u64 row_mask = ((u64)1 << (end.x + 1)) - ((u64)1 << start.x);
+
+  u64 result = 0;
+  for (s32 y = start.y;
+       y <= end.y;
+       ++y)
+  {
+    result |= row_mask << (y * BLOCK_INDEX_BUCKET_DIM);
+  }
+
+  return result;
+}
+
+
+void
+add_bucket_cell_blocks(BlockIndexBucket *bucket, u64 mask, Array::Array<CellBlock *>& result)
+{
+  u64 occupied = bucket->occupied & mask;
+
+  while (occupied != 0)
+  {
+    u32 bit_n = __builtin_ctzll(occupied);
+    Array::add(result, bucket->cell_blocks[bit_n]);
+
+    occupied &= occupied - 1;
+  }
+}
+
+
+/// Appends the CellBlock%s with positions between start_block and end_block inclusive to result.
+///
+/// Either looks up every bucket overlapping the range or checks every bucket in the index,
+///   whichever is fewer.
+void
+get_cell_blocks_in_range(BlockIndex *block_index, s32vec2 start_block, s32vec2 end_block, Array::Array<CellBlock *>& result)
+{
+  if (start_block.x <= end_block.x &&
+      start_block.y <= end_block.y)
+  {
+    s32vec2 start_bucket = {floor_divide(start_block.x, BLOCK_INDEX_BUCKET_DIM), floor_divide(start_block.y, BLOCK_INDEX_BUCKET_DIM)};
+    s32vec2 end_bucket = {floor_divide(end_block.x, BLOCK_INDEX_BUCKET_DIM), floor_divide(end_block.y, BLOCK_INDEX_BUCKET_DIM)};
+
+    u64 n_buckets_in_range = (u64)(end_bucket.x - start_bucket.x + 1) * (u64)(end_bucket.y - start_bucket.y + 1);
+
+    if (n_buckets_in_range <= block_index->buckets.n_elements)
+    {
+      s32vec2 bucket_position;
+      for (bucket_position.y = start_bucket.y;
+           bucket_position.y <= end_bucket.y;
+           ++bucket_position.y)
+      {
+        for (bucket_position.x = start_bucket.x;
+             bucket_position.x <= end_bucket.x;
+             ++bucket_position.x)
+        {
+          BlockIndexBucket *bucket = *get_block_index_bucket_slot(block_index, bucket_position);
+          if (bucket != 0)
+          {
+            add_bucket_cell_blocks(bucket, get_bucket_range_mask(bucket_position, start_block, end_block), result);
+          }
+        }
+      }
+    }
+    else
+    {
+      for (u32 bucket_n = 0;
+           bucket_n < block_index->buckets.n_elements;
+           ++bucket_n)
+      {
+        BlockIndexBucket *bucket = block_index->buckets[bucket_n];
+        s32vec2 bucket_position = bucket->bucket_position;
+
+        if (bucket_position.x >= start_bucket.x &&
+            bucket_position.y >= start_bucket.y &&
+            bucket_position.x <= end_bucket.x &&
+            bucket_position.y <= end_bucket.y)
+        {
+          add_bucket_cell_blocks(bucket, get_bucket_range_mask(bucket_position, start_block, end_block), result);
+        }
+      }
+    }
+  }
+}
+
+
+/// Finds the lowest and highest CellBlock positions in the index, from the occupancy of each
+///   bucket.
+///
+/// @returns  false if the index is empty
+b32
+get_block_index_bounds(BlockIndex *block_index, s32vec2 *lowest_block, s32vec2 *highest_block)
+{
+  b32 result = block_index->buckets.n_elements > 0;
+
+  for (u32 bucket_n = 0;
+       bucket_n < block_index->buckets.n_elements;
+       ++bucket_n)
+  {
+    BlockIndexBucket *bucket = block_index->buckets[bucket_n];
+
+    // OR the rows together for the occupied columns
+    u64 columns = bucket->occupied;
+    columns |= columns >> 32;
+    columns |= columns >> 16;
+    columns |= columns >> 8;
+    columns &= 0xFF;
+
+    s32vec2 bucket_start = vec2_multiply(bucket->bucket_position, (s32)BLOCK_INDEX_BUCKET_DIM);
+
+    s32vec2 bucket_lowest = {bucket_start.x + __builtin_ctzll(columns),
+                             bucket_start.y + (s32)(__builtin_ctzll(bucket->occupied) / BLOCK_INDEX_BUCKET_DIM)};
+    s32vec2 bucket_highest = {bucket_start.x + (63 - __builtin_clzll(columns)),
+                              bucket_start.y + (s32)((63 - __builtin_clzll(bucket->occupied)) / BLOCK_INDEX_BUCKET_DIM)};
+
+    if (bucket_n == 0)
+    {
+      *lowest_block = bucket_lowest;
+      *highest_block = bucket_highest;
+    }
+    else
+    {
+      *lowest_block = vec2_min(*lowest_block, bucket_lowest);
+      *highest_block = vec2_max(*highest_block, bucket_highest);
+    }
+  }
+
+  return result;
+}
+
+
+void
+destroy_block_index(BlockIndex *block_index)
+{
+  for (u32 bucket_n = 0;
+       bucket_n < block_index->buckets.n_elements;
+       ++bucket_n)
+  {
+    un_allocate(block_index->buckets[bucket_n]);
+  }
+
+  Array::free_array(block_index->buckets);
+
+  for (u32 slot_n = 0;
+       slot_n < BLOCK_INDEX_HASHMAP_SIZE;
+       ++slot_n)
+  {
+    block_index->hashmap[slot_n] = 0;
+  }
+}
@@ -15,6 +15,7 @@
 #include "engine/opengl-general-buffers.h"
 #include "engine/colour.h"
 #include "engine/drawing.h"
+#include "engine/profiler.h"
 
 #include "ca-sandbox/cell-blocks.h"
 #include "ca-sandbox/load-universe.h"
@@ -26,6 +27,9 @@
 #include "ca-sandbox/cells-editor.h"
 #include "ca-sandbox/save-universe.h"
 #include "ca-sandbox/save-rule-config.h"
+#include "ca-sandbox/compiled-rule.h"
+#include "ca-sandbox/file-loading-thread.h"
+#include "ca-sandbox/checkpoint.h"
 #include "ca-sandbox/minimap.h"
 #include "ca-sandbox/main-gui.h"
 
@@ -54,6 +58,14 @@ const r32 INITIAL_SIM_FREQUENCY = 30;
 #endif
 
 
+/// The number of simulation steps between checkpoints, when checkpointing is enabled.
+const s32 INITIAL_CHECKPOINT_INTERVAL = 100;
+
+
+/// The length of time shown in the profiler timeline, in milliseconds.
+const r32 INITIAL_PROFILER_TIMELINE_LENGTH = 100;
+
+
 /// @brief Compile all the OpenGL shaders used in the program.
 ///
 /// TODO: Shader compilation should probably be moved to the locations where the shaders are used.
@@ -126,6 +138,9 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
   GeneralIndexBuffer *general_index_buffer = &state->general_index_buffer;
 
   CellInstancing *cell_instancing = &state->cell_instancing;
+  CellInstanceCache *cell_instance_cache = &state->cell_instance_cache;
+  CellTextureDrawing *cell_texture_drawing = &state->cell_texture_drawing;
+  CellLOD *cell_lod = &state->cell_lod;
   CellDrawing *cell_drawing = &state->cell_drawing;
 
   SimulateOptions *simulate_options = &state->simulate_options;
@@ -138,11 +153,14 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
   CellRegions *cell_regions = &state->cell_regions;
   CellRegionsUI *cell_regions_ui = &state->cell_regions_ui;
   RuleCreationThread *rule_creation_thread = &state->rule_creation_thread;
+  FileLoadingThread *rule_loading_thread = &state->rule_loading_thread;
+  FileLoadingThread *cells_loading_thread = &state->cells_loading_thread;
   ViewPanning *view_panning = &state->view_panning;
   CellSelectionsUI *cell_selections_ui = &state->cell_selections_ui;
   CellTools *cell_tools = &state->cell_tools;
   ScreenShader *screen_shader = &state->screen_shader;
   FilesLoadedState *files_loaded_state = &state->files_loaded_state;
+  CheckpointWriter *checkpoint_writer = &state->checkpoint_writer;
 
   if (state->init)
   {
@@ -191,11 +209,18 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
     {
       result.success &= init_cell_drawing_shaders(cell_drawing);
       init_cell_drawing(cell_drawing, cell_instancing, general_vertex_buffer, general_index_buffer);
+      init_cell_instance_cache(cell_instance_cache, cell_instancing);
+
+      // Falls back to the CellInstanceCache if unavailable
+      init_cell_texture_drawing(cell_texture_drawing, cell_instancing);
+
+      init_cell_lod(cell_lod, cell_instancing);
     }
 
     // Minimap
     {
       state->minimap_framebuffer = create_minimap_framebuffer();
+      init_minimap_cache(&state->minimap_cache, cell_instancing);
       state->rendered_texture_uniform = glGetUniformLocation(state->texture_shader_program, "rendered_texture");
     }
 
@@ -224,6 +249,9 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
     setup_imgui_style();
 
     simulation_ui->sim_frequency = INITIAL_SIM_FREQUENCY;
+    simulation_ui->checkpoint_interval = INITIAL_CHECKPOINT_INTERVAL;
+    state->profiler_ui.timeline_length_ms = INITIAL_PROFILER_TIMELINE_LENGTH;
+    strcpy(state->profiler_ui.export_filename, "profile.json");
     view_panning->scale = 0.3;
     state->left_side_bar_open = true;
     state->right_side_bar_open = true;
@@ -234,6 +262,8 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
   b32 running = true;
   while (running && result.success && !result.reload)
   {
+    PROFILE_SCOPE("frame");
+
     //
     // Process inputs
     //
@@ -311,8 +341,10 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
     // Draw imGui elements
     //
 
-
-    do_main_gui(state, window_size);
+    {
+      PROFILE_SCOPE("main gui");
+      do_main_gui(state, window_size);
+    }
 
     update_cell_regions(cell_regions_ui, cell_regions, cell_selections_ui, state->universe, state->minimap_framebuffer, cell_drawing, cell_instancing, general_vertex_buffer, mouse_universe_pos, &mouse_click_consumed);
 
@@ -338,7 +370,32 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
     if (rule_ui->save_rule_file)
     {
       rule_ui->save_rule_file = false;
-      result.success &= save_rule_config_to_file(rule_ui->file_picker.selected_file.elements, &loaded_rule->config);
+
+      char *saving_file_name = dynamic_string_to_heap(rule_ui->file_picker.selected_file);
+
+      if (is_compiled_rule_filename(saving_file_name))
+      {
+        result.success &= save_compiled_rule_file(saving_file_name, loaded_rule);
+      }
+      else
+      {
+        result.success &= save_rule_config_to_file(saving_file_name, &loaded_rule->config);
+      }
+
+      un_allocate(saving_file_name);
+    }
+
+    if (rule_ui->save_compiled_rule_file)
+    {
+      rule_ui->save_compiled_rule_file = false;
+
+      char *rule_file_name = dynamic_string_to_heap(rule_ui->file_picker.selected_file);
+
+      char compiled_rule_file_name[FILE_NAME_LIMIT + 16];
+      get_compiled_rule_filename(rule_file_name, compiled_rule_file_name, array_count(compiled_rule_file_name));
+      result.success &= save_compiled_rule_file(compiled_rule_file_name, loaded_rule);
+
+      un_allocate(rule_file_name);
     }
 
     //
@@ -369,30 +426,43 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
         printf("Error: no filename selected\n");
         assert(0);
       }
-      else
+      else if (!rule_loading_thread->currently_running && !rule_loading_thread->finished)
       {
         files_loaded_state->load_rule_file = false;
-        files_loaded_state->rule_file_loaded = true;
 
         char *loading_file_name = dynamic_string_to_heap(rule_ui->file_picker.selected_file);
+        start_rule_loading_thread(rule_loading_thread, loading_file_name);
+        un_allocate(loading_file_name);
+      }
+    }
 
-        print("\nLoading rule file: %s\n", loading_file_name);
-        result.success &= load_rule_file(loading_file_name, &loaded_rule->config);
-        print("\n");
+    // The loaded rule is swapped in once nothing else is using the current rule
+    if (rule_loading_thread->finished &&
+        !rule_creation_thread->currently_running &&
+        !cells_loading_thread->currently_running)
+    {
+      finish_file_loading_thread(rule_loading_thread);
+      print("\n");
 
-        un_allocate(loading_file_name);
+      result.success &= rule_loading_thread->success;
+      if (rule_loading_thread->success)
+      {
+        swap_in_loaded_rule(rule_loading_thread, loaded_rule);
+        files_loaded_state->rule_file_loaded = true;
 
-        start_build_rule_tree_thread(rule_creation_thread, loaded_rule);
+        if (!loaded_rule->rule_tree_built)
+        {
+          start_build_rule_tree_thread(rule_creation_thread, loaded_rule);
+        }
       }
     }
 
-
     if (files_loaded_state->load_cells_file)
     {
-      files_loaded_state->load_cells_file = false;
-
       if (universe_ui->new_universe_ui.create_new_universe)
       {
+        files_loaded_state->load_cells_file = false;
+
         char *loading_file_name = dynamic_string_to_heap(universe_ui->new_universe_ui.directory_picker.selected_file);
 
         if (state->universe)
@@ -418,56 +488,71 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
 
         strcpy(universe_ui->loaded_file_name, loading_file_name);
         un_allocate(loading_file_name);
+
+        centre_universe(view_panning, state->universe, window_size);
       }
-      else
+      else if (!cells_loading_thread->currently_running && !cells_loading_thread->finished &&
+               !rule_loading_thread->currently_running && !rule_loading_thread->finished)
       {
+        // The .cells file is read using the named states from the rule, so wait for any rule
+        //   loading to finish first.
+
+        files_loaded_state->load_cells_file = false;
+
         simulation_ui->simulating = false;
         simulation_ui->mode = Mode::Editor;
 
-        *simulate_options = default_simulation_options();
-        Array::clear(cell_initialisation_options->set_of_initial_states);
-        default_cell_initialisation_options(cell_initialisation_options);
-
         char *loading_file_name = dynamic_string_to_heap(universe_ui->cells_file_picker.selected_file);
+        start_cells_loading_thread(cells_loading_thread, loading_file_name, &loaded_rule->config.named_states);
+        un_allocate(loading_file_name);
+      }
+    }
+
+    if (cells_loading_thread->finished)
+    {
+      finish_file_loading_thread(cells_loading_thread);
 
-        universe_ui->loading_error_message.n_elements = 0;
-        Universe *new_universe = load_universe(loading_file_name, simulate_options, cell_initialisation_options, &loaded_rule->config.named_states, universe_ui->loading_error_message);
+      Universe *new_universe = cells_loading_thread->loaded_universe;
+      cells_loading_thread->loaded_universe = 0;
 
-        if (new_universe == 0)
-        {
-          universe_ui->loading_error = true;
-        }
-        else if (loaded_rule->config.neighbourhood_region_size >= new_universe->cell_block_dim)
-        {
-          universe_ui->loading_error = true;
-          append_string(universe_ui->loading_error_message, new_string("cell_block_dim is too small for the current neighbourhood_region_size.\n"));
-        }
+      universe_ui->loading_error_message.n_elements = 0;
+      Array::add(universe_ui->loading_error_message, cells_loading_thread->error_message);
+
+      if (new_universe == 0)
+      {
+        universe_ui->loading_error = true;
+      }
+      else if (loaded_rule->config.neighbourhood_region_size >= new_universe->cell_block_dim)
+      {
+        universe_ui->loading_error = true;
+        append_string(universe_ui->loading_error_message, new_string("cell_block_dim is too small for the current neighbourhood_region_size.\n"));
 
-        if (universe_ui->loading_error)
+        destroy_cell_hashmap(new_universe);
+        un_allocate(new_universe);
+      }
+
+      if (universe_ui->loading_error)
+      {
+        print("%.*s\n", universe_ui->loading_error_message.n_elements, universe_ui->loading_error_message.elements);
+      }
+      else
+      {
+        // Successfully loaded new_universe!
+        if (state->universe)
         {
-          print("%.*s\n", universe_ui->loading_error_message.n_elements, universe_ui->loading_error_message.elements);
+          destroy_cell_hashmap(state->universe);
+          un_allocate(state->universe);
+          state->universe = 0;
         }
-        else
-        {
-          // Successfully loaded new_universe!
-          if (state->universe)
-          {
-            destroy_cell_hashmap(state->universe);
-            un_allocate(state->universe);
-            state->universe = 0;
-          }
 
-          state->universe = new_universe;
-          universe_ui->edited_cell_block_dim = state->universe->cell_block_dim;
+        state->universe = new_universe;
+        universe_ui->edited_cell_block_dim = state->universe->cell_block_dim;
 
-          strcpy(universe_ui->loaded_file_name, loading_file_name);
-        }
+        *simulate_options = cells_loading_thread->simulate_options;
+        copy_cell_initialisation_options(cell_initialisation_options, &cells_loading_thread->cell_initialisation_options);
 
-        un_allocate(loading_file_name);
-      }
+        snprintf(universe_ui->loaded_file_name, array_count(universe_ui->loaded_file_name), "%s", cells_loading_thread->filename);
 
-      if (!universe_ui->loading_error)
-      {
         centre_universe(view_panning, state->universe, window_size);
       }
 
@@ -480,6 +565,29 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
 
     if (simulation_ui->mode == Mode::Simulator)
     {
+      if (simulation_ui->restore_checkpoint && state->universe != 0)
+      {
+        simulation_ui->restore_checkpoint = false;
+        wait_for_checkpoint_writer(checkpoint_writer);
+
+        u64 restored_step = 0;
+        u64 restored_log_size = 0;
+        Universe *restored_universe = restore_universe_from_checkpoint_log(checkpoint_writer->filename, simulation_ui->restore_checkpoint_step, &restored_step, &restored_log_size);
+
+        if (restored_universe != 0)
+        {
+          destroy_cell_hashmap(state->universe);
+          un_allocate(state->universe);
+
+          state->universe = restored_universe;
+          universe_ui->edited_cell_block_dim = state->universe->cell_block_dim;
+          simulation_ui->simulation_step = restored_step;
+
+          resume_checkpoint_log(checkpoint_writer, state->universe, restored_log_size, restored_step);
+          simulation_ui->start_new_checkpoint_log = false;
+        }
+      }
+
       u32 n_simulation_steps = 0;
 
       if (simulation_ui->step_simulation)
@@ -500,6 +608,8 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
 
       if (n_simulation_steps > 0)
       {
+        PROFILE_SCOPE("simulation steps");
+
         u64 start_sim_time = get_us();
 
         for (u32 simulation_step = 0;
@@ -522,6 +632,38 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
                                                               (simulation_ui->simulation_delta_cumulative_average_n + n_simulation_steps));
         simulation_ui->simulation_delta_cumulative_average_n += n_simulation_steps;
       }
+
+      if (simulation_ui->checkpointing && state->universe != 0)
+      {
+        char checkpoint_filename[FILE_NAME_LIMIT + 16];
+        snprintf(checkpoint_filename, array_count(checkpoint_filename), "%s.checkpoint", universe_ui->loaded_file_name);
+
+        // Loading a cells file, creating a new Universe, or changing the cell_block_dim all need a
+        //   new log, the existing log's records can't be replayed onto the new Universe.
+        b32 universe_changed = (checkpoint_writer->universe_generation != state->universe->generation ||
+                                checkpoint_writer->cell_block_dim != state->universe->cell_block_dim ||
+                                strcmp(checkpoint_writer->filename, checkpoint_filename) != 0);
+
+        if (simulation_ui->start_new_checkpoint_log || !checkpoint_writer->log_started || universe_changed)
+        {
+          simulation_ui->start_new_checkpoint_log = false;
+
+          if (start_checkpoint_log(checkpoint_writer, checkpoint_filename, state->universe))
+          {
+            checkpoint_universe(checkpoint_writer, state->universe, simulation_ui->simulation_step);
+          }
+          else
+          {
+            simulation_ui->checkpointing = false;
+          }
+        }
+        else if (simulation_ui->simulation_step >= checkpoint_writer->last_checkpoint_step + simulation_ui->checkpoint_interval)
+        {
+          // If the previous checkpoint is still being written this does nothing, and is retried
+          //   next frame.
+          checkpoint_universe(checkpoint_writer, state->universe, simulation_ui->simulation_step);
+        }
+      }
     }
     else if (simulation_ui->mode == Mode::Editor)
     {
@@ -546,20 +688,61 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
 
     if (files_loaded_state->cells_file_loaded && state->universe != 0)
     {
-      upload_cell_instances(state->universe, simulate_options->border, cell_instancing);
-
       // Main view
-      draw_cell_blocks(state->universe, cell_instancing, cell_drawing, general_vertex_buffer, view_panning->projection_matrix);
+      b32 draw_cells_as_textures = universe_ui->draw_cells_as_textures && cell_texture_drawing->available;
+
+      s32vec2 visible_start_block;
+      s32vec2 visible_end_block;
+      get_visible_cell_blocks(view_panning, &visible_start_block, &visible_end_block);
+
+      // Zoomed out far enough for cells to be smaller than a pixel
+      s32 lod_level = get_cell_lod_level(state->universe->cell_block_dim, get_pixels_per_cell_block(view_panning, window_size));
+      {
+        PROFILE_SCOPE("update cell LOD");
+        update_cell_lod(cell_lod, state->universe, &loaded_rule->config, lod_level);
+      }
+
+      if (lod_level >= 0)
+      {
+        PROFILE_SCOPE("draw cell LOD");
+        upload_cell_lod_instances(cell_lod, lod_level, visible_start_block, visible_end_block);
+        draw_cell_instances_scaled(&cell_lod->instancing, cell_drawing, general_vertex_buffer, view_panning->projection_matrix, 1, 1 << lod_level);
+      }
+      else if (draw_cells_as_textures)
+      {
+        {
+          PROFILE_SCOPE("update cell textures");
+          update_cell_texture_drawing(cell_texture_drawing, state->universe, simulate_options->border, visible_start_block, visible_end_block);
+        }
+        {
+          PROFILE_SCOPE("draw cell textures");
+          draw_cell_textures(cell_texture_drawing, general_vertex_buffer, general_index_buffer, view_panning->projection_matrix);
+        }
+      }
+      else
+      {
+        {
+          PROFILE_SCOPE("update cell instance cache");
+          update_cell_instance_cache(cell_instance_cache, state->universe, simulate_options->border, visible_start_block, visible_end_block);
+        }
+        {
+          PROFILE_SCOPE("draw cell blocks");
+          draw_cell_blocks(state->universe, &cell_instance_cache->instancing, cell_drawing, general_vertex_buffer, view_panning->projection_matrix);
+        }
+      }
 
       // Minimap
       {
+        PROFILE_SCOPE("minimap");
+
         if (vec2_eq(state->minimap_texture_size, {0, 0}))
         {
           state->minimap_texture_size = {300, 300};
           state->minimap_texture = create_minimap_texture(state->minimap_texture_size, state->minimap_framebuffer);
         }
 
-        draw_minimap_texture(state->universe, cell_instancing, cell_drawing, general_vertex_buffer, state->minimap_framebuffer, state->minimap_texture, state->minimap_texture_size);
+        // The minimap shows every CellBlock, so only redraws the ones which changed since last frame
+        update_minimap_texture(&state->minimap_cache, state->universe, simulate_options->border, cell_drawing, general_vertex_buffer, state->minimap_framebuffer, state->minimap_texture, state->minimap_texture_size);
         opengl_print_errors();
 
         ImTextureID tex_id = (void *)(intptr_t)state->minimap_texture;
@@ -771,14 +954,28 @@ main_loop(int argc, const char *argv[], Engine *engine, CA_SandboxState **state_
     // imGUI Rendering
     //
 
-    ImGui::Render();
-    engine_swap_buffers(engine);
+    {
+      PROFILE_SCOPE("imgui render");
+      ImGui::Render();
+    }
+    {
+      PROFILE_SCOPE("swap buffers");
+      engine_swap_buffers(engine);
+    }
 
     engine_frame_end(frame_timing);
   }
 
+  if (result.reload)
+  {
+    // The event names are string literals in this library, which is about to be unloaded
+    clear_profiler(&global_profiler);
+  }
+
   if (!result.reload)
   {
+    destroy_checkpoint_writer(checkpoint_writer);
+
     ImGui_ImplSdlGL3_Shutdown();
     ImGui::DestroyContext();
   }
@@ -1,6 +1,7 @@
 #include "ca-sandbox/cell-block-coordinate-system.h"
 
 #include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/block-index.h"
 
 /// @file
 /// @brief  Functions for managing CellBlock and Cell coordinates
@@ -278,51 +279,15 @@ quantise_0to1_cell_position(vec2& continuous, u32 cell_block_dim)
 }
 
 
+/// Finds the lowest and highest CellBlock positions in use, from the block_index.  Both are {0, 0}
+///   if there are no CellBlock%s.
 void
 get_cell_blocks_dimentions(CellBlocks *cell_blocks, s32vec2 *lowest_coords, s32vec2 *highest_coords)
 {
   *lowest_coords = {};
   *highest_coords = {};
 
-  b32 first_block_found = false;
-  for (u32 cell_block_slot = 0;
-       cell_block_slot < cell_blocks->hashmap_size;
-       ++cell_block_slot)
-  {
-    CellBlock *cell_block = cell_blocks->hashmap[cell_block_slot];
-
-    while (cell_block != 0)
-    {
-      if (!first_block_found)
-      {
-        first_block_found = true;
-        *lowest_coords = cell_block->block_position;
-        *highest_coords = cell_block->block_position;
-      }
-      else
-      {
-        if (cell_block->block_position.x < lowest_coords->x)
-        {
-          lowest_coords->x = cell_block->block_position.x;
-        }
-        else if (cell_block->block_position.x > highest_coords->x)
-        {
-          highest_coords->x = cell_block->block_position.x;
-        }
-
-        if (cell_block->block_position.y < lowest_coords->y)
-        {
-          lowest_coords->y = cell_block->block_position.y;
-        }
-        else if (cell_block->block_position.y > highest_coords->y)
-        {
-          highest_coords->y = cell_block->block_position.y;
-        }
-      }
-
-      cell_block = cell_block->next_block;
-    }
-  }
+  get_block_index_bounds(cell_blocks->block_index, lowest_coords, highest_coords);
 }
 
 
@@ -0,0 +1,165 @@
+#include "ca-sandbox/cell-block-slots.h"
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/my-array.h"
+
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/block-index.h"
+
+#include <string.h>
+
+/// @file
+/// @brief  Tracks which visible CellBlock%s have a slot in a renderer's GPU storage
+///
+
+
+b32
+borders_equal(Border a, Border b)
+{
+  b32 result = (a.type == b.type &&
+                vec2_eq(a.min_corner_block, b.min_corner_block) &&
+                vec2_eq(a.min_corner_cell, b.min_corner_cell) &&
+                vec2_eq(a.max_corner_block, b.max_corner_block) &&
+                vec2_eq(a.max_corner_cell, b.max_corner_cell));
+  return result;
+}
+
+
+/// Frees the slot, moving the last slot into its place so the slots stay contiguous
+void
+remove_cell_block_slot(CellBlockSlots *cell_block_slots, u32 slot_n)
+{
+  u32 n_cells = cell_block_slots->cell_block_dim * cell_block_slots->cell_block_dim;
+  u32 last_slot_n = cell_block_slots->slots.n_elements - 1;
+
+  if (slot_n != last_slot_n)
+  {
+    // The slots are freed from the end, so the last slot is visible and its CellBlock exists
+    CellBlockSlot& moved_slot = cell_block_slots->slots[last_slot_n];
+    moved_slot.cell_block->drawing_slot = slot_n + 1;
+
+    if (!moved_slot.new_slot)
+    {
+      CellBlockSlotMove move = {.from_slot_n = last_slot_n, .to_slot_n = slot_n};
+      Array::add(cell_block_slots->moves, move);
+
+      memcpy(cell_block_slots->uploaded_states.elements + (slot_n * n_cells),
+             cell_block_slots->uploaded_states.elements + (last_slot_n * n_cells),
+             n_cells * sizeof(CellState));
+    }
+  }
+
+  Array::remove(cell_block_slots->slots, slot_n);
+  cell_block_slots->uploaded_states.n_elements -= n_cells;
+}
+
+
+/// @brief Updates the slots for the CellBlock%s between start_block and end_block inclusive,
+///          normally the blocks visible in a view.
+///
+/// Blocks outside the range lose their slots, and the slots of blocks whose cell_states changed
+///   are added to slots_to_upload, so the upload cost scales with the visible cells which changed.
+///
+void
+update_cell_block_slots(CellBlockSlots *cell_block_slots, Universe *universe, Border border, s32vec2 start_block, s32vec2 end_block)
+{
+  u32 cell_block_dim = universe->cell_block_dim;
+  u32 n_cells = cell_block_dim * cell_block_dim;
+
+  Array::clear(cell_block_slots->moves);
+  Array::clear(cell_block_slots->slots_to_upload);
+
+  b32 upload_all = false;
+  if (cell_block_slots->cell_block_dim != cell_block_dim)
+  {
+    // Slot sizes have changed, start again
+    Array::clear(cell_block_slots->slots);
+    Array::clear(cell_block_slots->uploaded_states);
+    cell_block_slots->cell_block_dim = cell_block_dim;
+  }
+  if (!borders_equal(cell_block_slots->border, border))
+  {
+    cell_block_slots->border = border;
+    upload_all = true;
+  }
+
+  for (u32 slot_n = 0;
+       slot_n < cell_block_slots->slots.n_elements;
+       ++slot_n)
+  {
+    cell_block_slots->slots[slot_n].visible = false;
+    cell_block_slots->slots[slot_n].new_slot = false;
+  }
+
+  Array::Array<CellBlock *> visible_cell_blocks = {};
+  get_cell_blocks_in_range(universe->block_index, start_block, end_block, visible_cell_blocks);
+
+  for (u32 cell_block_n = 0;
+       cell_block_n < visible_cell_blocks.n_elements;
+       ++cell_block_n)
+  {
+    CellBlock *cell_block = visible_cell_blocks[cell_block_n];
+
+    u32 slot_n = cell_block->drawing_slot - 1;
+    b32 has_slot = (cell_block->drawing_slot != 0 &&
+                    slot_n < cell_block_slots->slots.n_elements &&
+                    cell_block_slots->slots[slot_n].cell_block == cell_block);
+
+    if (!has_slot)
+    {
+      slot_n = cell_block_slots->slots.n_elements;
+
+      CellBlockSlot& slot = Array::new_element(cell_block_slots->slots);
+      slot.cell_block = cell_block;
+      slot.new_slot = true;
+      Array::add_n(cell_block_slots->uploaded_states, n_cells);
+
+      cell_block->drawing_slot = slot_n + 1;
+    }
+
+    cell_block_slots->slots[slot_n].visible = true;
+  }
+
+  // Free the slots of blocks which are no longer visible, or no longer exist
+  for (s32 slot_n = cell_block_slots->slots.n_elements - 1;
+       slot_n >= 0;
+       --slot_n)
+  {
+    if (!cell_block_slots->slots[slot_n].visible)
+    {
+      remove_cell_block_slot(cell_block_slots, slot_n);
+    }
+  }
+
+  for (u32 slot_n = 0;
+       slot_n < cell_block_slots->slots.n_elements;
+       ++slot_n)
+  {
+    CellBlockSlot& slot = cell_block_slots->slots[slot_n];
+    CellState *uploaded_states = cell_block_slots->uploaded_states.elements + (slot_n * n_cells);
+
+    if (upload_all ||
+        slot.new_slot ||
+        memcmp(uploaded_states, slot.cell_block->cell_states, n_cells * sizeof(CellState)) != 0)
+    {
+      memcpy(uploaded_states, slot.cell_block->cell_states, n_cells * sizeof(CellState));
+      Array::add(cell_block_slots->slots_to_upload, slot_n);
+    }
+  }
+}
+
+
+/// Adds every slot to slots_to_upload, for when the renderer's stored slot data was lost
+void
+upload_all_cell_block_slots(CellBlockSlots *cell_block_slots)
+{
+  Array::clear(cell_block_slots->slots_to_upload);
+
+  for (u32 slot_n = 0;
+       slot_n < cell_block_slots->slots.n_elements;
+       ++slot_n)
+  {
+    Array::add(cell_block_slots->slots_to_upload, slot_n);
+  }
+}
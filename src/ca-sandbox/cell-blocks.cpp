@@ -6,6 +6,8 @@
 #include "engine/allocate.h"
 
 #include "ca-sandbox/cell.h"
+#include "ca-sandbox/dense-grid.h"
+#include "ca-sandbox/block-index.h"
 
 #include <string.h>
 
@@ -14,6 +16,10 @@
 ///
 
 
+/// The last CellBlocks::generation given out, universes can be loaded on other threads
+u64 global_cell_blocks_generation = 0;
+
+
 /// Initialise the cell_blocks
 ///
 /// Sets the hashmap_size to INITIAL_CELL_HASHMAP_SIZE, and allocates the hashmap.
@@ -21,12 +27,21 @@
 void
 init_cell_hashmap(CellBlocks *cell_blocks)
 {
+  cell_blocks->generation = __sync_add_and_fetch(&global_cell_blocks_generation, 1);
+
   cell_blocks->cell_block_dim = DEFAULT_CELL_BLOCK_DIM;
   cell_blocks->hashmap_size = INITIAL_CELL_HASHMAP_SIZE;
   cell_blocks->hashmap = allocate(CellBlock *, cell_blocks->hashmap_size);
   memset(cell_blocks->hashmap, 0, cell_blocks->hashmap_size * sizeof(CellBlock *));
 
   cell_blocks->n_cell_blocks_in_use = 0;
+  cell_blocks->dense_grid = 0;
+
+  cell_blocks->halo_tile = 0;
+  cell_blocks->halo_tile_size = 0;
+
+  cell_blocks->block_index = allocate(BlockIndex, 1);
+  *cell_blocks->block_index = {};
 }
 
 
@@ -56,6 +71,27 @@ destroy_cell_hashmap(CellBlocks *cell_blocks)
     un_allocate(cell_blocks->hashmap);
     cell_blocks->hashmap = 0;
   }
+
+  if (cell_blocks->dense_grid != 0)
+  {
+    destroy_dense_grid(cell_blocks->dense_grid);
+    un_allocate(cell_blocks->dense_grid);
+    cell_blocks->dense_grid = 0;
+  }
+
+  if (cell_blocks->halo_tile != 0)
+  {
+    un_allocate(cell_blocks->halo_tile);
+    cell_blocks->halo_tile = 0;
+    cell_blocks->halo_tile_size = 0;
+  }
+
+  if (cell_blocks->block_index != 0)
+  {
+    destroy_block_index(cell_blocks->block_index);
+    un_allocate(cell_blocks->block_index);
+    cell_blocks->block_index = 0;
+  }
 }
 
 
@@ -197,6 +233,7 @@ create_cell_block(CellBlocks *cell_blocks, CellInitialisationOptions *cell_initi
   if (*cell_block_slot == 0)
   {
     *cell_block_slot = allocate_cell_block(cell_blocks, search_cell_block_position);
+    add_to_block_index(cell_blocks->block_index, *cell_block_slot);
     result = *cell_block_slot;
 
     init_cells(cell_blocks, cell_initialisation_options, result, search_cell_block_position);
@@ -222,6 +259,7 @@ create_uninitialised_cell_block(CellBlocks *cell_blocks, s32vec2 search_cell_blo
   if (*cell_block_slot == 0)
   {
     *cell_block_slot = allocate_cell_block(cell_blocks, search_cell_block_position);
+    add_to_block_index(cell_blocks->block_index, *cell_block_slot);
     cell_blocks->n_cell_blocks_in_use += 1;
     result = *cell_block_slot;
   }
@@ -240,6 +278,7 @@ get_or_create_uninitialised_cell_block(CellBlocks *cell_blocks, s32vec2 search_c
   if (*cell_block_slot == 0)
   {
     *cell_block_slot = allocate_cell_block(cell_blocks, search_cell_block_position);
+    add_to_block_index(cell_blocks->block_index, *cell_block_slot);
     cell_blocks->n_cell_blocks_in_use += 1;
   }
 
@@ -268,6 +307,7 @@ get_or_create_cell_block(CellBlocks *cell_blocks, CellInitialisationOptions *cel
   if (*cell_block_slot == 0)
   {
     *cell_block_slot = allocate_cell_block(cell_blocks, search_cell_block_position);
+    add_to_block_index(cell_blocks->block_index, *cell_block_slot);
     result = *cell_block_slot;
 
     init_cells(cell_blocks, cell_initialisation_options, result, search_cell_block_position);
@@ -317,6 +357,7 @@ delete_cell_block(CellBlocks *cell_blocks, s32vec2 search_cell_block_position)
   {
     // Preserve any chain
     *cell_block_slot = cell_block->next_block;
+    remove_from_block_index(cell_blocks->block_index, search_cell_block_position);
     un_allocate(cell_block);
   }
 
@@ -340,3 +381,28 @@ get_cell_index_in_block(CellBlocks *cell_blocks, s32vec2 cell_coord)
 
   return result;
 }
+
+
+/// FNV-1a hash of a CellBlock's states, taking a CellState at a time.  Never returns 0, so 0 can be
+///   used to mark a CellBlock as not yet hashed, see CellBlock::checkpoint_hash and
+///   CellBlock::minimap_hash.
+u64
+hash_cell_block_states(CellState *cell_states, u32 n_cells)
+{
+  u64 result = 0xcbf29ce484222325;
+
+  for (u32 cell_n = 0;
+       cell_n < n_cells;
+       ++cell_n)
+  {
+    result ^= cell_states[cell_n];
+    result *= 0x100000001b3;
+  }
+
+  if (result == 0)
+  {
+    result = 1;
+  }
+
+  return result;
+}
@@ -8,12 +8,16 @@
 #include "engine/opengl-buffer.h"
 #include "engine/opengl-shaders.h"
 #include "engine/opengl-general-buffers.h"
+#include "engine/assert.h"
 
 #include "ca-sandbox/cell-blocks.h"
 #include "ca-sandbox/cell-block-coordinate-system.h"
 #include "ca-sandbox/cells-editor.h"
+#include "ca-sandbox/cell-block-slots.h"
+#include "ca-sandbox/named-states.h"
 
 #include <GL/glew.h>
+#include <string.h>
 
 const r32 CELLS_WIDTH = 1;
 
@@ -38,6 +42,13 @@ init_cell_drawing_shaders(CellDrawing *cell_drawing)
 
   success &= create_shader_program(cells_filenames, shader_types, 2, &cell_drawing->shader_program);
 
+  const char *compact_cells_filenames[] = {
+    "shaders/cell-compact-instancing.glvs",
+    "shaders/screen.glfs"
+  };
+
+  success &= create_shader_program(compact_cells_filenames, shader_types, 2, &cell_drawing->compact_shader_program);
+
   return success;
 }
 
@@ -93,12 +104,124 @@ init_cell_drawing(CellDrawing *cell_drawing, CellInstancing *cell_instancing, Op
 
   cell_instancing->cell_general_indices_position = opengl_buffer_add_elements(general_index_buffer, cell_instancing->cell_n_indices, indices);
 
-  create_opengl_buffer(&cell_instancing->buffer, sizeof(CellInstance), GL_ARRAY_BUFFER, GL_STREAM_DRAW);
+  glBindVertexArray(0);
+
+  glGenVertexArrays(1, &cell_drawing->compact_vao);
+  glBindVertexArray(cell_drawing->compact_vao);
+  glBindBuffer(general_vertex_buffer->binding_target, general_vertex_buffer->id);
+  glBindBuffer(general_index_buffer->binding_target, general_index_buffer->id);
+
+  GLuint compact_shader_program = cell_drawing->compact_shader_program;
+  cell_drawing->compact_projection_matrix_uniform = glGetUniformLocation(compact_shader_program, "projection_matrix");
+  cell_drawing->compact_cell_block_dim_uniform = glGetUniformLocation(compact_shader_program, "cell_block_dim");
+  cell_drawing->compact_first_block_uniform = glGetUniformLocation(compact_shader_program, "first_block");
+  cell_drawing->compact_block_positions_uniform = glGetUniformLocation(compact_shader_program, "block_positions");
+  cell_drawing->compact_palette_uniform = glGetUniformLocation(compact_shader_program, "palette");
+
+  cell_drawing->palette_texture = create_state_palette_texture();
+
+  create_compact_cell_instance_buffers(cell_instancing, true);
 
   glBindVertexArray(0);
 }
 
 
+/// Creates a texture of the get_state_colour() colours, so state % get_n_state_colours() can be
+///   looked up in shaders.
+GLuint
+create_state_palette_texture()
+{
+  GLuint result;
+
+  u32 n_colours = get_n_state_colours();
+  Array::Array<vec4> colours = {};
+  for (CellState state = 0;
+       state < n_colours;
+       ++state)
+  {
+    Array::add(colours, get_state_colour(state));
+  }
+
+  glGenTextures(1, &result);
+  glBindTexture(GL_TEXTURE_2D, result);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, n_colours, 1, 0, GL_RGBA, GL_FLOAT, colours.elements);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  Array::free_array(colours);
+
+  opengl_print_errors();
+  return result;
+}
+
+
+/// @brief Creates the buffers of a CellInstancing for CompactCellInstances, replacing any shared
+///          with the CellInstancing it was copied from.
+///
+/// @param[in] streaming  Whether the instances are re-written each time they are drawn, see
+///                         create_opengl_stream_buffer(), or kept between frames.
+///
+void
+create_compact_cell_instance_buffers(CellInstancing *cell_instancing, b32 streaming)
+{
+  assert(get_n_state_colours() < COMPACT_CELL_HIDDEN_STATE);
+
+  cell_instancing->compact = true;
+
+  if (streaming)
+  {
+    create_opengl_stream_buffer(&cell_instancing->buffer, sizeof(CompactCellInstance), GL_ARRAY_BUFFER);
+    create_opengl_stream_buffer(&cell_instancing->block_positions, sizeof(s32vec2), GL_TEXTURE_BUFFER);
+  }
+  else
+  {
+    create_opengl_buffer(&cell_instancing->buffer, sizeof(CompactCellInstance), GL_ARRAY_BUFFER, GL_DYNAMIC_DRAW);
+    create_opengl_buffer(&cell_instancing->block_positions, sizeof(s32vec2), GL_TEXTURE_BUFFER, GL_DYNAMIC_DRAW);
+  }
+
+  glGenTextures(1, &cell_instancing->block_positions_texture);
+
+  opengl_print_errors();
+}
+
+
+/// @brief Switches a CellInstancing made by create_compact_cell_instance_buffers() to
+///          CellInstance%s if the cell_block_dim is too large for CompactCellInstances, and back.
+///
+/// The instance buffer is re-created with the new element size when the format changes.
+///
+/// @returns  true if the instance buffer was re-created, so its contents have been lost.
+///
+b32
+update_cell_instancing_format(CellInstancing *cell_instancing, u32 cell_block_dim)
+{
+  b32 compact = cell_block_dim <= MAX_COMPACT_CELL_BLOCK_DIM;
+  b32 result = compact != cell_instancing->compact;
+
+  if (result)
+  {
+    OpenGL_Buffer *buffer = &cell_instancing->buffer;
+    b32 streaming = buffer->streaming;
+    u32 element_size = compact ? sizeof(CompactCellInstance) : sizeof(CellInstance);
+
+    destroy_opengl_buffer(buffer);
+    if (streaming)
+    {
+      create_opengl_stream_buffer(buffer, element_size, GL_ARRAY_BUFFER);
+    }
+    else
+    {
+      create_opengl_buffer(buffer, element_size, GL_ARRAY_BUFFER, GL_DYNAMIC_DRAW);
+    }
+
+    cell_instancing->compact = compact;
+  }
+
+  return result;
+}
+
+
 /// Setup the attributes used by the instanced cell drawing for the cell-instancing.glvs shader.
 void
 init_cell_instances_buffer_attributes(OpenGL_Buffer *cell_instances_buffer, OpenGL_Buffer *general_vertex_buffer, GLuint cell_instance_drawing_shader_program)
@@ -116,13 +239,16 @@ init_cell_instances_buffer_attributes(OpenGL_Buffer *cell_instances_buffer, Open
 
   glBindBuffer(cell_instances_buffer->binding_target, cell_instances_buffer->id);
 
+  // Streaming buffers are drawn from the start of their current region
+  intptr_t instances_offset = cell_instances_buffer->element_size * cell_instances_buffer->first_element;
+
   GLuint attribute_block_position_x = glGetAttribLocation(cell_instance_drawing_shader_program, "s32_block_position_x");
   if (attribute_block_position_x == -1)
   {
     print("Failed to get attribute_block_position_x\n");
   }
   glEnableVertexAttribArray(attribute_block_position_x);
-  glVertexAttribIPointer(attribute_block_position_x, 1, GL_INT, sizeof(CellInstance), (void *)(offsetof(CellInstance, block_position) + offsetof(s32vec2, x)));
+  glVertexAttribIPointer(attribute_block_position_x, 1, GL_INT, sizeof(CellInstance), (void *)(instances_offset + offsetof(CellInstance, block_position) + offsetof(s32vec2, x)));
   glVertexAttribDivisor(attribute_block_position_x, 1);
 
   GLuint attribute_block_position_y = glGetAttribLocation(cell_instance_drawing_shader_program, "s32_block_position_y");
@@ -131,7 +257,7 @@ init_cell_instances_buffer_attributes(OpenGL_Buffer *cell_instances_buffer, Open
     print("Failed to get attribute_block_position_y\n");
   }
   glEnableVertexAttribArray(attribute_block_position_y);
-  glVertexAttribIPointer(attribute_block_position_y, 1, GL_INT, sizeof(CellInstance), (void *)(offsetof(CellInstance, block_position) + offsetof(s32vec2, y)));
+  glVertexAttribIPointer(attribute_block_position_y, 1, GL_INT, sizeof(CellInstance), (void *)(instances_offset + offsetof(CellInstance, block_position) + offsetof(s32vec2, y)));
   glVertexAttribDivisor(attribute_block_position_y, 1);
 
   GLuint attribute_cell_position = glGetAttribLocation(cell_instance_drawing_shader_program, "cell_position");
@@ -140,7 +266,7 @@ init_cell_instances_buffer_attributes(OpenGL_Buffer *cell_instances_buffer, Open
     print("Failed to get attribute_cell_position\n");
   }
   glEnableVertexAttribArray(attribute_cell_position);
-  glVertexAttribPointer(attribute_cell_position, 2, GL_FLOAT, GL_FALSE, sizeof(CellInstance), (void *)offsetof(CellInstance, cell_position));
+  glVertexAttribPointer(attribute_cell_position, 2, GL_FLOAT, GL_FALSE, sizeof(CellInstance), (void *)(instances_offset + offsetof(CellInstance, cell_position)));
   glVertexAttribDivisor(attribute_cell_position, 1);
 
   GLuint attribute_colour = glGetAttribLocation(cell_instance_drawing_shader_program, "cell_colour");
@@ -149,69 +275,317 @@ init_cell_instances_buffer_attributes(OpenGL_Buffer *cell_instances_buffer, Open
     print("Failed to get attribute_colour\n");
   }
   glEnableVertexAttribArray(attribute_colour);
-  glVertexAttribPointer(attribute_colour, 4, GL_FLOAT, GL_FALSE, sizeof(CellInstance), (void *)offsetof(CellInstance, colour));
+  glVertexAttribPointer(attribute_colour, 4, GL_FLOAT, GL_FALSE, sizeof(CellInstance), (void *)(instances_offset + offsetof(CellInstance, colour)));
   glVertexAttribDivisor(attribute_colour, 1);
 
   opengl_print_errors();
 }
 
 
+/// Setup the attributes used by the compact cell drawing for the cell-compact-instancing.glvs shader.
+void
+init_compact_cell_instances_buffer_attributes(OpenGL_Buffer *cell_instances_buffer, OpenGL_Buffer *general_vertex_buffer, GLuint compact_shader_program)
+{
+  glBindBuffer(general_vertex_buffer->binding_target, general_vertex_buffer->id);
+
+  GLuint attribute_vertex = glGetAttribLocation(compact_shader_program, "vertex");
+  if (attribute_vertex == -1)
+  {
+    print("Failed to get attribute_vertex\n");
+  }
+  glEnableVertexAttribArray(attribute_vertex);
+  glVertexAttribPointer(attribute_vertex, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+
+
+  glBindBuffer(cell_instances_buffer->binding_target, cell_instances_buffer->id);
+
+  // Streaming buffers are drawn from the start of their current region
+  intptr_t instances_offset = cell_instances_buffer->element_size * cell_instances_buffer->first_element;
+
+  GLuint attribute_block_n = glGetAttribLocation(compact_shader_program, "block_n");
+  if (attribute_block_n == -1)
+  {
+    print("Failed to get attribute_block_n\n");
+  }
+  glEnableVertexAttribArray(attribute_block_n);
+  glVertexAttribIPointer(attribute_block_n, 1, GL_UNSIGNED_INT, sizeof(CompactCellInstance), (void *)(instances_offset + offsetof(CompactCellInstance, block_n)));
+  glVertexAttribDivisor(attribute_block_n, 1);
+
+  GLuint attribute_cell_n_and_state = glGetAttribLocation(compact_shader_program, "cell_n_and_state");
+  if (attribute_cell_n_and_state == -1)
+  {
+    print("Failed to get attribute_cell_n_and_state\n");
+  }
+  glEnableVertexAttribArray(attribute_cell_n_and_state);
+  glVertexAttribIPointer(attribute_cell_n_and_state, 1, GL_UNSIGNED_INT, sizeof(CompactCellInstance), (void *)(instances_offset + offsetof(CompactCellInstance, cell_n_and_state)));
+  glVertexAttribDivisor(attribute_cell_n_and_state, 1);
+
+  opengl_print_errors();
+}
+
+
+/// @param[in] palette_n  The cell's state % get_n_state_colours(), or COMPACT_CELL_HIDDEN_STATE
+CompactCellInstance
+get_compact_cell_instance(u32 block_n, u32 cell_n, u32 palette_n)
+{
+  CompactCellInstance result;
+  result.block_n = block_n;
+  result.cell_n_and_state = cell_n | (palette_n << COMPACT_CELL_N_BITS);
+  return result;
+}
+
+
+/// @brief Writes instances[instance_n], as a CompactCellInstance if compact, otherwise as a
+///          CellInstance.
+///
+/// @param[in] block_n  The index of the block_position in CellInstancing::block_positions, only
+///                       used by CompactCellInstances.
+/// @param[in] palette_n  The cell's state % get_n_state_colours(), or COMPACT_CELL_HIDDEN_STATE
+///                         for a cell hidden by the shader.
+///
+void
+write_cell_instance(b32 compact, void *instances, u32 instance_n, u32 block_n, s32vec2 block_position, s32vec2 cell_position, u32 cell_block_dim, u32 palette_n)
+{
+  if (compact)
+  {
+    u32 cell_n = (cell_position.y * cell_block_dim) + cell_position.x;
+    ((CompactCellInstance *)instances)[instance_n] = get_compact_cell_instance(block_n, cell_n, palette_n);
+  }
+  else
+  {
+    CellInstance& cell_instance = ((CellInstance *)instances)[instance_n];
+    cell_instance.block_position = block_position;
+    cell_instance.cell_position = vec2_divide((vec2){(r32)cell_position.x, (r32)cell_position.y}, cell_block_dim);
+
+    if (palette_n == COMPACT_CELL_HIDDEN_STATE)
+    {
+      // Hidden by cell-instancing.glvs
+      cell_instance.colour = {0, 0, 0, 0};
+    }
+    else
+    {
+      cell_instance.colour = get_state_colour(palette_n);
+    }
+  }
+}
+
+
+/// Writes an instance, see write_cell_instance(), for each of the CellBlock's cells inside the
+///   border from instances[first_instance_n], returns the number written, at most cell_block_dim^2.
+u32
+add_cell_block_instances(b32 compact, void *instances, u32 first_instance_n, u32 block_n, CellBlock *cell_block, u32 cell_block_dim, Border border)
+{
+  u32 result = 0;
+  u32 n_colours = get_n_state_colours();
+
+  s32vec2 cell_position;
+  for (cell_position.y = 0;
+       cell_position.y < cell_block_dim;
+       ++cell_position.y)
+  {
+    for (cell_position.x = 0;
+         cell_position.x < cell_block_dim;
+         ++cell_position.x)
+    {
+      if (check_border(border, cell_block->block_position, cell_position))
+      {
+        u32 cell_n = (cell_position.y * cell_block_dim) + cell_position.x;
+        write_cell_instance(compact, instances, first_instance_n + result++, block_n, cell_block->block_position, cell_position, cell_block_dim, cell_block->cell_states[cell_n] % n_colours);
+      }
+    }
+  }
+
+  return result;
+}
+
+
 /// @brief Upload all Cells in the CellBlocks to the CellInstancing.buffer so that they can be drawn.
 ///
-/// Overwrites the buffer each call, so any updates are drawn. CellInastances could be updated
-///   individually more cleverly, but it isn't worth the complexity while re-uploading them each
-///   frame is fast enough.
+/// Overwrites the buffer each call, so any updates are drawn.  Used for regions, the main view
+///   uses the CellInstanceCache and the minimap uses the MinimapCache, which only upload the
+///   blocks which changed.
+///
+/// The instances are written straight into the streaming buffer, see opengl_buffer_map_stream().
 ///
 void
 upload_cell_instances(CellBlocks *cell_blocks, Border border, CellInstancing *cell_instancing)
 {
-  cell_instancing->buffer.elements_used = 0;
+  u32 n_cells = cell_blocks->cell_block_dim * cell_blocks->cell_block_dim;
+  u32 n_blocks = 0;
+  u32 n_instances = 0;
 
-  for (u32 hash_slot = 0;
-       hash_slot < cell_blocks->hashmap_size;
-       ++hash_slot)
+  update_cell_instancing_format(cell_instancing, cell_blocks->cell_block_dim);
+  b32 compact = cell_instancing->compact;
+
+  // The block positions are only needed by CompactCellInstances
+  OpenGL_Buffer *block_positions_buffer = &cell_instancing->block_positions;
+  s32vec2 *block_positions = 0;
+  if (compact)
   {
-    CellBlock *cell_block = cell_blocks->hashmap[hash_slot];
+    block_positions = (s32vec2 *)opengl_buffer_map_stream(block_positions_buffer, cell_blocks->n_cell_blocks_in_use);
+  }
+  void *instances = opengl_buffer_map_stream(&cell_instancing->buffer, cell_blocks->n_cell_blocks_in_use * n_cells);
 
-    while (cell_block != 0)
+  if ((!compact || block_positions != 0) && instances != 0)
+  {
+    for (u32 hash_slot = 0;
+         hash_slot < cell_blocks->hashmap_size;
+         ++hash_slot)
     {
-      s32vec2 cell_position;
-      for (cell_position.y = 0;
-           cell_position.y < cell_blocks->cell_block_dim;
-           ++cell_position.y)
+      CellBlock *cell_block = cell_blocks->hashmap[hash_slot];
+
+      while (cell_block != 0)
       {
-        for (cell_position.x = 0;
-             cell_position.x < cell_blocks->cell_block_dim;
-             ++cell_position.x)
+        if (compact)
         {
-          // TODO: Check if block is visible on screen?
+          block_positions[n_blocks] = cell_block->block_position;
+        }
+        n_instances += add_cell_block_instances(compact, instances, n_instances, n_blocks, cell_block, cell_blocks->cell_block_dim, border);
+        n_blocks += 1;
+
+        // Follow any hashmap collision chains
+        cell_block = cell_block->next_block;
+      }
+    }
+  }
+
+  if (compact)
+  {
+    opengl_buffer_unmap_stream(block_positions_buffer, n_blocks);
+  }
+  opengl_buffer_unmap_stream(&cell_instancing->buffer, n_instances);
+}
 
-          if (check_border(border, cell_block->block_position, cell_position))
-          {
-            UniversePosition current_cell = {
-              .cell_block_position = cell_block->block_position,
-              .cell_position = vec2_divide((vec2){(r32)cell_position.x, (r32)cell_position.y}, cell_blocks->cell_block_dim)
-            };
 
-            CellState cell_state = cell_block->cell_states[(cell_position.y * cell_blocks->cell_block_dim) + cell_position.x];
+void
+init_cell_instance_cache(CellInstanceCache *cell_instance_cache, CellInstancing *cell_instancing)
+{
+  cell_instance_cache->instancing = *cell_instancing;
+  create_compact_cell_instance_buffers(&cell_instance_cache->instancing, false);
+}
 
-            vec4 colour = get_state_colour(cell_state);
 
-            CellInstance cell_instance = {
-              .block_position = current_cell.cell_block_position,
-              .cell_position = current_cell.cell_position,
-              .colour = colour
-            };
+/// Uploads a CellBlock's instances, and its block_position, into its slot
+void
+upload_cell_instance_cache_slot(CellInstanceCache *cell_instance_cache, u32 slot_n, Array::Array<u8>& instances)
+{
+  CellBlockSlots *slots = &cell_instance_cache->slots;
+  u32 cell_block_dim = slots->cell_block_dim;
+  u32 n_cells = cell_block_dim * cell_block_dim;
+  u32 n_colours = get_n_state_colours();
 
-            opengl_buffer_new_element(&cell_instancing->buffer, &cell_instance);
-          }
-        }
+  CellBlock *cell_block = slots->slots[slot_n].cell_block;
+
+  // Always the same as cell_block->cell_states after update_cell_block_slots()
+  CellState *states = slots->uploaded_states.elements + (slot_n * n_cells);
+
+  OpenGL_Buffer *buffer = &cell_instance_cache->instancing.buffer;
+  b32 compact = cell_instance_cache->instancing.compact;
+
+  Array::clear(instances);
+  Array::add_n(instances, n_cells * buffer->element_size);
+
+  s32vec2 cell_position;
+  for (cell_position.y = 0;
+       cell_position.y < cell_block_dim;
+       ++cell_position.y)
+  {
+    for (cell_position.x = 0;
+         cell_position.x < cell_block_dim;
+         ++cell_position.x)
+    {
+      u32 cell_n = (cell_position.y * cell_block_dim) + cell_position.x;
+
+      u32 palette_n = COMPACT_CELL_HIDDEN_STATE;
+      if (check_border(slots->border, cell_block->block_position, cell_position))
+      {
+        palette_n = states[cell_n] % n_colours;
       }
 
-      // Follow any hashmap collision chains
-      cell_block = cell_block->next_block;
+      write_cell_instance(compact, instances.elements, cell_n, slot_n, cell_block->block_position, cell_position, cell_block_dim, palette_n);
     }
   }
+
+  glBindBuffer(buffer->binding_target, buffer->id);
+  glBufferSubData(buffer->binding_target, buffer->element_size * slot_n * n_cells, buffer->element_size * n_cells, instances.elements);
+
+  opengl_buffer_update_element(&cell_instance_cache->instancing.block_positions, slot_n, &cell_block->block_position);
+}
+
+
+/// @brief Updates the CellInstanceCache for the CellBlock%s between start_block and end_block,
+///          normally the blocks visible in the main view.
+///
+/// Only the slots of blocks whose cell_states changed since their last upload, and the slots the
+///   CellBlockSlots moved, are re-uploaded, see CellBlockSlots.
+///
+void
+update_cell_instance_cache(CellInstanceCache *cell_instance_cache, Universe *universe, Border border, s32vec2 start_block, s32vec2 end_block)
+{
+  CellBlockSlots *slots = &cell_instance_cache->slots;
+  update_cell_block_slots(slots, universe, border, start_block, end_block);
+
+  // Re-creating the buffer loses the slots which weren't going to be re-uploaded
+  b32 upload_all = update_cell_instancing_format(&cell_instance_cache->instancing, slots->cell_block_dim);
+
+  u32 n_slots = slots->slots.n_elements;
+  u32 n_cells = slots->cell_block_dim * slots->cell_block_dim;
+
+  OpenGL_Buffer *buffer = &cell_instance_cache->instancing.buffer;
+  u32 n_instances_needed = n_slots * n_cells;
+  if (n_instances_needed > buffer->total_elements)
+  {
+    // Keep the whole of the old buffer, the slots which haven't changed aren't re-uploaded
+    buffer->elements_used = buffer->total_elements;
+    opengl_buffer_extend(buffer, n_instances_needed);
+  }
+  buffer->elements_used = n_instances_needed;
+
+  OpenGL_Buffer *block_positions_buffer = &cell_instance_cache->instancing.block_positions;
+  if (n_slots > block_positions_buffer->total_elements)
+  {
+    block_positions_buffer->elements_used = block_positions_buffer->total_elements;
+    opengl_buffer_extend(block_positions_buffer, n_slots);
+  }
+  block_positions_buffer->elements_used = n_slots;
+
+  Array::Array<u8> instances = {};
+
+  if (upload_all)
+  {
+    for (u32 slot_n = 0;
+         slot_n < n_slots;
+         ++slot_n)
+    {
+      upload_cell_instance_cache_slot(cell_instance_cache, slot_n, instances);
+    }
+  }
+  else
+  {
+    // The instances of moved slots hold their old slot number as their block_n, so are re-uploaded
+    //   rather than copied.  A slot can be moved again after being moved into, past the end.
+    for (u32 move_n = 0;
+         move_n < slots->moves.n_elements;
+         ++move_n)
+    {
+      u32 slot_n = slots->moves[move_n].to_slot_n;
+      if (slot_n < n_slots)
+      {
+        upload_cell_instance_cache_slot(cell_instance_cache, slot_n, instances);
+      }
+    }
+
+    for (u32 upload_n = 0;
+         upload_n < slots->slots_to_upload.n_elements;
+         ++upload_n)
+    {
+      upload_cell_instance_cache_slot(cell_instance_cache, slots->slots_to_upload[upload_n], instances);
+    }
+  }
+
+  Array::free_array(instances);
+
+  opengl_print_errors();
 }
 
 
@@ -228,12 +602,14 @@ draw_cell_instances(CellInstancing *cell_instancing)
 }
 
 
+/// Draws the CellInstances in cell_instancing, each cell_width / cell_block_dim CellBlock%s wide
 void
-draw_cell_blocks(CellBlocks *cell_blocks,
-                 CellInstancing *cell_instancing,
-                 CellDrawing *cell_drawing,
-                 OpenGL_Buffer *general_vertex_buffer,
-                 mat4x4 projection_matrix)
+draw_cell_instances_scaled(CellInstancing *cell_instancing,
+                           CellDrawing *cell_drawing,
+                           OpenGL_Buffer *general_vertex_buffer,
+                           mat4x4 projection_matrix,
+                           u32 cell_block_dim,
+                           r32 cell_width)
 {
   glBindVertexArray(cell_drawing->vao);
   glUseProgram(cell_drawing->shader_program);
@@ -242,8 +618,8 @@ draw_cell_blocks(CellBlocks *cell_blocks,
   mat4x4Transpose(projection_matrix_t, projection_matrix);
   glUniformMatrix4fv(cell_drawing->mat4_projection_matrix_uniform, 1, GL_TRUE, &projection_matrix_t[0][0]);
 
-  glUniform1i(cell_drawing->cell_block_dim_uniform, cell_blocks->cell_block_dim);
-  glUniform1f(cell_drawing->cell_width_uniform, CELLS_WIDTH);
+  glUniform1i(cell_drawing->cell_block_dim_uniform, cell_block_dim);
+  glUniform1f(cell_drawing->cell_width_uniform, cell_width);
 
   // Re-initialise attributes in case instance buffer has been reallocated
   init_cell_instances_buffer_attributes(&cell_instancing->buffer, general_vertex_buffer, cell_drawing->shader_program);
@@ -255,6 +631,69 @@ draw_cell_blocks(CellBlocks *cell_blocks,
 }
 
 
+/// Draws the CompactCellInstances in cell_instancing, coloured by the CellDrawing's palette
+void
+draw_compact_cell_instances(CellInstancing *cell_instancing,
+                            CellDrawing *cell_drawing,
+                            OpenGL_Buffer *general_vertex_buffer,
+                            mat4x4 projection_matrix,
+                            u32 cell_block_dim)
+{
+  glBindVertexArray(cell_drawing->compact_vao);
+  glUseProgram(cell_drawing->compact_shader_program);
+
+  mat4x4 projection_matrix_t;
+  mat4x4Transpose(projection_matrix_t, projection_matrix);
+  glUniformMatrix4fv(cell_drawing->compact_projection_matrix_uniform, 1, GL_TRUE, &projection_matrix_t[0][0]);
+
+  glUniform1i(cell_drawing->compact_cell_block_dim_uniform, cell_block_dim);
+
+  // Streaming buffers are read from the start of their current region
+  OpenGL_Buffer *block_positions_buffer = &cell_instancing->block_positions;
+  glUniform1i(cell_drawing->compact_first_block_uniform, block_positions_buffer->first_element);
+
+  // Re-attach the buffer in case it has been reallocated
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_BUFFER, cell_instancing->block_positions_texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32I, block_positions_buffer->id);
+  glUniform1i(cell_drawing->compact_block_positions_uniform, 0);
+
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, cell_drawing->palette_texture);
+  glUniform1i(cell_drawing->compact_palette_uniform, 1);
+
+  // Re-initialise attributes in case instance buffer has been reallocated
+  init_compact_cell_instances_buffer_attributes(&cell_instancing->buffer, general_vertex_buffer, cell_drawing->compact_shader_program);
+
+  draw_cell_instances(cell_instancing);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+  opengl_print_errors();
+  glBindVertexArray(0);
+}
+
+
+void
+draw_cell_blocks(CellBlocks *cell_blocks,
+                 CellInstancing *cell_instancing,
+                 CellDrawing *cell_drawing,
+                 OpenGL_Buffer *general_vertex_buffer,
+                 mat4x4 projection_matrix)
+{
+  if (cell_instancing->compact)
+  {
+    draw_compact_cell_instances(cell_instancing, cell_drawing, general_vertex_buffer, projection_matrix, cell_blocks->cell_block_dim);
+  }
+  else
+  {
+    draw_cell_instances_scaled(cell_instancing, cell_drawing, general_vertex_buffer, projection_matrix, cell_blocks->cell_block_dim, CELLS_WIDTH);
+  }
+}
+
+
 void
 init_general_universe_attributes(OpenGL_Buffer *general_universe_vbo, GLuint general_universe_shader_program)
 {
@@ -0,0 +1,539 @@
+#include "ca-sandbox/cell-lod.h"
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/maths.h"
+#include "engine/allocate.h"
+#include "engine/my-array.h"
+#include "engine/opengl-util.h"
+#include "engine/opengl-buffer.h"
+
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/block-index.h"
+#include "ca-sandbox/named-states.h"
+#include "ca-sandbox/rule.h"
+
+#include <string.h>
+#include <math.h>
+
+/// @file
+/// @brief  Level of detail pyramid of CellBlock summaries, see CellLOD
+///
+
+
+void
+init_cell_lod(CellLOD *cell_lod, CellInstancing *cell_instancing)
+{
+  cell_lod->instancing = *cell_instancing;
+  // The summaries' colours are blends of the state colours, so can't use CompactCellInstances
+  cell_lod->instancing.compact = false;
+  create_opengl_stream_buffer(&cell_lod->instancing.buffer, sizeof(CellInstance), GL_ARRAY_BUFFER);
+
+  cell_lod->level_drawn = -1;
+}
+
+
+/// Returns the slot the node is in, or the empty slot at the end of its hash chain
+CellLODNode **
+get_cell_lod_node_slot(CellLODLevel *level, s32vec2 position)
+{
+  u32 node_hash = position.x * 7 + position.y * 13;
+  node_hash %= CELL_LOD_HASHMAP_SIZE;
+
+  CellLODNode **result = level->hashmap + node_hash;
+
+  while (*result != 0 &&
+         !vec2_eq((*result)->position, position))
+  {
+    result = &(*result)->next_node;
+  }
+
+  return result;
+}
+
+
+CellLODNode *
+get_or_create_cell_lod_node(CellLODLevel *level, s32vec2 position)
+{
+  CellLODNode **node_slot = get_cell_lod_node_slot(level, position);
+  if (*node_slot == 0)
+  {
+    CellLODNode *node = allocate(CellLODNode, 1);
+    node->position = position;
+    node->node_n = level->nodes.n_elements;
+    Array::add(level->nodes, node);
+
+    *node_slot = node;
+  }
+
+  CellLODNode *result = *node_slot;
+  return result;
+}
+
+
+void
+remove_cell_lod_node(CellLODLevel *level, CellLODNode *node)
+{
+  CellLODNode **node_slot = get_cell_lod_node_slot(level, node->position);
+
+  // Preserve any chain
+  *node_slot = node->next_node;
+
+  Array::remove(level->nodes, node->node_n);
+  if (node->node_n < level->nodes.n_elements)
+  {
+    level->nodes[node->node_n]->node_n = node->node_n;
+  }
+
+  un_allocate(node);
+}
+
+
+/// Queues the parent of a node which changed, so it is recomputed from its children
+void
+mark_cell_lod_parent_dirty(CellLOD *cell_lod, u32 level_n, s32vec2 position)
+{
+  if (level_n + 1 < MAX_CELL_LOD_LEVELS)
+  {
+    CellLODLevel *parent_level = cell_lod->levels + level_n + 1;
+    s32vec2 parent_position = {floor_divide(position.x, 2), floor_divide(position.y, 2)};
+
+    CellLODNode *parent = get_or_create_cell_lod_node(parent_level, parent_position);
+    if (!parent->dirty)
+    {
+      parent->dirty = true;
+      Array::add(parent_level->dirty_nodes, parent);
+    }
+  }
+}
+
+
+b32
+cell_lod_summaries_equal(CellLODSummary a, CellLODSummary b)
+{
+  b32 result = (a.n_non_null_cells == b.n_non_null_cells &&
+                a.null_state == b.null_state &&
+                a.non_null_state == b.non_null_state);
+  return result;
+}
+
+
+/// @brief Summarises the cells in a CellBlock.
+///
+/// The common states are found with a majority vote, which finds the most common state if it is
+///   more than half the cells, and otherwise any state which is frequent near the end of the block.
+///   This is enough to colour a node smaller than a pixel.
+///
+CellLODSummary
+summarise_cell_block(RuleConfiguration *rule_configuration, CellState *cell_states, u32 n_cells)
+{
+  CellLODSummary result = {};
+
+  u32 null_votes = 0;
+  u32 non_null_votes = 0;
+
+  for (u32 cell_n = 0;
+       cell_n < n_cells;
+       ++cell_n)
+  {
+    CellState state = cell_states[cell_n];
+
+    if (is_null_state(rule_configuration, state))
+    {
+      if (null_votes == 0)
+      {
+        result.null_state = state;
+      }
+
+      if (state == result.null_state)
+      {
+        null_votes += 1;
+      }
+      else
+      {
+        null_votes -= 1;
+      }
+    }
+    else
+    {
+      result.n_non_null_cells += 1;
+
+      if (non_null_votes == 0)
+      {
+        result.non_null_state = state;
+      }
+
+      if (state == result.non_null_state)
+      {
+        non_null_votes += 1;
+      }
+      else
+      {
+        non_null_votes -= 1;
+      }
+    }
+  }
+
+  return result;
+}
+
+
+/// Summarises the CellBlock into its level 0 node, and marks the node's parent dirty if the summary
+///   changed.
+void
+refresh_cell_lod_block(CellLOD *cell_lod, RuleConfiguration *rule_configuration, CellBlock *cell_block)
+{
+  u32 n_cells = cell_lod->cell_block_dim * cell_lod->cell_block_dim;
+  CellLODSummary summary = summarise_cell_block(rule_configuration, cell_block->cell_states, n_cells);
+
+  CellLODLevel *level = cell_lod->levels + 0;
+  CellLODNode **node_slot = get_cell_lod_node_slot(level, cell_block->block_position);
+
+  b32 changed = true;
+  if (*node_slot != 0)
+  {
+    changed = !cell_lod_summaries_equal((*node_slot)->summary, summary);
+  }
+
+  if (changed)
+  {
+    CellLODNode *node = get_or_create_cell_lod_node(level, cell_block->block_position);
+    node->summary = summary;
+
+    mark_cell_lod_parent_dirty(cell_lod, 0, node->position);
+  }
+}
+
+
+/// Recomputes a node from its 2x2 children.  Removes the node if it has no children.
+void
+recompute_cell_lod_node(CellLOD *cell_lod, u32 level_n, CellLODNode *node)
+{
+  CellLODLevel *child_level = cell_lod->levels + level_n - 1;
+
+  CellLODSummary summary = {};
+  u64 densest_child_n_non_null_cells = 0;
+  b32 has_children = false;
+
+  s32vec2 offset;
+  for (offset.y = 0;
+       offset.y < 2;
+       ++offset.y)
+  {
+    for (offset.x = 0;
+         offset.x < 2;
+         ++offset.x)
+    {
+      s32vec2 child_position = vec2_add(vec2_multiply(node->position, 2), offset);
+      CellLODNode *child = *get_cell_lod_node_slot(child_level, child_position);
+
+      if (child != 0)
+      {
+        if (!has_children)
+        {
+          summary.null_state = child->summary.null_state;
+          summary.non_null_state = child->summary.non_null_state;
+          has_children = true;
+        }
+
+        summary.n_non_null_cells += child->summary.n_non_null_cells;
+
+        if (child->summary.n_non_null_cells > densest_child_n_non_null_cells)
+        {
+          densest_child_n_non_null_cells = child->summary.n_non_null_cells;
+          summary.non_null_state = child->summary.non_null_state;
+        }
+      }
+    }
+  }
+
+  node->dirty = false;
+
+  if (!has_children)
+  {
+    mark_cell_lod_parent_dirty(cell_lod, level_n, node->position);
+    remove_cell_lod_node(cell_lod->levels + level_n, node);
+  }
+  else if (!cell_lod_summaries_equal(node->summary, summary))
+  {
+    node->summary = summary;
+    mark_cell_lod_parent_dirty(cell_lod, level_n, node->position);
+  }
+}
+
+
+void
+clear_cell_lod(CellLOD *cell_lod)
+{
+  for (u32 level_n = 0;
+       level_n < MAX_CELL_LOD_LEVELS;
+       ++level_n)
+  {
+    CellLODLevel *level = cell_lod->levels + level_n;
+
+    for (u32 node_n = 0;
+         node_n < level->nodes.n_elements;
+         ++node_n)
+    {
+      un_allocate(level->nodes[node_n]);
+    }
+
+    Array::clear(level->nodes);
+    Array::clear(level->dirty_nodes);
+    memset(level->hashmap, 0, sizeof(level->hashmap));
+  }
+
+  cell_lod->refresh_bucket_n = 0;
+  cell_lod->refresh_node_n = 0;
+}
+
+
+/// Returns the lowest level whose nodes are at least CELL_LOD_MIN_NODE_PIXELS wide, or -1 if the
+///   cells are wide enough to be drawn individually.
+s32
+get_cell_lod_level(u32 cell_block_dim, r32 pixels_per_cell_block)
+{
+  s32 result = -1;
+
+  if (pixels_per_cell_block < CELL_LOD_MAX_PIXELS_PER_CELL * cell_block_dim)
+  {
+    result = 0;
+    r32 node_pixels = pixels_per_cell_block;
+
+    while (node_pixels < CELL_LOD_MIN_NODE_PIXELS &&
+           result < (s32)MAX_CELL_LOD_LEVELS - 1)
+    {
+      node_pixels *= 2;
+      result += 1;
+    }
+  }
+
+  return result;
+}
+
+
+/// @brief Refreshes the summaries of the CellBlock%s, and recomputes the nodes above any which
+///          changed.
+///
+/// When the LOD starts being drawn every CellBlock is summarised, after that up to
+///   CELL_LOD_REFRESH_CELLS_PER_FRAME cells are summarised each frame, continuing round the
+///   Universe from where the last frame stopped.  The summaries of a large Universe which is
+///   changing quickly can be a few frames behind.
+///
+/// @param[in] level  The level being drawn this frame, or -1 if the LOD isn't drawn, in which case
+///                     nothing is refreshed.
+///
+void
+update_cell_lod(CellLOD *cell_lod, Universe *universe, RuleConfiguration *rule_configuration, s32 level)
+{
+  b32 null_states_changed = (cell_lod->null_states.n_elements != rule_configuration->null_states.n_elements ||
+                             memcmp(cell_lod->null_states.elements, rule_configuration->null_states.elements,
+                                    rule_configuration->null_states.n_elements * sizeof(CellState)) != 0);
+
+  if (cell_lod->universe_generation != universe->generation ||
+      cell_lod->cell_block_dim != universe->cell_block_dim ||
+      null_states_changed)
+  {
+    clear_cell_lod(cell_lod);
+    cell_lod->universe_generation = universe->generation;
+    cell_lod->cell_block_dim = universe->cell_block_dim;
+
+    Array::clear(cell_lod->null_states);
+    Array::add_n(cell_lod->null_states, rule_configuration->null_states.elements, rule_configuration->null_states.n_elements);
+
+    // Refresh everything next time it is drawn
+    cell_lod->level_drawn = -1;
+  }
+
+  if (level >= 0)
+  {
+    BlockIndex *block_index = universe->block_index;
+    CellLODLevel *block_level = cell_lod->levels + 0;
+
+    u32 n_cells = universe->cell_block_dim * universe->cell_block_dim;
+    u32 n_buckets = block_index->buckets.n_elements;
+    u32 n_nodes = block_level->nodes.n_elements;
+
+    u32 n_buckets_to_refresh = n_buckets;
+    u32 n_nodes_to_check = n_nodes;
+    if (cell_lod->level_drawn >= 0)
+    {
+      // A bucket holds up to BLOCK_INDEX_BUCKET_DIM^2 CellBlock%s
+      n_buckets_to_refresh = min(n_buckets, max(CELL_LOD_REFRESH_CELLS_PER_FRAME / (n_cells * BLOCK_INDEX_BUCKET_DIM * BLOCK_INDEX_BUCKET_DIM), 1u));
+      n_nodes_to_check = min(n_nodes, max(CELL_LOD_REFRESH_CELLS_PER_FRAME / n_cells, 1u));
+    }
+
+    for (u32 i = 0;
+         i < n_buckets_to_refresh;
+         ++i)
+    {
+      cell_lod->refresh_bucket_n %= n_buckets;
+      BlockIndexBucket *bucket = block_index->buckets[cell_lod->refresh_bucket_n];
+      cell_lod->refresh_bucket_n += 1;
+
+      u64 occupied = bucket->occupied;
+      while (occupied != 0)
+      {
+        u32 bit_n = __builtin_ctzll(occupied);
+        refresh_cell_lod_block(cell_lod, rule_configuration, bucket->cell_blocks[bit_n]);
+
+        occupied &= occupied - 1;
+      }
+    }
+
+    // Remove the nodes of CellBlock%s which have been deleted
+    for (u32 i = 0;
+         i < n_nodes_to_check && block_level->nodes.n_elements > 0;
+         ++i)
+    {
+      cell_lod->refresh_node_n %= block_level->nodes.n_elements;
+      CellLODNode *node = block_level->nodes[cell_lod->refresh_node_n];
+
+      if (get_existing_cell_block(universe, node->position) == 0)
+      {
+        mark_cell_lod_parent_dirty(cell_lod, 0, node->position);
+
+        // The last node is moved into this position, so check it next
+        remove_cell_lod_node(block_level, node);
+      }
+      else
+      {
+        cell_lod->refresh_node_n += 1;
+      }
+    }
+
+    for (u32 level_n = 1;
+         level_n < MAX_CELL_LOD_LEVELS;
+         ++level_n)
+    {
+      CellLODLevel *lod_level = cell_lod->levels + level_n;
+
+      for (u32 dirty_node_n = 0;
+           dirty_node_n < lod_level->dirty_nodes.n_elements;
+           ++dirty_node_n)
+      {
+        recompute_cell_lod_node(cell_lod, level_n, lod_level->dirty_nodes[dirty_node_n]);
+      }
+
+      Array::clear(lod_level->dirty_nodes);
+    }
+  }
+
+  cell_lod->level_drawn = level;
+}
+
+
+vec4
+get_cell_lod_colour(CellLODSummary summary, u32 n_cells)
+{
+  vec4 null_colour = get_state_colour(summary.null_state);
+  vec4 non_null_colour = get_state_colour(summary.non_null_state);
+
+  // Sparse non-NULL cells are still visible
+  r32 t = 0;
+  if (summary.n_non_null_cells > 0)
+  {
+    t = 0.5 + 0.5 * ((r64)summary.n_non_null_cells / n_cells);
+  }
+
+  vec4 result = vec4_add(vec4_multiply(null_colour, 1 - t), vec4_multiply(non_null_colour, t));
+  return result;
+}
+
+
+void
+add_cell_lod_instance(CellInstance *instances, u32 *n_instances, s32 level, CellLODNode *node, u64 n_cells_in_node)
+{
+  CellInstance& cell_instance = instances[(*n_instances)++];
+  cell_instance.block_position = vec2_multiply(node->position, 1 << level);
+  cell_instance.cell_position = {0, 0};
+  cell_instance.colour = get_cell_lod_colour(node->summary, n_cells_in_node);
+}
+
+
+/// @brief Uploads one CellInstance for each node in the level between start_block and end_block,
+///          to be drawn with draw_cell_instances_scaled() with a cell_block_dim of 1 and a
+///          cell_width of 2^level.
+///
+/// Either looks up every node position in the range or checks every node in the level, whichever
+///   is fewer, like get_cell_blocks_in_range().
+///
+void
+upload_cell_lod_instances(CellLOD *cell_lod, s32 level, s32vec2 start_block, s32vec2 end_block)
+{
+  CellLODLevel *lod_level = cell_lod->levels + level;
+  s32 node_dim = 1 << level;
+  u64 n_cells_in_node = (u64)cell_lod->cell_block_dim * cell_lod->cell_block_dim * node_dim * node_dim;
+
+  s32vec2 start_node = {floor_divide(start_block.x, node_dim), floor_divide(start_block.y, node_dim)};
+  s32vec2 end_node = {floor_divide(end_block.x, node_dim), floor_divide(end_block.y, node_dim)};
+
+  u64 n_nodes_in_range = (u64)(end_node.x - start_node.x + 1) * (u64)(end_node.y - start_node.y + 1);
+
+  // Each node in the level has at most one instance, written straight into the streaming buffer
+  OpenGL_Buffer *buffer = &cell_lod->instancing.buffer;
+  CellInstance *instances = (CellInstance *)opengl_buffer_map_stream(buffer, min(n_nodes_in_range, (u64)lod_level->nodes.n_elements));
+  u32 n_instances = 0;
+
+  if (instances == 0)
+  {
+    // Nothing to draw
+  }
+  else if (n_nodes_in_range <= lod_level->nodes.n_elements)
+  {
+    s32vec2 node_position;
+    for (node_position.y = start_node.y;
+         node_position.y <= end_node.y;
+         ++node_position.y)
+    {
+      for (node_position.x = start_node.x;
+           node_position.x <= end_node.x;
+           ++node_position.x)
+      {
+        CellLODNode *node = *get_cell_lod_node_slot(lod_level, node_position);
+        if (node != 0)
+        {
+          add_cell_lod_instance(instances, &n_instances, level, node, n_cells_in_node);
+        }
+      }
+    }
+  }
+  else
+  {
+    for (u32 node_n = 0;
+         node_n < lod_level->nodes.n_elements;
+         ++node_n)
+    {
+      CellLODNode *node = lod_level->nodes[node_n];
+
+      if (node->position.x >= start_node.x &&
+          node->position.y >= start_node.y &&
+          node->position.x <= end_node.x &&
+          node->position.y <= end_node.y)
+      {
+        add_cell_lod_instance(instances, &n_instances, level, node, n_cells_in_node);
+      }
+    }
+  }
+
+  opengl_buffer_unmap_stream(buffer, n_instances);
+
+  opengl_print_errors();
+}
+
+
+void
+destroy_cell_lod(CellLOD *cell_lod)
+{
+  clear_cell_lod(cell_lod);
+
+  for (u32 level_n = 0;
+       level_n < MAX_CELL_LOD_LEVELS;
+       ++level_n)
+  {
+    Array::free_array(cell_lod->levels[level_n].nodes);
+    Array::free_array(cell_lod->levels[level_n].dirty_nodes);
+  }
+
+  Array::free_array(cell_lod->null_states);
+}
@@ -2,6 +2,7 @@
 
 #include "ca-sandbox/minimap.h"
 #include "ca-sandbox/cell-block-coordinate-system.h"
+#include "ca-sandbox/block-index.h"
 
 #include <GL/glew.h>
 
@@ -34,65 +35,56 @@ copy_cell_blocks(CellBlocks *from, CellBlocks *to, s32vec2 start_block, s32vec2
   to->cell_block_dim = from->cell_block_dim;
   const u32 cell_block_states_size = from->cell_block_dim * from->cell_block_dim * sizeof(CellState);
 
-  for (u32 from_cell_block_slot = 0;
-       from_cell_block_slot < from->hashmap_size;
-       ++from_cell_block_slot)
+  Array::Array<CellBlock *> from_cell_blocks = {};
+  get_cell_blocks_in_range(from->block_index, start_block, end_block, from_cell_blocks);
+
+  for (u32 from_cell_block_n = 0;
+       from_cell_block_n < from_cell_blocks.n_elements;
+       ++from_cell_block_n)
   {
-    CellBlock *from_cell_block = from->hashmap[from_cell_block_slot];
+    CellBlock *from_cell_block = from_cell_blocks[from_cell_block_n];
+
+    s32vec2 this_block_start_cell = {0, 0};
+    if (from_cell_block->block_position.x == start_block.x)
+    {
+      this_block_start_cell.x = start_cell.x;
+    }
+    if (from_cell_block->block_position.y == start_block.y)
+    {
+      this_block_start_cell.y = start_cell.y;
+    }
+    s32vec2 this_block_end_cell = {(s32)from->cell_block_dim, (s32)from->cell_block_dim};
+    if (from_cell_block->block_position.x == end_block.x)
+    {
+      this_block_end_cell.x = end_cell.x;
+    }
+    if (from_cell_block->block_position.y == end_block.y)
+    {
+      this_block_end_cell.y = end_cell.y;
+    }
 
-    while (from_cell_block != 0)
+    s32vec2 cell_position;
+    for (cell_position.y = this_block_start_cell.y;
+         cell_position.y < this_block_end_cell.y;
+         ++cell_position.y)
     {
-      if (from_cell_block->block_position.x >= start_block.x &&
-          from_cell_block->block_position.y >= start_block.y &&
-          from_cell_block->block_position.x <= end_block.x &&
-          from_cell_block->block_position.y <= end_block.y)
+      for (cell_position.x = this_block_start_cell.x;
+           cell_position.x < this_block_end_cell.x;
+           ++cell_position.x)
       {
-        s32vec2 this_block_start_cell = {0, 0};
-        if (from_cell_block->block_position.x == start_block.x)
-        {
-          this_block_start_cell.x = start_cell.x;
-        }
-        if (from_cell_block->block_position.y == start_block.y)
-        {
-          this_block_start_cell.y = start_cell.y;
-        }
-        s32vec2 this_block_end_cell = {(s32)from->cell_block_dim, (s32)from->cell_block_dim};
-        if (from_cell_block->block_position.x == end_block.x)
-        {
-          this_block_end_cell.x = end_cell.x;
-        }
-        if (from_cell_block->block_position.y == end_block.y)
-        {
-          this_block_end_cell.y = end_cell.y;
-        }
-
-        s32vec2 cell_position;
-        for (cell_position.y = this_block_start_cell.y;
-             cell_position.y < this_block_end_cell.y;
-             ++cell_position.y)
-        {
-          for (cell_position.x = this_block_start_cell.x;
-               cell_position.x < this_block_end_cell.x;
-               ++cell_position.x)
-          {
-            u32 from_cell_index = get_cell_index_in_block(to, cell_position);
-            CellState *from_cell_state = from_cell_block->cell_states + from_cell_index;
-
-            s32vec2 to_block_position = vec2_add(from_cell_block->block_position, to_block_offset);
-            s32vec2 to_cell_position = vec2_add(cell_position, to_cell_offset);
-            normalise_cell_coord(to, &to_block_position, &to_cell_position);
-            CellBlock *to_cell_block = get_or_create_uninitialised_cell_block(to, to_block_position);
-
-            u32 to_cell_index = get_cell_index_in_block(to, to_cell_position);
-            CellState *to_cell_state = to_cell_block->cell_states + to_cell_index;
-
-            *to_cell_state = *from_cell_state;
-          }
-        }
-      }
+        u32 from_cell_index = get_cell_index_in_block(to, cell_position);
+        CellState *from_cell_state = from_cell_block->cell_states + from_cell_index;
 
-      // Follow any hashmap collision chains
-      from_cell_block = from_cell_block->next_block;
+        s32vec2 to_block_position = vec2_add(from_cell_block->block_position, to_block_offset);
+        s32vec2 to_cell_position = vec2_add(cell_position, to_cell_offset);
+        normalise_cell_coord(to, &to_block_position, &to_cell_position);
+        CellBlock *to_cell_block = get_or_create_uninitialised_cell_block(to, to_block_position);
+
+        u32 to_cell_index = get_cell_index_in_block(to, to_cell_position);
+        CellState *to_cell_state = to_cell_block->cell_states + to_cell_index;
+
+        *to_cell_state = *from_cell_state;
+      }
     }
   }
 }
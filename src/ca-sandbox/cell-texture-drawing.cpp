@@ -0,0 +1,310 @@
+#include "ca-sandbox/cell-texture-drawing.h"
+
+#include "engine/types.h"
+#include "engine/print.h"
+#include "engine/maths.h"
+#include "engine/vectors.h"
+#include "engine/my-array.h"
+#include "engine/opengl-util.h"
+#include "engine/opengl-buffer.h"
+#include "engine/opengl-shaders.h"
+
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/cell-block-slots.h"
+#include "ca-sandbox/border.h"
+
+#include <GL/glew.h>
+
+/// @file
+/// @brief Functions for drawing the Universe as CellState textures, see CellTextureDrawing.
+///
+
+
+/// Uploaded for cells outside the border, discarded by cell-texture.glfs
+const CellState OUTSIDE_BORDER_CELL_STATE = 0xFFFFFFFF;
+
+
+b32
+init_cell_texture_drawing_shaders(CellTextureDrawing *cell_texture_drawing)
+{
+  b32 success = true;
+
+  GLenum shader_types[] = {
+    GL_VERTEX_SHADER,
+    GL_FRAGMENT_SHADER
+  };
+
+  const char *filenames[] = {
+    "shaders/cell-texture.glvs",
+    "shaders/cell-texture.glfs"
+  };
+
+  success &= create_shader_program(filenames, shader_types, 2, &cell_texture_drawing->shader_program);
+
+  return success;
+}
+
+
+/// @brief Creates the shader, palette and buffers for drawing the cells as textures.
+///
+/// Returns false if the shaders failed to compile, in which case the CellInstanceCache should be
+///   used instead.
+///
+b32
+init_cell_texture_drawing(CellTextureDrawing *cell_texture_drawing, CellInstancing *cell_instancing)
+{
+  b32 success = true;
+
+  success &= init_cell_texture_drawing_shaders(cell_texture_drawing);
+
+  if (!success)
+  {
+    print("Error: Failed to create the cell texture shaders, cells will be drawn as instances.\n");
+  }
+  else
+  {
+    GLuint shader_program = cell_texture_drawing->shader_program;
+    cell_texture_drawing->projection_matrix_uniform = glGetUniformLocation(shader_program, "projection_matrix");
+    cell_texture_drawing->cell_block_dim_uniform = glGetUniformLocation(shader_program, "cell_block_dim");
+    cell_texture_drawing->atlas_slots_per_row_uniform = glGetUniformLocation(shader_program, "atlas_slots_per_row");
+    cell_texture_drawing->cell_states_atlas_uniform = glGetUniformLocation(shader_program, "cell_states_atlas");
+    cell_texture_drawing->palette_uniform = glGetUniformLocation(shader_program, "palette");
+
+    glGenVertexArrays(1, &cell_texture_drawing->vao);
+
+    cell_texture_drawing->cell_general_indices_position = cell_instancing->cell_general_indices_position;
+    cell_texture_drawing->cell_n_indices = cell_instancing->cell_n_indices;
+
+    GLint max_texture_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    cell_texture_drawing->max_texture_size = max_texture_size;
+
+    glGenTextures(1, &cell_texture_drawing->cell_states_atlas);
+
+    cell_texture_drawing->palette_texture = create_state_palette_texture();
+
+    create_opengl_buffer(&cell_texture_drawing->block_positions_buffer, sizeof(s32vec2), GL_ARRAY_BUFFER, GL_DYNAMIC_DRAW);
+
+    opengl_print_errors();
+  }
+
+  cell_texture_drawing->available = success;
+  return success;
+}
+
+
+/// (Re)allocates the atlas with at least n_rows rows of slots, losing its contents
+void
+allocate_cell_states_atlas(CellTextureDrawing *cell_texture_drawing, u32 cell_block_dim, u32 n_rows)
+{
+  u32 max_slots_per_side = max(cell_texture_drawing->max_texture_size / cell_block_dim, 1u);
+
+  cell_texture_drawing->atlas_cell_block_dim = cell_block_dim;
+  cell_texture_drawing->atlas_slots_per_row = min(CELL_TEXTURE_ATLAS_SLOTS_PER_ROW, max_slots_per_side);
+  cell_texture_drawing->atlas_n_rows = min(n_rows, max_slots_per_side);
+
+  glBindTexture(GL_TEXTURE_2D, cell_texture_drawing->cell_states_atlas);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R32UI,
+               cell_texture_drawing->atlas_slots_per_row * cell_block_dim,
+               cell_texture_drawing->atlas_n_rows * cell_block_dim,
+               0, GL_RED_INTEGER, GL_UNSIGNED_INT, 0);
+
+  // Integer textures are incomplete with linear filtering
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  opengl_print_errors();
+}
+
+
+/// Uploads the slot's cell_states to the atlas, and its block_position to the instance buffer
+void
+upload_cell_texture_slot(CellTextureDrawing *cell_texture_drawing, u32 slot_n, Array::Array<CellState>& bordered_states)
+{
+  CellBlockSlots *slots = &cell_texture_drawing->slots;
+  u32 cell_block_dim = slots->cell_block_dim;
+  u32 n_cells = cell_block_dim * cell_block_dim;
+
+  CellBlock *cell_block = slots->slots[slot_n].cell_block;
+
+  // Always the same as cell_block->cell_states after update_cell_block_slots()
+  CellState *states = slots->uploaded_states.elements + (slot_n * n_cells);
+
+  if (slots->border.type != BorderType::INFINITE)
+  {
+    Array::clear(bordered_states);
+    Array::add_n(bordered_states, n_cells);
+
+    s32vec2 cell_position;
+    for (cell_position.y = 0;
+         cell_position.y < cell_block_dim;
+         ++cell_position.y)
+    {
+      for (cell_position.x = 0;
+           cell_position.x < cell_block_dim;
+           ++cell_position.x)
+      {
+        u32 cell_n = (cell_position.y * cell_block_dim) + cell_position.x;
+
+        if (check_border(slots->border, cell_block->block_position, cell_position))
+        {
+          bordered_states[cell_n] = states[cell_n];
+        }
+        else
+        {
+          bordered_states[cell_n] = OUTSIDE_BORDER_CELL_STATE;
+        }
+      }
+    }
+
+    states = bordered_states.elements;
+  }
+
+  u32 slots_per_row = cell_texture_drawing->atlas_slots_per_row;
+  glTexSubImage2D(GL_TEXTURE_2D, 0,
+                  (slot_n % slots_per_row) * cell_block_dim,
+                  (slot_n / slots_per_row) * cell_block_dim,
+                  cell_block_dim, cell_block_dim,
+                  GL_RED_INTEGER, GL_UNSIGNED_INT, states);
+
+  opengl_buffer_update_element(&cell_texture_drawing->block_positions_buffer, slot_n, &cell_block->block_position);
+}
+
+
+/// @brief Updates the atlas for the CellBlock%s between start_block and end_block, normally the
+///          blocks visible in the main view.
+///
+/// Only the slots of blocks whose cell_states changed, and the slots the CellBlockSlots moved, are
+///   re-uploaded.
+///
+void
+update_cell_texture_drawing(CellTextureDrawing *cell_texture_drawing, Universe *universe, Border border, s32vec2 start_block, s32vec2 end_block)
+{
+  CellBlockSlots *slots = &cell_texture_drawing->slots;
+  update_cell_block_slots(slots, universe, border, start_block, end_block);
+
+  u32 n_slots = slots->slots.n_elements;
+  b32 upload_all = false;
+
+  if (cell_texture_drawing->atlas_cell_block_dim != slots->cell_block_dim)
+  {
+    allocate_cell_states_atlas(cell_texture_drawing, slots->cell_block_dim, 1);
+    upload_all = true;
+  }
+
+  u32 atlas_n_slots = cell_texture_drawing->atlas_slots_per_row * cell_texture_drawing->atlas_n_rows;
+  if (n_slots > atlas_n_slots)
+  {
+    u32 n_rows = cell_texture_drawing->atlas_n_rows;
+    while (n_rows * cell_texture_drawing->atlas_slots_per_row < n_slots)
+    {
+      n_rows *= 2;
+    }
+
+    allocate_cell_states_atlas(cell_texture_drawing, slots->cell_block_dim, n_rows);
+    upload_all = true;
+
+    atlas_n_slots = cell_texture_drawing->atlas_slots_per_row * cell_texture_drawing->atlas_n_rows;
+    if (n_slots > atlas_n_slots)
+    {
+      print("Error: Too many CellBlocks visible for the cell texture atlas, only drawing %u of %u.\n", atlas_n_slots, n_slots);
+    }
+  }
+
+  cell_texture_drawing->n_slots_drawn = min(n_slots, atlas_n_slots);
+
+  OpenGL_Buffer *block_positions_buffer = &cell_texture_drawing->block_positions_buffer;
+  if (n_slots > block_positions_buffer->total_elements)
+  {
+    block_positions_buffer->elements_used = block_positions_buffer->total_elements;
+    opengl_buffer_extend(block_positions_buffer, n_slots);
+  }
+  block_positions_buffer->elements_used = n_slots;
+
+  if (upload_all)
+  {
+    upload_all_cell_block_slots(slots);
+    Array::clear(slots->moves);
+  }
+
+  Array::Array<CellState> bordered_states = {};
+
+  glBindTexture(GL_TEXTURE_2D, cell_texture_drawing->cell_states_atlas);
+
+  // Moved slots are re-uploaded from the CellBlockSlots' copy of their states, which is cheaper than
+  //   copying between regions of the atlas without glCopyImageSubData
+  for (u32 move_n = 0;
+       move_n < slots->moves.n_elements;
+       ++move_n)
+  {
+    u32 slot_n = slots->moves[move_n].to_slot_n;
+    if (slot_n < cell_texture_drawing->n_slots_drawn)
+    {
+      upload_cell_texture_slot(cell_texture_drawing, slot_n, bordered_states);
+    }
+  }
+
+  for (u32 upload_n = 0;
+       upload_n < slots->slots_to_upload.n_elements;
+       ++upload_n)
+  {
+    u32 slot_n = slots->slots_to_upload[upload_n];
+    if (slot_n < cell_texture_drawing->n_slots_drawn)
+    {
+      upload_cell_texture_slot(cell_texture_drawing, slot_n, bordered_states);
+    }
+  }
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  opengl_print_errors();
+}
+
+
+void
+draw_cell_textures(CellTextureDrawing *cell_texture_drawing, OpenGL_Buffer *general_vertex_buffer, OpenGL_Buffer *general_index_buffer, mat4x4 projection_matrix)
+{
+  glBindVertexArray(cell_texture_drawing->vao);
+  glUseProgram(cell_texture_drawing->shader_program);
+
+  mat4x4 projection_matrix_t;
+  mat4x4Transpose(projection_matrix_t, projection_matrix);
+  glUniformMatrix4fv(cell_texture_drawing->projection_matrix_uniform, 1, GL_TRUE, &projection_matrix_t[0][0]);
+
+  glUniform1i(cell_texture_drawing->cell_block_dim_uniform, cell_texture_drawing->atlas_cell_block_dim);
+  glUniform1i(cell_texture_drawing->atlas_slots_per_row_uniform, cell_texture_drawing->atlas_slots_per_row);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, cell_texture_drawing->cell_states_atlas);
+  glUniform1i(cell_texture_drawing->cell_states_atlas_uniform, 0);
+
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, cell_texture_drawing->palette_texture);
+  glUniform1i(cell_texture_drawing->palette_uniform, 1);
+
+  // Re-initialise attributes in case the buffers have been reallocated
+  glBindBuffer(general_index_buffer->binding_target, general_index_buffer->id);
+
+  glBindBuffer(general_vertex_buffer->binding_target, general_vertex_buffer->id);
+  GLuint attribute_vertex = glGetAttribLocation(cell_texture_drawing->shader_program, "vertex");
+  glEnableVertexAttribArray(attribute_vertex);
+  glVertexAttribPointer(attribute_vertex, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
+
+  OpenGL_Buffer *block_positions_buffer = &cell_texture_drawing->block_positions_buffer;
+  glBindBuffer(block_positions_buffer->binding_target, block_positions_buffer->id);
+  GLuint attribute_block_position = glGetAttribLocation(cell_texture_drawing->shader_program, "block_position");
+  glEnableVertexAttribArray(attribute_block_position);
+  glVertexAttribIPointer(attribute_block_position, 2, GL_INT, sizeof(s32vec2), 0);
+  glVertexAttribDivisor(attribute_block_position, 1);
+
+  void *indices_buffer_offset = (void *)(intptr_t)(cell_texture_drawing->cell_general_indices_position * sizeof(GLushort));
+  glDrawElementsInstanced(GL_TRIANGLES, cell_texture_drawing->cell_n_indices, GL_UNSIGNED_SHORT, indices_buffer_offset, cell_texture_drawing->n_slots_drawn);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  opengl_print_errors();
+  glBindVertexArray(0);
+}
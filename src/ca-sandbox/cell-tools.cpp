@@ -1,6 +1,7 @@
 #include "ca-sandbox/cell-tools.h"
 
 #include "ca-sandbox/rule.h"
+#include "ca-sandbox/block-index.h"
 
 
 void
@@ -12,55 +13,47 @@ set_cells_to_state(CellSelectionsUI *cell_selections_ui, Universe *universe, Cel
   s32vec2 start_cell = vec2_to_s32vec2(vec2_multiply(cell_selections_ui->selection_start.cell_position, universe->cell_block_dim));
   s32vec2 end_cell = vec2_to_s32vec2(vec2_multiply(cell_selections_ui->selection_end.cell_position, universe->cell_block_dim));
 
-  for (u32 cell_block_slot = 0;
-       cell_block_slot < universe->hashmap_size;
-       ++cell_block_slot)
+  Array::Array<CellBlock *> cell_blocks_in_selection = {};
+  get_cell_blocks_in_range(universe->block_index, start_block, end_block, cell_blocks_in_selection);
+
+  for (u32 cell_block_n = 0;
+       cell_block_n < cell_blocks_in_selection.n_elements;
+       ++cell_block_n)
   {
-    CellBlock *cell_block = universe->hashmap[cell_block_slot];
+    CellBlock *cell_block = cell_blocks_in_selection[cell_block_n];
 
-    while (cell_block != 0)
-    {
-      if (cell_block->block_position.x >= start_block.x &&
-          cell_block->block_position.y >= start_block.y &&
-          cell_block->block_position.x <= end_block.x &&
-          cell_block->block_position.y <= end_block.y)
-      {
-        s32vec2 this_block_start_cell = {0, 0};
-        s32vec2 this_block_end_cell = {(s32)universe->cell_block_dim, (s32)universe->cell_block_dim};
+    s32vec2 this_block_start_cell = {0, 0};
+    s32vec2 this_block_end_cell = {(s32)universe->cell_block_dim, (s32)universe->cell_block_dim};
 
-        if (cell_block->block_position.x == start_block.x)
-        {
-          this_block_start_cell.x = start_cell.x;
-        }
-        if (cell_block->block_position.y == start_block.y)
-        {
-          this_block_start_cell.y = start_cell.y;
-        }
-        if (cell_block->block_position.x == end_block.x)
-        {
-          this_block_end_cell.x = end_cell.x;
-        }
-        if (cell_block->block_position.y == end_block.y)
-        {
-          this_block_end_cell.y = end_cell.y;
-        }
+    if (cell_block->block_position.x == start_block.x)
+    {
+      this_block_start_cell.x = start_cell.x;
+    }
+    if (cell_block->block_position.y == start_block.y)
+    {
+      this_block_start_cell.y = start_cell.y;
+    }
+    if (cell_block->block_position.x == end_block.x)
+    {
+      this_block_end_cell.x = end_cell.x;
+    }
+    if (cell_block->block_position.y == end_block.y)
+    {
+      this_block_end_cell.y = end_cell.y;
+    }
 
-        s32vec2 cell_position;
-        for (cell_position.y = this_block_start_cell.y;
-             cell_position.y < this_block_end_cell.y;
-             ++cell_position.y)
-        {
-          for (cell_position.x = this_block_start_cell.x;
-               cell_position.x < this_block_end_cell.x;
-               ++cell_position.x)
-          {
-            u32 cell_index = get_cell_index_in_block(universe, cell_position);
-            cell_block->cell_states[cell_index] = new_state;
-          }
-        }
+    s32vec2 cell_position;
+    for (cell_position.y = this_block_start_cell.y;
+         cell_position.y < this_block_end_cell.y;
+         ++cell_position.y)
+    {
+      for (cell_position.x = this_block_start_cell.x;
+           cell_position.x < this_block_end_cell.x;
+           ++cell_position.x)
+      {
+        u32 cell_index = get_cell_index_in_block(universe, cell_position);
+        cell_block->cell_states[cell_index] = new_state;
       }
-
-      cell_block = cell_block->next_block;
     }
   }
 }
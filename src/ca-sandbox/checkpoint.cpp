@@ -0,0 +1,470 @@
+#include "ca-sandbox/checkpoint.h"
+
+#include "engine/types.h"
+#include "engine/print.h"
+#include "engine/files.h"
+#include "engine/timing.h"
+#include "engine/profiler.h"
+#include "engine/allocate.h"
+#include "engine/my-array.h"
+
+#include "ca-sandbox/cell-blocks.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/// @file
+/// @brief  Writes and replays incremental checkpoint logs of a Universe.
+///
+/// A checkpoint is taken on the main thread by hashing each CellBlock's states, and comparing the
+///   hash against the one stored in the CellBlock at the previous checkpoint.  Only the CellBlock%s
+///   whose hash changed are copied into the CheckpointSnapshot, which is then appended to the log
+///   file on a separate thread, so the simulation isn't stalled by the file IO.
+///
+/// The 64 bit hash is trusted to detect a change, no copy of the checkpointed states is kept to
+///   confirm it, so checkpointing doesn't double the memory used by the Universe.
+///
+
+
+/// Set the checkpoint_hash of every CellBlock in the Universe, to either 0 (forcing it into the next
+///   checkpoint), or to the hash of its current states (marking it as already checkpointed).
+void
+reset_cell_block_checkpoint_hashes(Universe *universe, b32 mark_as_checkpointed)
+{
+  u32 n_cells = universe->cell_block_dim * universe->cell_block_dim;
+
+  for (u32 slot_n = 0;
+       slot_n < universe->hashmap_size;
+       ++slot_n)
+  {
+    CellBlock *cell_block = universe->hashmap[slot_n];
+
+    while (cell_block != 0)
+    {
+      if (mark_as_checkpointed)
+      {
+        cell_block->checkpoint_hash = hash_cell_block_states(cell_block->cell_states, n_cells);
+      }
+      else
+      {
+        cell_block->checkpoint_hash = 0;
+      }
+
+      cell_block = cell_block->next_block;
+    }
+  }
+}
+
+
+void
+record_checkpointed_block_positions(CheckpointWriter *checkpoint_writer, Universe *universe)
+{
+  Array::clear(checkpoint_writer->checkpointed_block_positions);
+
+  for (u32 slot_n = 0;
+       slot_n < universe->hashmap_size;
+       ++slot_n)
+  {
+    CellBlock *cell_block = universe->hashmap[slot_n];
+
+    while (cell_block != 0)
+    {
+      Array::add(checkpoint_writer->checkpointed_block_positions, cell_block->block_position);
+      cell_block = cell_block->next_block;
+    }
+  }
+}
+
+
+/// Waits for any in-progress checkpoint write to finish.
+void
+wait_for_checkpoint_writer(CheckpointWriter *checkpoint_writer)
+{
+  if (checkpoint_writer->thread_started)
+  {
+    pthread_join(checkpoint_writer->thread, NULL);
+    checkpoint_writer->thread_started = false;
+  }
+}
+
+
+/// Creates a new checkpoint log file, replacing any existing file, and marks all the CellBlock%s in
+///   the Universe to be written in the first checkpoint.
+b32
+start_checkpoint_log(CheckpointWriter *checkpoint_writer, const char *filename, Universe *universe)
+{
+  b32 success = true;
+
+  wait_for_checkpoint_writer(checkpoint_writer);
+
+  strncpy(checkpoint_writer->filename, filename, sizeof(checkpoint_writer->filename) - 1);
+  checkpoint_writer->filename[sizeof(checkpoint_writer->filename) - 1] = '\0';
+
+  FILE *file_stream = fopen(checkpoint_writer->filename, "wb");
+  if (file_stream == NULL)
+  {
+    print("Error: Failed to open checkpoint log %s\n", checkpoint_writer->filename);
+    success &= false;
+  }
+  else
+  {
+    CheckpointLogHeader header = {};
+    memcpy(header.magic, CHECKPOINT_LOG_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_LOG_VERSION;
+    header.cell_block_dim = universe->cell_block_dim;
+
+    success &= fwrite(&header, sizeof(header), 1, file_stream) == 1;
+    fclose(file_stream);
+  }
+
+  Array::clear(checkpoint_writer->checkpointed_block_positions);
+  reset_cell_block_checkpoint_hashes(universe, false);
+
+  checkpoint_writer->log_started = success;
+  checkpoint_writer->universe_generation = universe->generation;
+  checkpoint_writer->cell_block_dim = universe->cell_block_dim;
+  checkpoint_writer->error = !success;
+  checkpoint_writer->last_checkpoint_step = 0;
+  checkpoint_writer->last_n_changed_blocks = 0;
+  checkpoint_writer->last_n_deleted_blocks = 0;
+
+  return success;
+}
+
+
+/// Appends the current snapshot to the log file, called on the writer thread.
+void
+write_checkpoint_snapshot(CheckpointWriter *checkpoint_writer)
+{
+  PROFILE_SCOPE("write checkpoint");
+
+  u64 write_start_time = get_us();
+
+  CheckpointSnapshot *snapshot = &checkpoint_writer->snapshot;
+  u32 n_cells = snapshot->cell_block_dim * snapshot->cell_block_dim;
+
+  b32 success = true;
+
+  FILE *file_stream = fopen(checkpoint_writer->filename, "ab");
+  if (file_stream == NULL)
+  {
+    print("Error: Failed to open checkpoint log %s\n", checkpoint_writer->filename);
+    success &= false;
+  }
+  else
+  {
+    CheckpointRecordHeader record_header = {};
+    record_header.magic = CHECKPOINT_RECORD_MAGIC;
+    record_header.n_changed_blocks = snapshot->changed_block_positions.n_elements;
+    record_header.n_deleted_blocks = snapshot->deleted_block_positions.n_elements;
+    record_header.simulation_step = snapshot->simulation_step;
+
+    success &= fwrite(&record_header, sizeof(record_header), 1, file_stream) == 1;
+
+    for (u32 changed_block_n = 0;
+         changed_block_n < snapshot->changed_block_positions.n_elements;
+         ++changed_block_n)
+    {
+      s32vec2 *block_position = Array::get(snapshot->changed_block_positions, changed_block_n);
+      CellState *cell_states = Array::get(snapshot->changed_block_states, changed_block_n * n_cells);
+
+      success &= fwrite(block_position, sizeof(s32vec2), 1, file_stream) == 1;
+      success &= fwrite(cell_states, sizeof(CellState), n_cells, file_stream) == n_cells;
+    }
+
+    if (snapshot->deleted_block_positions.n_elements > 0)
+    {
+      u32 n_deleted_blocks = snapshot->deleted_block_positions.n_elements;
+      success &= fwrite(snapshot->deleted_block_positions.elements, sizeof(s32vec2), n_deleted_blocks, file_stream) == n_deleted_blocks;
+    }
+
+    fclose(file_stream);
+  }
+
+  if (!success)
+  {
+    print("Error: Failed writing checkpoint %lu to %s\n", snapshot->simulation_step, checkpoint_writer->filename);
+    checkpoint_writer->error = true;
+  }
+
+  checkpoint_writer->last_write_time = get_us() - write_start_time;
+  checkpoint_writer->currently_running = false;
+}
+
+
+void *
+write_checkpoint_snapshot_thread(void *checkpoint_writer)
+{
+  write_checkpoint_snapshot((CheckpointWriter *)checkpoint_writer);
+
+  return NULL;
+}
+
+
+/// Takes a snapshot of all the CellBlock%s which have changed since the last checkpoint, and starts
+///   the writer thread to append it to the log.
+///
+/// @returns false if the previous checkpoint is still being written, in which case no snapshot is
+///            taken, and the changes will be picked up by the next checkpoint instead.
+b32
+checkpoint_universe(CheckpointWriter *checkpoint_writer, Universe *universe, u64 simulation_step)
+{
+  b32 success = true;
+
+  if (!checkpoint_writer->log_started || checkpoint_writer->currently_running)
+  {
+    success &= false;
+  }
+  else
+  {
+    wait_for_checkpoint_writer(checkpoint_writer);
+
+    CheckpointSnapshot *snapshot = &checkpoint_writer->snapshot;
+    Array::clear(snapshot->changed_block_positions);
+    Array::clear(snapshot->changed_block_states);
+    Array::clear(snapshot->deleted_block_positions);
+
+    snapshot->simulation_step = simulation_step;
+    snapshot->cell_block_dim = universe->cell_block_dim;
+
+    u32 n_cells = universe->cell_block_dim * universe->cell_block_dim;
+
+    // Find the CellBlocks which existed at the last checkpoint, but don't any more
+    for (u32 block_n = 0;
+         block_n < checkpoint_writer->checkpointed_block_positions.n_elements;
+         ++block_n)
+    {
+      s32vec2 block_position = checkpoint_writer->checkpointed_block_positions[block_n];
+      if (get_existing_cell_block(universe, block_position) == 0)
+      {
+        Array::add(snapshot->deleted_block_positions, block_position);
+      }
+    }
+
+    // Copy the CellBlocks whose states changed since the last checkpoint
+    for (u32 slot_n = 0;
+         slot_n < universe->hashmap_size;
+         ++slot_n)
+    {
+      CellBlock *cell_block = universe->hashmap[slot_n];
+
+      while (cell_block != 0)
+      {
+        u64 states_hash = hash_cell_block_states(cell_block->cell_states, n_cells);
+
+        if (states_hash != cell_block->checkpoint_hash)
+        {
+          cell_block->checkpoint_hash = states_hash;
+
+          Array::add(snapshot->changed_block_positions, cell_block->block_position);
+          Array::add_n(snapshot->changed_block_states, cell_block->cell_states, n_cells);
+        }
+
+        cell_block = cell_block->next_block;
+      }
+    }
+
+    record_checkpointed_block_positions(checkpoint_writer, universe);
+
+    checkpoint_writer->last_checkpoint_step = simulation_step;
+    checkpoint_writer->last_n_changed_blocks = snapshot->changed_block_positions.n_elements;
+    checkpoint_writer->last_n_deleted_blocks = snapshot->deleted_block_positions.n_elements;
+
+    checkpoint_writer->currently_running = true;
+
+    s32 error = pthread_create(&checkpoint_writer->thread, NULL, write_checkpoint_snapshot_thread, (void *)checkpoint_writer);
+    if (error)
+    {
+      // Fall back to writing on this thread
+      write_checkpoint_snapshot(checkpoint_writer);
+    }
+    else
+    {
+      checkpoint_writer->thread_started = true;
+    }
+  }
+
+  return success;
+}
+
+
+void
+destroy_checkpoint_writer(CheckpointWriter *checkpoint_writer)
+{
+  wait_for_checkpoint_writer(checkpoint_writer);
+
+  Array::free_array(checkpoint_writer->checkpointed_block_positions);
+  Array::free_array(checkpoint_writer->snapshot.changed_block_positions);
+  Array::free_array(checkpoint_writer->snapshot.changed_block_states);
+  Array::free_array(checkpoint_writer->snapshot.deleted_block_positions);
+
+  checkpoint_writer->log_started = false;
+}
+
+
+/// Reconstructs a Universe from a checkpoint log, by replaying all the records up to and including
+///   simulation_step.
+///
+/// @param[in] filename
+/// @param[in] simulation_step  The step to restore to; the last checkpoint at or before this step
+///                               is restored.
+/// @param[out] restored_step  The step of the last record replayed.
+/// @param[out] restored_log_size  The offset in the log file of the end of the last record
+///                                  replayed, used by resume_checkpoint_log().
+///
+/// @returns 0 on error
+Universe *
+restore_universe_from_checkpoint_log(const char *filename, u64 simulation_step, u64 *restored_step, u64 *restored_log_size)
+{
+  Universe *result = 0;
+  b32 success = true;
+
+  File file;
+  if (!open_file(filename, &file))
+  {
+    success &= false;
+  }
+  else
+  {
+    CheckpointLogHeader header;
+
+    if (file.size < (s32)sizeof(header))
+    {
+      print("Error: Checkpoint log %s is too short\n", filename);
+      success &= false;
+    }
+    else
+    {
+      memcpy(&header, file.read_ptr, sizeof(header));
+
+      if (memcmp(header.magic, CHECKPOINT_LOG_MAGIC, sizeof(header.magic)) != 0)
+      {
+        print("Error: %s is not a checkpoint log\n", filename);
+        success &= false;
+      }
+      else if (header.version != CHECKPOINT_LOG_VERSION)
+      {
+        print("Error: Checkpoint log %s has version %u, expected %u\n", filename, header.version, CHECKPOINT_LOG_VERSION);
+        success &= false;
+      }
+    }
+
+    if (success)
+    {
+      result = allocate(Universe, 1);
+      init_cell_hashmap(result);
+      result->cell_block_dim = header.cell_block_dim;
+
+      u32 n_cells = header.cell_block_dim * header.cell_block_dim;
+      u64 changed_block_size = sizeof(s32vec2) + (n_cells * sizeof(CellState));
+
+      u64 file_position = sizeof(header);
+      b32 record_replayed = false;
+
+      while (file_position + sizeof(CheckpointRecordHeader) <= (u64)file.size)
+      {
+        CheckpointRecordHeader record_header;
+        memcpy(&record_header, file.read_ptr + file_position, sizeof(record_header));
+
+        u64 record_size = sizeof(record_header) +
+                          (record_header.n_changed_blocks * changed_block_size) +
+                          (record_header.n_deleted_blocks * sizeof(s32vec2));
+
+        if (record_header.magic != CHECKPOINT_RECORD_MAGIC ||
+            file_position + record_size > (u64)file.size)
+        {
+          // Either corrupt, or a partially written record from a checkpoint which was interrupted.
+          print("Warning: Checkpoint log %s ends with an incomplete record\n", filename);
+          break;
+        }
+
+        if (record_header.simulation_step > simulation_step)
+        {
+          break;
+        }
+
+        const char *record_data = file.read_ptr + file_position + sizeof(record_header);
+
+        for (u32 changed_block_n = 0;
+             changed_block_n < record_header.n_changed_blocks;
+             ++changed_block_n)
+        {
+          s32vec2 block_position;
+          memcpy(&block_position, record_data, sizeof(s32vec2));
+          record_data += sizeof(s32vec2);
+
+          CellBlock *cell_block = get_or_create_uninitialised_cell_block(result, block_position);
+          memcpy(cell_block->cell_states, record_data, n_cells * sizeof(CellState));
+          memcpy(cell_block->cell_previous_states, record_data, n_cells * sizeof(CellState));
+          record_data += n_cells * sizeof(CellState);
+        }
+
+        for (u32 deleted_block_n = 0;
+             deleted_block_n < record_header.n_deleted_blocks;
+             ++deleted_block_n)
+        {
+          s32vec2 block_position;
+          memcpy(&block_position, record_data, sizeof(s32vec2));
+          record_data += sizeof(s32vec2);
+
+          delete_cell_block(result, block_position);
+        }
+
+        file_position += record_size;
+        record_replayed = true;
+
+        *restored_step = record_header.simulation_step;
+        *restored_log_size = file_position;
+      }
+
+      if (!record_replayed)
+      {
+        print("Error: No checkpoints at or before step %lu in %s\n", simulation_step, filename);
+        success &= false;
+      }
+    }
+
+    close_file(&file);
+  }
+
+  if (!success && result != 0)
+  {
+    destroy_cell_hashmap(result);
+    un_allocate(result);
+    result = 0;
+  }
+
+  return result;
+}
+
+
+/// Continues writing to the checkpoint writer's log after restoring from it.  The records after the
+///   restored checkpoint are discarded, and the CellBlock%s in the Universe are marked as already
+///   checkpointed.
+b32
+resume_checkpoint_log(CheckpointWriter *checkpoint_writer, Universe *universe, u64 log_size, u64 simulation_step)
+{
+  b32 success = true;
+
+  wait_for_checkpoint_writer(checkpoint_writer);
+
+  if (truncate(checkpoint_writer->filename, log_size) != 0)
+  {
+    print("Error: Failed to truncate checkpoint log %s\n", checkpoint_writer->filename);
+    success &= false;
+  }
+
+  reset_cell_block_checkpoint_hashes(universe, true);
+  record_checkpointed_block_positions(checkpoint_writer, universe);
+
+  checkpoint_writer->log_started = success;
+  checkpoint_writer->universe_generation = universe->generation;
+  checkpoint_writer->cell_block_dim = universe->cell_block_dim;
+  checkpoint_writer->error = !success;
+  checkpoint_writer->last_checkpoint_step = simulation_step;
+  checkpoint_writer->last_n_changed_blocks = 0;
+  checkpoint_writer->last_n_deleted_blocks = 0;
+
+  return success;
+}
@@ -0,0 +1,422 @@
+#include "ca-sandbox/compiled-rule.h"
+
+#include "engine/types.h"
+#include "engine/print.h"
+#include "engine/text.h"
+#include "engine/files.h"
+#include "engine/allocate.h"
+#include "engine/my-array.h"
+
+#include "ca-sandbox/rule.h"
+#include "ca-sandbox/load-rule.h"
+#include "ca-sandbox/named-states.h"
+#include "ca-sandbox/neighbourhood-region.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/// @file
+/// @brief  Functions for writing and reading `.rulec` compiled rule files
+///
+
+
+b32
+is_compiled_rule_filename(const char *filename)
+{
+  b32 result = false;
+
+  u32 filename_length = strlen(filename);
+  u32 extension_length = strlen(COMPILED_RULE_FILE_EXTENSION);
+
+  if (filename_length >= extension_length)
+  {
+    result = strcmp(filename + filename_length - extension_length, COMPILED_RULE_FILE_EXTENSION) == 0;
+  }
+
+  return result;
+}
+
+
+/// Gets the filename to save the compiled version of a rule file to, i.e: `rules/x.rule` ->
+///   `rules/x.rulec`.
+void
+get_compiled_rule_filename(const char *rule_filename, char *result, u32 result_size)
+{
+  if (is_compiled_rule_filename(rule_filename))
+  {
+    snprintf(result, result_size, "%s", rule_filename);
+  }
+  else
+  {
+    u32 filename_length = strlen(rule_filename);
+    b32 has_rule_extension = filename_length >= 5 && strcmp(rule_filename + filename_length - 5, ".rule") == 0;
+
+    if (has_rule_extension)
+    {
+      snprintf(result, result_size, "%sc", rule_filename);
+    }
+    else
+    {
+      snprintf(result, result_size, "%s%s", rule_filename, COMPILED_RULE_FILE_EXTENSION);
+    }
+  }
+}
+
+
+u64
+align_compiled_rule_offset(u64 offset)
+{
+  u64 result = (offset + 7) & ~(u64)7;
+  return result;
+}
+
+
+/// Writes zero bytes up to the given offset, then the section data.
+b32
+write_compiled_rule_section(FILE *file_stream, u64 *file_position, u64 section_offset, const void *data, u64 size)
+{
+  b32 success = true;
+
+  const u8 zero = 0;
+  while (*file_position < section_offset)
+  {
+    success &= fwrite(&zero, 1, 1, file_stream) == 1;
+    *file_position += 1;
+  }
+
+  if (size > 0)
+  {
+    success &= fwrite(data, size, 1, file_stream) == 1;
+    *file_position += size;
+  }
+
+  return success;
+}
+
+
+/// Writes the Rule's RuleConfiguration, and if include_rule_tree is set and the tree is built, the
+///   rule tree to a compiled rule file.
+b32
+save_compiled_rule_file(const char *filename, Rule *rule, b32 include_rule_tree)
+{
+  b32 success = true;
+
+  RuleConfiguration *config = &rule->config;
+  NamedStates *named_states = &config->named_states;
+
+  u32 n_inputs = get_neighbourhood_region_n_cells(config->neighbourhood_region_shape, config->neighbourhood_region_size);
+
+  CompiledRuleHeader header = {};
+  memcpy(header.magic, COMPILED_RULE_MAGIC, sizeof(header.magic));
+  header.version = COMPILED_RULE_VERSION;
+  header.header_size = sizeof(CompiledRuleHeader);
+
+  header.neighbourhood_region_shape = (u32)config->neighbourhood_region_shape;
+  header.neighbourhood_region_size = config->neighbourhood_region_size;
+  header.n_inputs = n_inputs;
+
+  header.n_states = named_states->states.n_elements;
+  header.next_unused_state = named_states->next_unused_state;
+  header.n_null_states = config->null_states.n_elements;
+
+  header.n_rule_patterns = config->rule_patterns.n_elements;
+  header.rule_pattern_size = sizeof(RulePattern) + (sizeof(PatternCellState) * n_inputs);
+
+  // A lazy rule tree is incomplete, so is not saved
+  if (include_rule_tree && rule->rule_tree_built && !rule->lazy_rule_tree)
+  {
+    header.n_rule_nodes = rule->rule_nodes_table.n_elements;
+    header.rule_node_size = rule->rule_nodes_table.element_size;
+    header.root_node = rule->root_node;
+  }
+
+  // Build the named states table, and the state names text it references
+
+  CompiledNamedState *compiled_named_states = allocate(CompiledNamedState, header.n_states + 1);
+  Array::Array<char> state_names = {};
+
+  for (u32 state_n = 0;
+       state_n < header.n_states;
+       ++state_n)
+  {
+    NamedState& named_state = named_states->states[state_n];
+
+    CompiledNamedState& compiled_named_state = compiled_named_states[state_n];
+    compiled_named_state.value = named_state.value;
+    compiled_named_state.name_offset = state_names.n_elements;
+    compiled_named_state.name_length = string_length(named_state.name);
+
+    append_string(state_names, named_state.name);
+  }
+
+  header.state_names_size = state_names.n_elements;
+
+  // Lay out the sections
+
+  u64 position = sizeof(CompiledRuleHeader);
+
+  header.named_states_offset = align_compiled_rule_offset(position);
+  position = header.named_states_offset + (header.n_states * sizeof(CompiledNamedState));
+
+  header.state_names_offset = align_compiled_rule_offset(position);
+  position = header.state_names_offset + header.state_names_size;
+
+  header.null_states_offset = align_compiled_rule_offset(position);
+  position = header.null_states_offset + (header.n_null_states * sizeof(CellState));
+
+  header.rule_patterns_offset = align_compiled_rule_offset(position);
+  position = header.rule_patterns_offset + ((u64)header.n_rule_patterns * header.rule_pattern_size);
+
+  header.rule_nodes_offset = align_compiled_rule_offset(position);
+  position = header.rule_nodes_offset + ((u64)header.n_rule_nodes * header.rule_node_size);
+
+  header.file_size = position;
+
+  FILE *file_stream = fopen(filename, "wb");
+  if (file_stream == NULL)
+  {
+    print("Error: Failed to open file %s\n", filename);
+    success &= false;
+  }
+  else
+  {
+    u64 file_position = 0;
+
+    success &= write_compiled_rule_section(file_stream, &file_position, 0, &header, sizeof(header));
+    success &= write_compiled_rule_section(file_stream, &file_position, header.named_states_offset, compiled_named_states, header.n_states * sizeof(CompiledNamedState));
+    success &= write_compiled_rule_section(file_stream, &file_position, header.state_names_offset, state_names.elements, header.state_names_size);
+    success &= write_compiled_rule_section(file_stream, &file_position, header.null_states_offset, config->null_states.elements, header.n_null_states * sizeof(CellState));
+    success &= write_compiled_rule_section(file_stream, &file_position, header.rule_patterns_offset, config->rule_patterns.elements, (u64)header.n_rule_patterns * header.rule_pattern_size);
+    success &= write_compiled_rule_section(file_stream, &file_position, header.rule_nodes_offset, rule->rule_nodes_table.elements, (u64)header.n_rule_nodes * header.rule_node_size);
+
+    fclose(file_stream);
+
+    if (!success)
+    {
+      print("Error: Failed whilst writing compiled rule file %s\n", filename);
+    }
+    else
+    {
+      print("Saved compiled rule file %s (%lu bytes, %u rule nodes)\n", filename, header.file_size, header.n_rule_nodes);
+    }
+  }
+
+  Array::free_array(state_names);
+  un_allocate(compiled_named_states);
+
+  return success;
+}
+
+
+b32
+compiled_rule_section_valid(CompiledRuleHeader *header, u64 offset, u64 size)
+{
+  b32 result = (offset % 8 == 0) && (offset <= header->file_size) && (size <= header->file_size - offset);
+  return result;
+}
+
+
+/// Checks the header against the file, and against the in-memory struct layouts.
+b32
+validate_compiled_rule_header(const char *filename, CompiledRuleHeader *header, s32 file_size)
+{
+  b32 success = true;
+
+  if (memcmp(header->magic, COMPILED_RULE_MAGIC, sizeof(header->magic)) != 0)
+  {
+    print("Error: %s is not a compiled rule file.\n", filename);
+    success &= false;
+  }
+  else if (header->version != COMPILED_RULE_VERSION ||
+           header->header_size != sizeof(CompiledRuleHeader))
+  {
+    print("Error: Compiled rule file %s has version %u, expected %u.  Re-compile it from the .rule file.\n", filename, header->version, COMPILED_RULE_VERSION);
+    success &= false;
+  }
+  else if (header->file_size != (u64)file_size)
+  {
+    print("Error: Compiled rule file %s is truncated.\n", filename);
+    success &= false;
+  }
+  else if (header->neighbourhood_region_shape > (u32)NeighbourhoodRegionShape::ONE_DIM)
+  {
+    print("Error: Compiled rule file %s has an invalid neighbourhood region shape.\n", filename);
+    success &= false;
+  }
+  else
+  {
+    NeighbourhoodRegionShape shape = (NeighbourhoodRegionShape)header->neighbourhood_region_shape;
+    u32 n_inputs = get_neighbourhood_region_n_cells(shape, header->neighbourhood_region_size);
+
+    success &= header->n_inputs == n_inputs;
+    success &= header->rule_pattern_size == sizeof(RulePattern) + (sizeof(PatternCellState) * n_inputs);
+    success &= header->n_rule_nodes == 0 ||
+               header->rule_node_size == sizeof(RuleNode) + (sizeof(u32) * header->n_states);
+    success &= header->n_rule_nodes == 0 || header->root_node < header->n_rule_nodes;
+
+    success &= compiled_rule_section_valid(header, header->named_states_offset, (u64)header->n_states * sizeof(CompiledNamedState));
+    success &= compiled_rule_section_valid(header, header->state_names_offset, header->state_names_size);
+    success &= compiled_rule_section_valid(header, header->null_states_offset, (u64)header->n_null_states * sizeof(CellState));
+    success &= compiled_rule_section_valid(header, header->rule_patterns_offset, (u64)header->n_rule_patterns * header->rule_pattern_size);
+    success &= compiled_rule_section_valid(header, header->rule_nodes_offset, (u64)header->n_rule_nodes * header->rule_node_size);
+
+    if (!success)
+    {
+      print("Error: Compiled rule file %s is invalid.\n", filename);
+    }
+  }
+
+  return success;
+}
+
+
+/// Loads a compiled rule file into the Rule, if the file contains the rule tree, it is loaded and
+///   Rule.rule_tree_built is set, otherwise the tree needs building with
+///   start_build_rule_tree_thread().
+b32
+load_compiled_rule_file(const char *filename, Rule *rule)
+{
+  b32 success = true;
+
+  File file;
+  if (!open_file(filename, &file))
+  {
+    success &= false;
+  }
+  else
+  {
+    CompiledRuleHeader header;
+
+    if (file.size < (s32)sizeof(header))
+    {
+      print("Error: Compiled rule file %s is too short.\n", filename);
+      success &= false;
+    }
+    else
+    {
+      memcpy(&header, file.read_ptr, sizeof(header));
+      success &= validate_compiled_rule_header(filename, &header, file.size);
+    }
+
+    if (success)
+    {
+      RuleConfiguration *config = &rule->config;
+
+      rule->rule_tree_built = false;
+
+      config->neighbourhood_region_shape = (NeighbourhoodRegionShape)header.neighbourhood_region_shape;
+      config->neighbourhood_region_size = header.neighbourhood_region_size;
+
+      // Named states
+
+      // The state name strings are allocated for each rule, so the previous rule's need freeing.
+      for (u32 state_n = 0;
+           state_n < config->named_states.states.n_elements;
+           ++state_n)
+      {
+        un_allocate((void *)config->named_states.states[state_n].name.start);
+      }
+      Array::clear(config->named_states.states);
+      config->named_states.next_unused_state = header.next_unused_state;
+
+      const CompiledNamedState *compiled_named_states = (const CompiledNamedState *)(file.read_ptr + header.named_states_offset);
+      const char *state_names = file.read_ptr + header.state_names_offset;
+
+      for (u32 state_n = 0;
+           state_n < header.n_states;
+           ++state_n)
+      {
+        CompiledNamedState compiled_named_state = compiled_named_states[state_n];
+
+        if ((u64)compiled_named_state.name_offset + compiled_named_state.name_length > header.state_names_size)
+        {
+          print("Error: Invalid state name in compiled rule file %s.\n", filename);
+          success &= false;
+          break;
+        }
+
+        char *state_name_text = allocate(char, compiled_named_state.name_length + 1);
+        copy_string(state_name_text, state_names + compiled_named_state.name_offset, compiled_named_state.name_length);
+        state_name_text[compiled_named_state.name_length] = '\0';
+
+        NamedState new_named_state = {
+          .name = {
+            .start = state_name_text,
+            .end = state_name_text + compiled_named_state.name_length
+          },
+          .value = compiled_named_state.value
+        };
+
+        Array::new_element(config->named_states.states) = new_named_state;
+      }
+
+      build_state_name_table(&config->named_states);
+
+      // Null states
+
+      Array::clear(config->null_states);
+      Array::add_n(config->null_states, (CellState *)(file.read_ptr + header.null_states_offset), header.n_null_states);
+
+      // Rule patterns
+
+      Array::free_array(config->rule_patterns);
+      config->rule_patterns.element_size = header.rule_pattern_size;
+      Array::add_n(config->rule_patterns, (RulePattern *)(file.read_ptr + header.rule_patterns_offset), header.n_rule_patterns);
+
+      // Rule tree
+
+      destroy_rule_tree(rule);
+      rule->n_inputs = header.n_inputs;
+      build_rule_input_deltas(rule);
+
+      if (success && header.n_rule_nodes > 0)
+      {
+        rule->rule_nodes_table.element_size = header.rule_node_size;
+        Array::add_n(rule->rule_nodes_table, (RuleNode *)(file.read_ptr + header.rule_nodes_offset), header.n_rule_nodes);
+
+        // Ensure the tree can't index outside of the table, or output a state the rule doesn't have
+        for (u32 node_n = 0;
+             node_n < header.n_rule_nodes;
+             ++node_n)
+        {
+          RuleNode *node = Array::get(rule->rule_nodes_table, node_n);
+          if (node->is_leaf)
+          {
+            success &= node->leaf_value < header.n_states;
+          }
+          else
+          {
+            for (u32 child_n = 0;
+                 child_n < header.n_states;
+                 ++child_n)
+            {
+              success &= node->children[child_n] < header.n_rule_nodes;
+            }
+          }
+        }
+
+        if (!success)
+        {
+          print("Error: Invalid rule tree in compiled rule file %s.\n", filename);
+          Array::free_array(rule->rule_nodes_table);
+        }
+        else
+        {
+          rule->root_node = header.root_node;
+          build_compact_rule_tree(rule);
+          save_rule_tree_source(rule);
+          rule->rule_tree_built = true;
+        }
+      }
+
+      if (success)
+      {
+        print("Loaded compiled rule file %s (%u states, %u patterns, %u rule nodes)\n", filename, header.n_states, header.n_rule_patterns, header.n_rule_nodes);
+      }
+    }
+
+    close_file(&file);
+  }
+
+  return success;
+}
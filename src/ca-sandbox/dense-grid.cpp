@@ -0,0 +1,296 @@
+#include "ca-sandbox/dense-grid.h"
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/maths.h"
+#include "engine/assert.h"
+#include "engine/allocate.h"
+
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/simulate.h"
+#include "ca-sandbox/block-index.h"
+
+#include <string.h>
+
+/// @file
+/// @brief  Dense copies of the cells inside bounded Border%s, for simulation
+///
+
+
+/// Wraps an offset from the start of a range of the given size back into the range
+inline s32
+wrap_into_range(s32 offset, s32 size)
+{
+  s32 result = offset % size;
+  if (result < 0)
+  {
+    result += size;
+  }
+
+  return result;
+}
+
+
+/// Copies the cell_previous_states of the CellBlock%s inside the border into the middle of the
+///   DenseGrid.  Cells in CellBlock%s which don't exist, or which are DEBUG_STATE, are
+///   unloaded_state, as in get_neighbouring_cell_state().
+void
+copy_cell_blocks_into_dense_grid(DenseGrid *grid, Universe *universe, CellState unloaded_state)
+{
+  s32 cell_block_dim = s32(universe->cell_block_dim);
+  s32vec2 grid_end = vec2_add(grid->origin, grid->size);
+
+  for (s32 block_y = 0;
+       block_y < grid->n_blocks.y;
+       ++block_y)
+  {
+    for (s32 block_x = 0;
+         block_x < grid->n_blocks.x;
+         ++block_x)
+    {
+      CellBlock *cell_block = grid->blocks[(block_y * grid->n_blocks.x) + block_x];
+
+      s32vec2 block_position = vec2_add(grid->min_block, (s32vec2){block_x, block_y});
+      s32vec2 block_origin = vec2_multiply(block_position, cell_block_dim);
+
+      // The part of the block inside the border, in global cell positions
+      s32vec2 start = vec2_max(grid->origin, block_origin);
+      s32vec2 end = vec2_min(grid_end, vec2_add(block_origin, cell_block_dim));
+      s32 row_length = end.x - start.x;
+
+      for (s32 global_y = start.y;
+           global_y < end.y;
+           ++global_y)
+      {
+        CellState *grid_row = get_dense_grid_cell(grid, (s32vec2){start.x, global_y});
+
+        if (cell_block == 0)
+        {
+          for (s32 cell_n = 0;
+               cell_n < row_length;
+               ++cell_n)
+          {
+            grid_row[cell_n] = unloaded_state;
+          }
+        }
+        else
+        {
+          CellState *block_row = cell_block->cell_previous_states + ((global_y - block_origin.y) * cell_block_dim) + (start.x - block_origin.x);
+
+          for (s32 cell_n = 0;
+               cell_n < row_length;
+               ++cell_n)
+          {
+            CellState cell_state = block_row[cell_n];
+            if (cell_state == DEBUG_STATE)
+            {
+              cell_state = unloaded_state;
+            }
+            grid_row[cell_n] = cell_state;
+          }
+        }
+      }
+    }
+  }
+}
+
+
+/// Fills the halo with the cells from the opposite side of the grid, so the neighbourhood of every
+///   cell inside the border wraps around the torus.
+void
+wrap_dense_grid_halo(DenseGrid *grid)
+{
+  // West and east halos of the rows inside the border
+
+  for (s32 grid_y = grid->halo.y;
+       grid_y < grid->halo.y + grid->size.y;
+       ++grid_y)
+  {
+    CellState *row = grid->cells + (grid_y * grid->width);
+
+    for (s32 grid_x = 0;
+         grid_x < grid->halo.x;
+         ++grid_x)
+    {
+      row[grid_x] = row[grid->halo.x + wrap_into_range(grid_x - grid->halo.x, grid->size.x)];
+
+      s32 east_grid_x = grid->halo.x + grid->size.x + grid_x;
+      row[east_grid_x] = row[grid->halo.x + wrap_into_range(east_grid_x - grid->halo.x, grid->size.x)];
+    }
+  }
+
+  // North and south halo rows, including the corners, are copies of whole wrapped rows
+
+  for (s32 grid_y = 0;
+       grid_y < grid->halo.y;
+       ++grid_y)
+  {
+    s32 south_grid_y = grid->halo.y + grid->size.y + grid_y;
+
+    CellState *north_source = grid->cells + ((grid->halo.y + wrap_into_range(grid_y - grid->halo.y, grid->size.y)) * grid->width);
+    CellState *south_source = grid->cells + ((grid->halo.y + wrap_into_range(south_grid_y - grid->halo.y, grid->size.y)) * grid->width);
+
+    memcpy(grid->cells + (grid_y * grid->width), north_source, grid->width * sizeof(CellState));
+    memcpy(grid->cells + (south_grid_y * grid->width), south_source, grid->width * sizeof(CellState));
+  }
+}
+
+
+/// Re-fills the DenseGrid from the CellBlock%s inside the border, re-allocating it if the border
+///   or reach have grown.
+///
+/// - TORUS: The grid has a halo of reach cells, filled by wrapping around the grid.
+/// - FIXED: The grid has no halo, as cells within reach of the border are not simulated.
+///
+/// @param[in] reach  The furthest the neighbourhood region reaches from a cell along each axis
+/// @param[in] unloaded_state  The state used for cells in CellBlock%s which don't exist
+///
+/// @returns  false if the border is INFINITE, doesn't contain any cells, is too large for the grid
+///             or too sparsely filled with CellBlock%s, see DENSE_GRID_MIN_BLOCKS_PERCENT, in which
+///             case the grid can't be used.
+b32
+update_dense_grid(DenseGrid *grid, Universe *universe, Border *border, s32vec2 reach, CellState unloaded_state)
+{
+  b32 success = true;
+
+  s32vec2 halo = {0, 0};
+  if (border->type == BorderType::TORUS)
+  {
+    halo = reach;
+  }
+
+  s32 cell_block_dim = s32(universe->cell_block_dim);
+
+  s32vec2 origin = vec2_add(vec2_multiply(border->min_corner_block, cell_block_dim), border->min_corner_cell);
+  s32vec2 end = vec2_add(vec2_multiply(border->max_corner_block, cell_block_dim), border->max_corner_cell);
+  s32vec2 size = vec2_subtract(end, origin);
+
+  if (border->type == BorderType::INFINITE ||
+      size.x <= 0 || size.y <= 0)
+  {
+    success &= false;
+  }
+
+  s32vec2 min_block = {};
+  s32vec2 max_block = {};
+  s32vec2 n_blocks = {};
+  u64 n_cells = 0;
+  u64 n_border_blocks = 0;
+
+  if (success)
+  {
+    min_block = {floor_divide(origin.x, cell_block_dim), floor_divide(origin.y, cell_block_dim)};
+    max_block = {floor_divide(end.x - 1, cell_block_dim), floor_divide(end.y - 1, cell_block_dim)};
+    n_blocks = vec2_add(vec2_subtract(max_block, min_block), 1);
+
+    n_cells = u64(size.x + (2 * halo.x)) * u64(size.y + (2 * halo.y));
+    n_border_blocks = u64(n_blocks.x) * u64(n_blocks.y);
+
+    // Too large to allocate, or the universe doesn't have enough CellBlock%s to fill the border
+    //   without looking them up
+    if (n_cells > MAX_DENSE_GRID_CELLS ||
+        n_border_blocks > MAX_U32 / sizeof(CellBlock *) ||
+        u64(universe->n_cell_blocks_in_use) * 100 < n_border_blocks * DENSE_GRID_MIN_BLOCKS_PERCENT)
+    {
+      success &= false;
+    }
+  }
+
+  Array::Array<CellBlock *> border_blocks = {};
+
+  if (success)
+  {
+    get_cell_blocks_in_range(universe->block_index, min_block, max_block, border_blocks);
+
+    if (u64(border_blocks.n_elements) * 100 < n_border_blocks * DENSE_GRID_MIN_BLOCKS_PERCENT)
+    {
+      success &= false;
+    }
+  }
+
+  if (success)
+  {
+    grid->origin = origin;
+    grid->size = size;
+    grid->halo = halo;
+    grid->width = size.x + (2 * halo.x);
+    grid->height = size.y + (2 * halo.y);
+
+    if (n_cells > grid->n_cells_allocated)
+    {
+      if (grid->cells != 0)
+      {
+        un_allocate(grid->cells);
+      }
+      grid->cells = allocate(CellState, u32(n_cells));
+      grid->n_cells_allocated = u32(n_cells);
+    }
+
+    grid->min_block = min_block;
+    grid->n_blocks = n_blocks;
+
+    if (n_border_blocks > grid->n_blocks_allocated)
+    {
+      if (grid->blocks != 0)
+      {
+        un_allocate(grid->blocks);
+      }
+      grid->blocks = allocate(CellBlock *, u32(n_border_blocks));
+      grid->n_blocks_allocated = u32(n_border_blocks);
+    }
+
+    memset(grid->blocks, 0, n_border_blocks * sizeof(CellBlock *));
+    for (u32 block_n = 0;
+         block_n < border_blocks.n_elements;
+         ++block_n)
+    {
+      CellBlock *cell_block = border_blocks[block_n];
+      s32vec2 grid_block = vec2_subtract(cell_block->block_position, min_block);
+      grid->blocks[(grid_block.y * n_blocks.x) + grid_block.x] = cell_block;
+    }
+
+    copy_cell_blocks_into_dense_grid(grid, universe, unloaded_state);
+
+    if (border->type == BorderType::TORUS)
+    {
+      wrap_dense_grid_halo(grid);
+    }
+  }
+
+  Array::free_array(border_blocks);
+
+  return success;
+}
+
+
+/// Returns the DenseGrid cell for a global cell position inside the border or the halo.
+CellState *
+get_dense_grid_cell(DenseGrid *grid, s32vec2 global_cell_position)
+{
+  s32vec2 grid_position = vec2_add(vec2_subtract(global_cell_position, grid->origin), grid->halo);
+
+  assert(grid_position.x >= 0 && grid_position.x < grid->width);
+  assert(grid_position.y >= 0 && grid_position.y < grid->height);
+
+  CellState *result = grid->cells + (grid_position.y * grid->width) + grid_position.x;
+  return result;
+}
+
+
+void
+destroy_dense_grid(DenseGrid *grid)
+{
+  if (grid->cells != 0)
+  {
+    un_allocate(grid->cells);
+    grid->cells = 0;
+  }
+  grid->n_cells_allocated = 0;
+
+  if (grid->blocks != 0)
+  {
+    un_allocate(grid->blocks);
+    grid->blocks = 0;
+  }
+  grid->n_blocks_allocated = 0;
+}
@@ -0,0 +1,213 @@
+#include "ca-sandbox/file-loading-thread.h"
+
+#include "engine/types.h"
+#include "engine/print.h"
+#include "engine/timing.h"
+#include "engine/profiler.h"
+#include "engine/allocate.h"
+#include "engine/my-array.h"
+
+#include "ca-sandbox/rule.h"
+#include "ca-sandbox/load-rule.h"
+#include "ca-sandbox/compiled-rule.h"
+#include "ca-sandbox/load-universe.h"
+#include "ca-sandbox/cell-blocks.h"
+
+#include <string.h>
+
+/// @file
+/// @brief  Background loading of .rule, .rulec and .cells files
+///
+
+
+void
+load_file(FileLoadingThread *file_loading_thread)
+{
+  PROFILE_SCOPE("load file");
+
+  u64 load_start_time = get_us();
+
+  b32 success = true;
+
+  if (file_loading_thread->type == FileLoadingType::RULE)
+  {
+    Rule *rule = &file_loading_thread->loaded_rule;
+    rule->rule_tree_built = false;
+
+    if (is_compiled_rule_filename(file_loading_thread->filename))
+    {
+      file_loading_thread->progress.total = 1;
+      success &= load_compiled_rule_file(file_loading_thread->filename, rule);
+      file_loading_thread->progress.done = 1;
+    }
+    else
+    {
+      success &= load_rule_file(file_loading_thread->filename, &rule->config, &file_loading_thread->progress);
+    }
+  }
+  else if (file_loading_thread->type == FileLoadingType::CELLS)
+  {
+    file_loading_thread->simulate_options = default_simulation_options();
+    default_cell_initialisation_options(&file_loading_thread->cell_initialisation_options);
+    Array::clear(file_loading_thread->error_message);
+
+    file_loading_thread->loaded_universe = load_universe(file_loading_thread->filename,
+                                                         &file_loading_thread->simulate_options,
+                                                         &file_loading_thread->cell_initialisation_options,
+                                                         file_loading_thread->named_states,
+                                                         file_loading_thread->error_message,
+                                                         &file_loading_thread->progress);
+
+    success &= file_loading_thread->loaded_universe != 0;
+  }
+
+  file_loading_thread->last_load_total_time = get_us() - load_start_time;
+
+  file_loading_thread->success = success;
+  file_loading_thread->finished = true;
+  file_loading_thread->currently_running = false;
+}
+
+
+void *
+load_file_thread(void *file_loading_thread)
+{
+  load_file((FileLoadingThread *)file_loading_thread);
+
+  return NULL;
+}
+
+
+b32
+start_file_loading_thread(FileLoadingThread *file_loading_thread, FileLoadingType type, const char *filename)
+{
+  b32 success = true;
+
+  if (file_loading_thread->currently_running || file_loading_thread->finished)
+  {
+    // The previous load must be collected first
+    success &= false;
+  }
+  else
+  {
+    finish_file_loading_thread(file_loading_thread);
+
+    file_loading_thread->type = type;
+    strncpy(file_loading_thread->filename, filename, sizeof(file_loading_thread->filename) - 1);
+    file_loading_thread->filename[sizeof(file_loading_thread->filename) - 1] = '\0';
+
+    file_loading_thread->progress.total = 0;
+    file_loading_thread->progress.done = 0;
+    file_loading_thread->success = false;
+    file_loading_thread->currently_running = true;
+
+    s32 error = pthread_create(&file_loading_thread->thread, NULL, load_file_thread, (void *)file_loading_thread);
+    if (error)
+    {
+      // Fall back to loading on this thread
+      load_file(file_loading_thread);
+    }
+    else
+    {
+      file_loading_thread->thread_started = true;
+    }
+  }
+
+  return success;
+}
+
+
+b32
+start_rule_loading_thread(FileLoadingThread *file_loading_thread, const char *filename)
+{
+  print("\nLoading rule file: %s\n", filename);
+
+  b32 result = start_file_loading_thread(file_loading_thread, FileLoadingType::RULE, filename);
+  return result;
+}
+
+
+/// named_states must not be modified until the load is finished.
+b32
+start_cells_loading_thread(FileLoadingThread *file_loading_thread, const char *filename, NamedStates *named_states)
+{
+  file_loading_thread->named_states = named_states;
+
+  b32 result = start_file_loading_thread(file_loading_thread, FileLoadingType::CELLS, filename);
+  return result;
+}
+
+
+/// Joins the loading thread, and clears the finished flag.  Call once the result has been collected.
+void
+finish_file_loading_thread(FileLoadingThread *file_loading_thread)
+{
+  if (file_loading_thread->thread_started)
+  {
+    pthread_join(file_loading_thread->thread, NULL);
+    file_loading_thread->thread_started = false;
+  }
+
+  file_loading_thread->finished = false;
+}
+
+
+void
+copy_cell_initialisation_options(CellInitialisationOptions *dest, CellInitialisationOptions *src)
+{
+  dest->type = src->type;
+  Array::clear(dest->set_of_initial_states);
+  Array::add_n(dest->set_of_initial_states, src->set_of_initial_states.elements, src->set_of_initial_states.n_elements);
+}
+
+
+/// Replaces the contents of rule with the rule loaded by the thread.  The rule tree must not be in
+///   use by a RuleCreationThread.
+void
+swap_in_loaded_rule(FileLoadingThread *file_loading_thread, Rule *rule)
+{
+  Rule *loaded_rule = &file_loading_thread->loaded_rule;
+
+  RuleConfiguration *config = &rule->config;
+  RuleConfiguration *loaded_config = &loaded_rule->config;
+
+  config->neighbourhood_region_shape = loaded_config->neighbourhood_region_shape;
+  config->neighbourhood_region_size = loaded_config->neighbourhood_region_size;
+
+  // The state name strings are moved over to the new rule, so the old ones need freeing.
+  for (u32 state_n = 0;
+       state_n < config->named_states.states.n_elements;
+       ++state_n)
+  {
+    un_allocate((void *)config->named_states.states[state_n].name.start);
+  }
+  Array::clear(config->named_states.states);
+  Array::add_n(config->named_states.states, loaded_config->named_states.states.elements, loaded_config->named_states.states.n_elements);
+  config->named_states.next_unused_state = loaded_config->named_states.next_unused_state;
+  Array::clear(loaded_config->named_states.states);
+  build_state_name_table(&config->named_states);
+
+  Array::clear(config->null_states);
+  Array::add_n(config->null_states, loaded_config->null_states.elements, loaded_config->null_states.n_elements);
+
+  Array::free_array(config->rule_patterns);
+  config->rule_patterns.element_size = loaded_config->rule_patterns.element_size;
+  Array::add_n(config->rule_patterns, loaded_config->rule_patterns.elements, loaded_config->rule_patterns.n_elements);
+  Array::free_array(loaded_config->rule_patterns);
+
+  destroy_rule_tree(rule);
+  if (loaded_rule->rule_tree_built)
+  {
+    rule->rule_nodes_table.element_size = loaded_rule->rule_nodes_table.element_size;
+    Array::add_n(rule->rule_nodes_table, loaded_rule->rule_nodes_table.elements, loaded_rule->rule_nodes_table.n_elements);
+
+    rule->n_inputs = loaded_rule->n_inputs;
+    build_rule_input_deltas(rule);
+    rule->root_node = loaded_rule->root_node;
+    build_compact_rule_tree(rule);
+    save_rule_tree_source(rule);
+    rule->rule_tree_built = true;
+
+    destroy_rule_tree(loaded_rule);
+  }
+}
@@ -423,7 +423,7 @@ read_rule_pattern(NamedStates *named_states, String *file_string, u32 n_inputs,
 
 
 b32
-read_rule_patterns(NamedStates *named_states, String file_string, u32 n_inputs, RulePatterns *rule_patterns)
+read_rule_patterns(NamedStates *named_states, String file_string, u32 n_inputs, RulePatterns *rule_patterns, Progress *progress)
 {
   b32 success = true;
 
@@ -431,6 +431,11 @@ read_rule_patterns(NamedStates *named_states, String file_string, u32 n_inputs,
 
   while (file_string.current_position != file_string.end)
   {
+    if (progress != 0)
+    {
+      progress->done = file_string.current_position - file_string.start;
+    }
+
     *rule_pattern = {};
 
     b32 found_pattern = read_rule_pattern(named_states, &file_string, n_inputs, rule_pattern);
@@ -583,8 +588,14 @@ debug_print_rule_patterns(RuleConfiguration *rule_config)
 }
 
 
+/// Parses a .rule file into the RuleConfiguration
+///
+/// @param[in] filename
+/// @param[out] rule_config
+/// @param[out] progress  Optional; progress.done is updated with the number of bytes of the file
+///                         parsed.
 b32
-load_rule_file(const char *filename, RuleConfiguration *rule_config)
+load_rule_file(const char *filename, RuleConfiguration *rule_config, Progress *progress)
 {
   b32 success = true;
 
@@ -598,6 +609,12 @@ load_rule_file(const char *filename, RuleConfiguration *rule_config)
       .end = file.read_ptr + file.size
     };
 
+    if (progress != 0)
+    {
+      progress->total = file.size;
+      progress->done = 0;
+    }
+
     u32 n_states = 0;
     find_label_value_u32(file_string, "n_states", &n_states);
     b32 states_success = n_states > 0;
@@ -665,7 +682,7 @@ load_rule_file(const char *filename, RuleConfiguration *rule_config)
       free_array(rule_config->rule_patterns);
       rule_config->rule_patterns.element_size = sizeof(RulePattern) + (sizeof(PatternCellState) * n_inputs);
 
-      success &= read_rule_patterns(&rule_config->named_states, file_string, n_inputs, &rule_config->rule_patterns);
+      success &= read_rule_patterns(&rule_config->named_states, file_string, n_inputs, &rule_config->rule_patterns, progress);
       if (!success)
       {
         print("Error whilst reading rule patterns.\n");
@@ -676,6 +693,11 @@ load_rule_file(const char *filename, RuleConfiguration *rule_config)
       }
     }
 
+    if (progress != 0)
+    {
+      progress->done = progress->total;
+    }
+
     close_file(&file);
   }
 
@@ -103,7 +103,7 @@ read_cell_block(String *file_string, Universe *universe, NamedStates *named_stat
 /// @param[in] file_string  String containing the contents of the .cell file
 /// @param[out] universe  Universe to fill in
 b32
-load_universe_from_file(String file_string, Universe *universe, NamedStates *named_states, Array::Array<char>& error_message)
+load_universe_from_file(String file_string, Universe *universe, NamedStates *named_states, Array::Array<char>& error_message, Progress *progress)
 {
   b32 success = true;
 
@@ -127,11 +127,22 @@ load_universe_from_file(String file_string, Universe *universe, NamedStates *nam
 
     universe->cell_block_dim = cell_block_dim;
 
+    if (progress != 0)
+    {
+      progress->total = n_cell_blocks;
+      progress->done = 0;
+    }
+
     for (u32 cell_block_index = 0;
          cell_block_index < n_cell_blocks;
          ++cell_block_index)
     {
       read_cell_block(&file_string, universe, named_states, error_message);
+
+      if (progress != 0)
+      {
+        progress->done = cell_block_index + 1;
+      }
     }
   }
 
@@ -326,8 +337,10 @@ load_cell_initialisation_options(String file_string, CellInitialisationOptions *
 /// UniverseUI holds the .cell file state
 /// NamedStates is needed to read the states in the .cells file
 ///
+/// progress is optional, if given progress.done is updated with the number of CellBlock%s read.
+///
 Universe *
-load_universe(const char *filename, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, NamedStates *named_states, Array::Array<char>& error_message)
+load_universe(const char *filename, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, NamedStates *named_states, Array::Array<char>& error_message, Progress *progress)
 {
   Universe *result = allocate(Universe, 1);
   b32 success = true;
@@ -345,7 +358,7 @@ load_universe(const char *filename, SimulateOptions *simulate_options, CellIniti
   }
   else
   {
-    success &= load_universe_from_file(universe_file_string, result, named_states, error_message);
+    success &= load_universe_from_file(universe_file_string, result, named_states, error_message, progress);
     success &= load_simulate_options(universe_file_string, simulate_options, error_message);
     success &= load_cell_initialisation_options(universe_file_string, cell_initialisation_options, named_states, error_message);
 
@@ -9,6 +9,9 @@
 #include "ca-sandbox/ui/cell-regions-ui.h"
 #include "ca-sandbox/ui/cell-tools-ui.h"
 #include "ca-sandbox/ui/files-loaded-state-ui.h"
+#include "ca-sandbox/ui/profiler-ui.h"
+
+#include "engine/profiler.h"
 
 #include "imgui/imgui.h"
 #include "imgui/imgui_tabs.h"
@@ -76,12 +79,12 @@ do_main_gui(CA_SandboxState *state, s32vec2 screen_size_s32)
 
       if (ImGui::TabItem("Cells File"))
       {
-        do_universe_ui(&state->universe_ui, &state->universe, &state->simulate_options, &state->cell_initialisation_options, &state->loaded_rule.config.named_states, &state->files_loaded_state);
+        do_universe_ui(&state->universe_ui, &state->universe, &state->simulate_options, &state->cell_initialisation_options, &state->loaded_rule.config.named_states, &state->files_loaded_state, &state->cells_loading_thread);
       }
 
       if (ImGui::TabItem("Simulation"))
       {
-        do_simulation_ui(&state->simulation_ui, state->frame_timing.frame_start, state->loaded_rule.rule_tree_built, &state->files_loaded_state, &state->universe_ui.save_cells_file);
+        do_simulation_ui(&state->simulation_ui, state->frame_timing.frame_start, state->loaded_rule.rule_tree_built, &state->files_loaded_state, &state->universe_ui.save_cells_file, &state->checkpoint_writer);
       }
 
       if (ImGui::TabItem("Simulation Options"))
@@ -89,6 +92,11 @@ do_main_gui(CA_SandboxState *state, s32vec2 screen_size_s32)
         do_simulate_options_ui(&state->simulate_options, state->universe);
       }
 
+      if (ImGui::TabItem("Profiler"))
+      {
+        do_profiler_ui(&state->profiler_ui, &global_profiler);
+      }
+
       ImGui::EndTabBar();
 
       state->right_side_bar_width = ImGui::GetWindowSize().x;
@@ -143,7 +151,7 @@ do_main_gui(CA_SandboxState *state, s32vec2 screen_size_s32)
 
     if (ImGui::Begin("Rules File Editor", NULL, imgui_window_flags))
     {
-      do_rule_ui(&state->rule_ui, &state->loaded_rule, &state->rule_creation_thread, &state->files_loaded_state);
+      do_rule_ui(&state->rule_ui, &state->loaded_rule, &state->rule_creation_thread, &state->rule_loading_thread, &state->files_loaded_state);
 
       state->left_side_bar_width = ImGui::GetWindowSize().x;
       state->left_side_bar_split = ImGui::GetWindowSize().y-1;
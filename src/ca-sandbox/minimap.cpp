@@ -3,10 +3,12 @@
 #include "ca-sandbox/cell-blocks.h"
 #include "ca-sandbox/cell-regions.h"
 #include "ca-sandbox/cell-drawing.h"
+#include "ca-sandbox/cell-block-slots.h"
 
 #include "engine/print.h"
 #include "engine/opengl-util.h"
 #include "engine/opengl-buffer.h"
+#include "engine/my-array.h"
 
 #include "imgui/imgui.h"
 
@@ -58,32 +60,32 @@ create_minimap_texture(s32vec2 size, GLuint framebuffer)
 }
 
 
+/// Projects the CellBlock%s from lowest_block to highest_block inclusive into the texture
 void
-draw_minimap_texture(CellBlocks *cell_blocks, CellInstancing *cell_instancing, CellDrawing *cell_drawing, OpenGL_Buffer *general_vertex_buffer, GLuint framebuffer, GLuint texture, s32vec2 texture_size)
+get_minimap_projection_matrix(s32vec2 lowest_block, s32vec2 highest_block, s32vec2 texture_size, mat4x4 result)
 {
   mat4x4 mini_map_projection_matrix;
   mat4x4Identity(mini_map_projection_matrix);
 
-  s32vec2 lowest_coord;
-  s32vec2 highest_coord;
-  get_cell_blocks_dimentions(cell_blocks, &lowest_coord, &highest_coord);
-
   vec3 offset = {};
-  offset.xy = vec2_multiply(s32vec2_to_vec2(vec2_add(vec2_add(lowest_coord, highest_coord), 1)), -0.5);
+  offset.xy = vec2_multiply(s32vec2_to_vec2(vec2_add(vec2_add(lowest_block, highest_block), 1)), -0.5);
   mat4x4Translate(mini_map_projection_matrix, offset);
 
   mat4x4 aspect_ratio;
   mat4x4Identity(aspect_ratio);
   aspect_ratio[0][0] = (r32)texture_size.y / texture_size.x;
 
-  mat4x4 mini_map_projection_matrix_aspect;
-  mat4x4MultiplyMatrix(mini_map_projection_matrix_aspect, mini_map_projection_matrix, aspect_ratio);
+  mat4x4MultiplyMatrix(result, mini_map_projection_matrix, aspect_ratio);
 
-  s32vec2 dim = vec2_add(vec2_subtract(highest_coord, lowest_coord), 1);
-  vec2 dim_ratio_to_texture = vec2_divide(s32vec2_to_vec2(dim), s32vec2_to_vec2(texture_size));
+  s32vec2 dim = vec2_add(vec2_subtract(highest_block, lowest_block), 1);
   r32 scale = min(((r32)texture_size.x / texture_size.y)*(2.0/dim.x), 2.0/dim.y);
-  mat4x4Scale(mini_map_projection_matrix_aspect, scale);
+  mat4x4Scale(result, scale);
+}
 
+
+void
+bind_minimap_framebuffer(GLuint framebuffer, GLuint texture, s32vec2 texture_size)
+{
   glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
   glBindTexture(GL_TEXTURE_2D, texture);
 
@@ -94,6 +96,22 @@ draw_minimap_texture(CellBlocks *cell_blocks, CellInstancing *cell_instancing, C
   glDrawBuffers(n_draw_buffers, draw_buffers);
 
   glViewport(0, 0, texture_size.x, texture_size.y);
+}
+
+
+/// Draws the CellInstances already uploaded to cell_instancing into the texture
+void
+draw_minimap_texture(CellBlocks *cell_blocks, CellInstancing *cell_instancing, CellDrawing *cell_drawing, OpenGL_Buffer *general_vertex_buffer, GLuint framebuffer, GLuint texture, s32vec2 texture_size)
+{
+  s32vec2 lowest_coord;
+  s32vec2 highest_coord;
+  get_cell_blocks_dimentions(cell_blocks, &lowest_coord, &highest_coord);
+
+  mat4x4 mini_map_projection_matrix_aspect;
+  get_minimap_projection_matrix(lowest_coord, highest_coord, texture_size, mini_map_projection_matrix_aspect);
+
+  bind_minimap_framebuffer(framebuffer, texture, texture_size);
+
   glClearColor(1, 1, 1, 0);
   glClear(GL_COLOR_BUFFER_BIT);
 
@@ -106,6 +124,163 @@ draw_minimap_texture(CellBlocks *cell_blocks, CellInstancing *cell_instancing, C
 }
 
 
+void
+init_minimap_cache(MinimapCache *minimap_cache, CellInstancing *cell_instancing)
+{
+  minimap_cache->instancing = *cell_instancing;
+  create_compact_cell_instance_buffers(&minimap_cache->instancing, true);
+}
+
+
+/// @brief Draws the CellBlock%s which changed since the last update into the minimap texture, see
+///          MinimapCache.
+///
+/// Nothing is uploaded or drawn if no CellBlock%s changed.
+///
+void
+update_minimap_texture(MinimapCache *minimap_cache, Universe *universe, Border border, CellDrawing *cell_drawing, OpenGL_Buffer *general_vertex_buffer, GLuint framebuffer, GLuint texture, s32vec2 texture_size)
+{
+  s32vec2 lowest_block;
+  s32vec2 highest_block;
+  get_cell_blocks_dimentions(universe, &lowest_block, &highest_block);
+
+  b32 redraw_all = (minimap_cache->texture != texture ||
+                    !vec2_eq(minimap_cache->texture_size, texture_size) ||
+                    minimap_cache->universe_generation != universe->generation ||
+                    minimap_cache->cell_block_dim != universe->cell_block_dim ||
+                    !borders_equal(minimap_cache->border, border) ||
+                    !vec2_eq(minimap_cache->lowest_block, lowest_block) ||
+                    !vec2_eq(minimap_cache->highest_block, highest_block));
+
+  if (!redraw_all)
+  {
+    // Blocks which haven't been drawn yet are new, if the rest don't account for all the blocks
+    //   drawn then some have been deleted
+    u32 n_drawn_cell_blocks_found = 0;
+
+    for (u32 hash_slot = 0;
+         hash_slot < universe->hashmap_size;
+         ++hash_slot)
+    {
+      CellBlock *cell_block = universe->hashmap[hash_slot];
+
+      while (cell_block != 0)
+      {
+        if (cell_block->minimap_hash != 0)
+        {
+          n_drawn_cell_blocks_found += 1;
+        }
+
+        cell_block = cell_block->next_block;
+      }
+    }
+
+    redraw_all = n_drawn_cell_blocks_found != minimap_cache->n_cell_blocks_drawn;
+  }
+
+  u32 cell_block_dim = universe->cell_block_dim;
+  u32 n_cells = cell_block_dim * cell_block_dim;
+
+  // Only changes with the cell_block_dim, which already redraws everything
+  update_cell_instancing_format(&minimap_cache->instancing, cell_block_dim);
+  b32 compact = minimap_cache->instancing.compact;
+
+  Array::Array<CellBlock *> changed_cell_blocks = {};
+  minimap_cache->n_cell_blocks_drawn = 0;
+  minimap_cache->n_cell_blocks_redrawn = 0;
+
+  for (u32 hash_slot = 0;
+       hash_slot < universe->hashmap_size;
+       ++hash_slot)
+  {
+    CellBlock *cell_block = universe->hashmap[hash_slot];
+
+    while (cell_block != 0)
+    {
+      u64 states_hash = hash_cell_block_states(cell_block->cell_states, n_cells);
+
+      if (redraw_all ||
+          states_hash != cell_block->minimap_hash)
+      {
+        cell_block->minimap_hash = states_hash;
+        Array::add(changed_cell_blocks, cell_block);
+      }
+
+      minimap_cache->n_cell_blocks_drawn += 1;
+
+      // Follow any hashmap collision chains
+      cell_block = cell_block->next_block;
+    }
+  }
+
+  minimap_cache->n_cell_blocks_redrawn = changed_cell_blocks.n_elements;
+
+  if (redraw_all || changed_cell_blocks.n_elements > 0)
+  {
+    mat4x4 projection_matrix;
+    get_minimap_projection_matrix(lowest_block, highest_block, texture_size, projection_matrix);
+
+    bind_minimap_framebuffer(framebuffer, texture, texture_size);
+
+    if (redraw_all)
+    {
+      glClearColor(1, 1, 1, 0);
+      glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    u32 n_changed = changed_cell_blocks.n_elements;
+
+    // The block positions are only needed by CompactCellInstances
+    OpenGL_Buffer *block_positions_buffer = &minimap_cache->instancing.block_positions;
+    s32vec2 *block_positions = 0;
+    if (compact)
+    {
+      block_positions = (s32vec2 *)opengl_buffer_map_stream(block_positions_buffer, n_changed);
+    }
+    void *instances = opengl_buffer_map_stream(&minimap_cache->instancing.buffer, n_changed * n_cells);
+    u32 n_instances = 0;
+
+    if ((!compact || block_positions != 0) && instances != 0)
+    {
+      for (u32 changed_n = 0;
+           changed_n < n_changed;
+           ++changed_n)
+      {
+        CellBlock *cell_block = changed_cell_blocks[changed_n];
+        if (compact)
+        {
+          block_positions[changed_n] = cell_block->block_position;
+        }
+        n_instances += add_cell_block_instances(compact, instances, n_instances, changed_n, cell_block, cell_block_dim, border);
+      }
+    }
+
+    if (compact)
+    {
+      opengl_buffer_unmap_stream(block_positions_buffer, n_changed);
+    }
+    opengl_buffer_unmap_stream(&minimap_cache->instancing.buffer, n_instances);
+
+    draw_cell_blocks(universe, &minimap_cache->instancing, cell_drawing, general_vertex_buffer, projection_matrix);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  Array::free_array(changed_cell_blocks);
+
+  minimap_cache->texture = texture;
+  minimap_cache->texture_size = texture_size;
+  minimap_cache->universe_generation = universe->generation;
+  minimap_cache->cell_block_dim = cell_block_dim;
+  minimap_cache->border = border;
+  minimap_cache->lowest_block = lowest_block;
+  minimap_cache->highest_block = highest_block;
+
+  opengl_print_errors();
+}
+
+
 void
 draw_minimap_texture_to_screen(GLuint framebuffer, GLuint texture, s32vec2 texture_size, GLuint texture_shader, GLuint rendered_texture_uniform)
 {
@@ -25,8 +25,122 @@ get_next_unused_state_value(NamedStates *named_states)
 }
 
 
+u32
+hash_state_name(String state_name, u32 seed)
+{
+  // FNV-1a, with the seed mixed into the offset basis
+  u32 hash = 2166136261u ^ seed;
+
+  for (const char *c = state_name.start;
+       c < state_name.end;
+       ++c)
+  {
+    hash ^= (u8)*c;
+    hash *= 16777619u;
+  }
+
+  hash ^= hash >> 16;
+  return hash;
+}
+
+
+/// Tries to place every state name in the table using the given seed, returns false if two
+///   different names land in the same slot.
+b32
+fill_state_name_table(NamedStates *named_states, u32 seed)
+{
+  b32 success = true;
+
+  StateNameTable *table = &named_states->name_table;
+
+  for (u32 slot_n = 0;
+       slot_n < table->slots.n_elements;
+       ++slot_n)
+  {
+    table->slots[slot_n] = 0;
+  }
+
+  for (u32 state_index = 0;
+       state_index < named_states->states.n_elements;
+       ++state_index)
+  {
+    NamedState& named_state = named_states->states[state_index];
+    u32 slot_n = hash_state_name(named_state.name, seed) & table->mask;
+
+    u32 *slot = &table->slots[slot_n];
+    if (*slot == 0)
+    {
+      *slot = state_index + 1;
+    }
+    else if (!strings_equal(&named_states->states[*slot - 1].name, &named_state.name))
+    {
+      success &= false;
+      break;
+    }
+    // Otherwise it is a duplicate name, the first state with the name is the one found, as with a
+    //   linear search.
+  }
+
+  return success;
+}
+
+
+/// Searches for a seed which gives a collision-free table for the current state names.  Must be
+///   called whenever the states are added to or renamed.
+///
+void
+build_state_name_table(NamedStates *named_states)
+{
+  StateNameTable *table = &named_states->name_table;
+
+  u32 n_states = named_states->states.n_elements;
+
+  u32 table_size = 4;
+  while (table_size < 2*n_states)
+  {
+    table_size *= 2;
+  }
+
+  const u32 SEEDS_PER_TABLE_SIZE = 64;
+  const u32 MAX_TABLE_SIZE = 1 << 20;
+
+  b32 built = false;
+  while (!built && table_size <= MAX_TABLE_SIZE)
+  {
+    Array::clear(table->slots);
+    Array::add_n(table->slots, table_size);
+    table->mask = table_size - 1;
+
+    for (u32 seed = 0;
+         seed < SEEDS_PER_TABLE_SIZE;
+         ++seed)
+    {
+      if (fill_state_name_table(named_states, seed))
+      {
+        table->seed = seed;
+        built = true;
+        break;
+      }
+    }
+
+    table_size *= 2;
+  }
+
+  if (built)
+  {
+    table->n_states = n_states;
+  }
+  else
+  {
+    // Fall back to the linear search
+    table->n_states = 0;
+    Array::clear(table->slots);
+  }
+}
+
+
 /// Searches the array of state names in the rule configuration for state_name, retuning the
-///   corresponding CellState via *resulting_state.  Function returns false, if the name is a
+///   corresponding CellState via *resulting_state.  Function returns false, if the name is not a
 ///   defined state name.
 ///
 b32
@@ -34,16 +148,35 @@ state_value_from_name(NamedStates *named_states, String state_name, CellState *r
 {
   b32 result = false;
 
-  for (u32 test_state_index = 0;
-       test_state_index < named_states->states.n_elements;
-       ++test_state_index)
+  StateNameTable *table = &named_states->name_table;
+
+  if (table->n_states == named_states->states.n_elements &&
+      table->slots.n_elements > 0)
   {
-    NamedState& test_state_name = named_states->states[test_state_index];
-    if (strings_equal(&state_name, &test_state_name.name))
+    u32 slot = table->slots[hash_state_name(state_name, table->seed) & table->mask];
+    if (slot != 0)
     {
-      *resulting_state = test_state_name.value;
-      result = true;
-      break;
+      NamedState& test_state_name = named_states->states[slot - 1];
+      if (strings_equal(&state_name, &test_state_name.name))
+      {
+        *resulting_state = test_state_name.value;
+        result = true;
+      }
+    }
+  }
+  else
+  {
+    for (u32 test_state_index = 0;
+         test_state_index < named_states->states.n_elements;
+         ++test_state_index)
+    {
+      NamedState& test_state_name = named_states->states[test_state_index];
+      if (strings_equal(&state_name, &test_state_name.name))
+      {
+        *resulting_state = test_state_name.value;
+        result = true;
+        break;
+      }
     }
   }
 
@@ -148,6 +281,8 @@ find_state_names(String file_string, NamedStates *named_states, u32 n_states)
     success &= false;
   }
 
+  build_state_name_table(named_states);
+
   return success;
 }
 
@@ -248,47 +383,59 @@ advance_state(NamedStates *named_states, CellState previous)
 }
 
 
+/// The colours are repeated for states beyond the end of the array
+const vec4 STATE_COLOURS[] = {(vec4){0x60/255.0, 0x60/255.0, 0x60/255.0, 1},
+                              (vec4){0xff/255.0, 0xA0/255.0, 0xA0/255.0, 1},
+                              (vec4){0xff/255.0, 0x7d/255.0, 0x00/255.0, 1},
+                              (vec4){0xff/255.0, 0x96/255.0, 0x19/255.0, 1},
+                              (vec4){0xff/255.0, 0xaf/255.0, 0x32/255.0, 1},
+                              (vec4){0xff/255.0, 0xc8/255.0, 0x4b/255.0, 1},
+                              (vec4){0xff/255.0, 0xe1/255.0, 0x64/255.0, 1},
+                              (vec4){0xff/255.0, 0xfa/255.0, 0x7d/255.0, 1},
+                              (vec4){0xfb/255.0, 0xff/255.0, 0x00/255.0, 1},
+                              (vec4){0x59/255.0, 0x59/255.0, 0xff/255.0, 1},
+                              (vec4){0x6a/255.0, 0x6a/255.0, 0xff/255.0, 1},
+                              (vec4){0x7a/255.0, 0x7a/255.0, 0xff/255.0, 1},
+                              (vec4){0x8b/255.0, 0x8b/255.0, 0xff/255.0, 1},
+                              (vec4){0x1b/255.0, 0xb0/255.0, 0x1b/255.0, 1},
+                              (vec4){0x24/255.0, 0xc8/255.0, 0x24/255.0, 1},
+                              (vec4){0x49/255.0, 0xff/255.0, 0x49/255.0, 1},
+                              (vec4){0x6a/255.0, 0xff/255.0, 0x6a/255.0, 1},
+                              (vec4){0xeb/255.0, 0x24/255.0, 0x24/255.0, 1},
+                              (vec4){0xff/255.0, 0x38/255.0, 0x38/255.0, 1},
+                              (vec4){0xff/255.0, 0x49/255.0, 0x49/255.0, 1},
+                              (vec4){0xff/255.0, 0x59/255.0, 0x59/255.0, 1},
+                              (vec4){0xb9/255.0, 0x38/255.0, 0xff/255.0, 1},
+                              (vec4){0xbf/255.0, 0x49/255.0, 0xff/255.0, 1},
+                              (vec4){0xc5/255.0, 0x59/255.0, 0xff/255.0, 1},
+                              (vec4){0xcb/255.0, 0x6a/255.0, 0xff/255.0, 1},
+                              (vec4){0x00/255.0, 0xff/255.0, 0x80/255.0, 1},
+                              (vec4){0xff/255.0, 0x80/255.0, 0x40/255.0, 1},
+                              (vec4){0xff/255.0, 0xff/255.0, 0x80/255.0, 1},
+                              (vec4){0x21/255.0, 0xd7/255.0, 0xd7/255.0, 1},
+                              (vec4){0x1b/255.0, 0xb0/255.0, 0xb0/255.0, 1},
+                              (vec4){0x18/255.0, 0x9c/255.0, 0x9c/255.0, 1},
+                              (vec4){0x15/255.0, 0x89/255.0, 0x89/255.0, 1}};
+
+
 vec4
 get_state_colour(CellState state)
 {
-  vec4 colours[] = {(vec4){0x60/255.0, 0x60/255.0, 0x60/255.0, 1},
-                    (vec4){0xff/255.0, 0xA0/255.0, 0xA0/255.0, 1},
-                    (vec4){0xff/255.0, 0x7d/255.0, 0x00/255.0, 1},
-                    (vec4){0xff/255.0, 0x96/255.0, 0x19/255.0, 1},
-                    (vec4){0xff/255.0, 0xaf/255.0, 0x32/255.0, 1},
-                    (vec4){0xff/255.0, 0xc8/255.0, 0x4b/255.0, 1},
-                    (vec4){0xff/255.0, 0xe1/255.0, 0x64/255.0, 1},
-                    (vec4){0xff/255.0, 0xfa/255.0, 0x7d/255.0, 1},
-                    (vec4){0xfb/255.0, 0xff/255.0, 0x00/255.0, 1},
-                    (vec4){0x59/255.0, 0x59/255.0, 0xff/255.0, 1},
-                    (vec4){0x6a/255.0, 0x6a/255.0, 0xff/255.0, 1},
-                    (vec4){0x7a/255.0, 0x7a/255.0, 0xff/255.0, 1},
-                    (vec4){0x8b/255.0, 0x8b/255.0, 0xff/255.0, 1},
-                    (vec4){0x1b/255.0, 0xb0/255.0, 0x1b/255.0, 1},
-                    (vec4){0x24/255.0, 0xc8/255.0, 0x24/255.0, 1},
-                    (vec4){0x49/255.0, 0xff/255.0, 0x49/255.0, 1},
-                    (vec4){0x6a/255.0, 0xff/255.0, 0x6a/255.0, 1},
-                    (vec4){0xeb/255.0, 0x24/255.0, 0x24/255.0, 1},
-                    (vec4){0xff/255.0, 0x38/255.0, 0x38/255.0, 1},
-                    (vec4){0xff/255.0, 0x49/255.0, 0x49/255.0, 1},
-                    (vec4){0xff/255.0, 0x59/255.0, 0x59/255.0, 1},
-                    (vec4){0xb9/255.0, 0x38/255.0, 0xff/255.0, 1},
-                    (vec4){0xbf/255.0, 0x49/255.0, 0xff/255.0, 1},
-                    (vec4){0xc5/255.0, 0x59/255.0, 0xff/255.0, 1},
-                    (vec4){0xcb/255.0, 0x6a/255.0, 0xff/255.0, 1},
-                    (vec4){0x00/255.0, 0xff/255.0, 0x80/255.0, 1},
-                    (vec4){0xff/255.0, 0x80/255.0, 0x40/255.0, 1},
-                    (vec4){0xff/255.0, 0xff/255.0, 0x80/255.0, 1},
-                    (vec4){0x21/255.0, 0xd7/255.0, 0xd7/255.0, 1},
-                    (vec4){0x1b/255.0, 0xb0/255.0, 0xb0/255.0, 1},
-                    (vec4){0x18/255.0, 0x9c/255.0, 0x9c/255.0, 1},
-                    (vec4){0x15/255.0, 0x89/255.0, 0x89/255.0, 1}};
-
-  vec4 colour = colours[state % array_count(colours)];
+  vec4 colour = STATE_COLOURS[state % array_count(STATE_COLOURS)];
   return colour;
 }
 
 
+/// get_state_colour(state) == get_state_colour(state % get_n_state_colours()), for drawing with a
+///   palette
+u32
+get_n_state_colours()
+{
+  u32 result = array_count(STATE_COLOURS);
+  return result;
+}
+
+
 u32
 get_longest_state_name_length(NamedStates *named_states)
 {
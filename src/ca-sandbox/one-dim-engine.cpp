@@ -0,0 +1,374 @@
+#include "ca-sandbox/one-dim-engine.h"
+
+#include "engine/types.h"
+#include "engine/vectors.h"
+#include "engine/print.h"
+#include "engine/maths.h"
+#include "engine/allocate.h"
+
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/cell-block-coordinate-system.h"
+#include "ca-sandbox/simulate.h"
+#include "ca-sandbox/neighbourhood-region.h"
+
+#include <string.h>
+
+/// @file
+/// @brief  A dedicated engine for ONE_DIM rules, simulating a single row of cells
+///
+
+
+/// Reads the cell at a global cell position from the Universe, cells which aren't loaded or are
+///   DEBUG_STATE are unloaded_state.
+CellState
+read_universe_cell(Universe *universe, s32vec2 global_cell_position, CellState unloaded_state)
+{
+  CellState result = unloaded_state;
+
+  s32 cell_block_dim = s32(universe->cell_block_dim);
+  s32vec2 cell_block_position = {floor_divide(global_cell_position.x, cell_block_dim),
+                                 floor_divide(global_cell_position.y, cell_block_dim)};
+
+  CellBlock *cell_block = get_existing_cell_block(universe, cell_block_position);
+  if (cell_block != 0)
+  {
+    s32vec2 cell_position = vec2_subtract(global_cell_position, vec2_multiply(cell_block_position, cell_block_dim));
+    CellState cell_state = cell_block->cell_states[get_cell_index_in_block(universe, cell_position)];
+
+    if (cell_state != DEBUG_STATE)
+    {
+      result = cell_state;
+    }
+  }
+
+  return result;
+}
+
+
+/// (Re-)allocates the rows and history for n_cells, and fills them with unloaded_state.
+void
+allocate_one_dim_engine_rows(OneDimEngine *engine, u32 n_cells)
+{
+  if (engine->row != 0)
+  {
+    un_allocate(engine->row);
+    un_allocate(engine->next_row);
+    un_allocate(engine->history);
+  }
+
+  u32 padded_length = n_cells + (2 * engine->padding);
+  engine->n_cells = n_cells;
+  engine->row = allocate(CellState, padded_length);
+  engine->next_row = allocate(CellState, padded_length);
+  engine->history = allocate(CellState, n_cells * engine->history_length);
+
+  for (u32 cell_n = 0;
+       cell_n < padded_length;
+       ++cell_n)
+  {
+    engine->row[cell_n] = engine->unloaded_state;
+    engine->next_row[cell_n] = engine->unloaded_state;
+  }
+
+  for (u32 cell_n = 0;
+       cell_n < n_cells * engine->history_length;
+       ++cell_n)
+  {
+    engine->history[cell_n] = engine->unloaded_state;
+  }
+}
+
+
+/// Initialises the engine from a row of the Universe.
+///
+/// With a FIXED or TORUS border the row covers the border, with an INFINITE border it covers the
+///   CellBlock%s currently loaded.
+///
+/// @param[in] row_y  The global cell y position of the row to simulate
+/// @param[in] history_length  The number of generations kept in the history
+///
+/// @returns  false if the rule isn't one dimensional, or the row isn't inside the border.
+b32
+init_one_dim_engine(OneDimEngine *engine, Rule *rule, Universe *universe, Border *border, s32 row_y, u32 history_length)
+{
+  b32 success = true;
+
+  destroy_one_dim_engine(engine);
+
+  if (rule->config.neighbourhood_region_shape != NeighbourhoodRegionShape::ONE_DIM ||
+      rule->input_deltas.n_elements != rule->n_inputs)
+  {
+    print("Error: The one dimensional engine needs a built ONE_DIM rule.\n");
+    success &= false;
+  }
+  else
+  {
+    s32 cell_block_dim = s32(universe->cell_block_dim);
+
+    s32 start_x;
+    s32 end_x;
+
+    if (border->type == BorderType::INFINITE)
+    {
+      s32vec2 lowest_block;
+      s32vec2 highest_block;
+      get_cell_blocks_dimentions(universe, &lowest_block, &highest_block);
+
+      start_x = lowest_block.x * cell_block_dim;
+      end_x = (highest_block.x + 1) * cell_block_dim;
+
+      if (universe->n_cell_blocks_in_use == 0)
+      {
+        print("Error: There are no cells to simulate.\n");
+        success &= false;
+      }
+    }
+    else
+    {
+      s32vec2 min_corner = vec2_add(vec2_multiply(border->min_corner_block, cell_block_dim), border->min_corner_cell);
+      s32vec2 max_corner = vec2_add(vec2_multiply(border->max_corner_block, cell_block_dim), border->max_corner_cell);
+
+      start_x = min_corner.x;
+      end_x = max_corner.x;
+
+      if (row_y < min_corner.y || row_y >= max_corner.y || start_x >= end_x)
+      {
+        print("Error: Row %d is outside the border.\n", row_y);
+        success &= false;
+      }
+    }
+
+    if (success)
+    {
+      engine->border_type = border->type;
+      engine->origin = {start_x, row_y};
+      engine->padding = rule->input_reach.x;
+      engine->generation = 0;
+      engine->history_length = max(history_length, 1u);
+
+      engine->unloaded_state = 0;
+      if (rule->config.null_states.n_elements > 0)
+      {
+        engine->unloaded_state = rule->config.null_states[0];
+      }
+
+      allocate_one_dim_engine_rows(engine, end_x - start_x);
+
+      CellState *row = engine->row + engine->padding;
+      for (u32 cell_n = 0;
+           cell_n < engine->n_cells;
+           ++cell_n)
+      {
+        row[cell_n] = read_universe_cell(universe, (s32vec2){start_x + (s32)cell_n, row_y}, engine->unloaded_state);
+      }
+
+      memcpy(engine->history, row, engine->n_cells * sizeof(CellState));
+    }
+  }
+
+  return success;
+}
+
+
+/// Grows an INFINITE row if there are non-null cells within the padding distance of either end,
+///   so they can't interact with the unloaded cells outside the row.  The history is re-laid out
+///   at the new width.
+void
+grow_one_dim_engine_if_needed(OneDimEngine *engine, Rule *rule)
+{
+  CellState *row = engine->row + engine->padding;
+
+  u32 edge_width = min(engine->padding, engine->n_cells);
+
+  b32 grow_west = false;
+  b32 grow_east = false;
+  for (u32 cell_n = 0;
+       cell_n < edge_width;
+       ++cell_n)
+  {
+    grow_west |= !is_null_state(&rule->config, row[cell_n]);
+    grow_east |= !is_null_state(&rule->config, row[engine->n_cells - 1 - cell_n]);
+  }
+
+  if (grow_west || grow_east)
+  {
+    u32 growth = max(engine->padding, engine->n_cells / 2);
+    u32 west_growth = grow_west ? growth : 0;
+    u32 east_growth = grow_east ? growth : 0;
+
+    u32 old_n_cells = engine->n_cells;
+    CellState *old_row = engine->row;
+    CellState *old_next_row = engine->next_row;
+    CellState *old_history = engine->history;
+
+    engine->row = 0;
+    allocate_one_dim_engine_rows(engine, old_n_cells + west_growth + east_growth);
+
+    memcpy(engine->row + engine->padding + west_growth, old_row + engine->padding, old_n_cells * sizeof(CellState));
+
+    for (u32 history_row_n = 0;
+         history_row_n < engine->history_length;
+         ++history_row_n)
+    {
+      memcpy(engine->history + (history_row_n * engine->n_cells) + west_growth,
+             old_history + (history_row_n * old_n_cells),
+             old_n_cells * sizeof(CellState));
+    }
+
+    engine->origin.x -= west_growth;
+
+    un_allocate(old_row);
+    un_allocate(old_next_row);
+    un_allocate(old_history);
+  }
+}
+
+
+/// Fills the padding either side of the row for the border type
+void
+fill_one_dim_engine_padding(OneDimEngine *engine)
+{
+  CellState *row = engine->row + engine->padding;
+  s32 n_cells = s32(engine->n_cells);
+
+  for (s32 padding_n = 1;
+       padding_n <= s32(engine->padding);
+       ++padding_n)
+  {
+    if (engine->border_type == BorderType::TORUS)
+    {
+      row[-padding_n] = row[((-padding_n % n_cells) + n_cells) % n_cells];
+      row[n_cells - 1 + padding_n] = row[(n_cells - 1 + padding_n) % n_cells];
+    }
+    else
+    {
+      row[-padding_n] = engine->unloaded_state;
+      row[n_cells - 1 + padding_n] = engine->unloaded_state;
+    }
+  }
+}
+
+
+/// Simulates one generation, and writes it into the history.
+///
+/// With a FIXED border the cells within the input reach of either end are not simulated, and are
+///   DEBUG_STATE in the history as in simulate_cells().
+void
+step_one_dim_engine(OneDimEngine *engine, Rule *rule)
+{
+  if (engine->border_type == BorderType::INFINITE)
+  {
+    grow_one_dim_engine_if_needed(engine, rule);
+  }
+
+  fill_one_dim_engine_padding(engine);
+
+  CellState *row = engine->row + engine->padding;
+  CellState *next_row = engine->next_row + engine->padding;
+
+  u32 n_edge_cells = 0;
+  if (engine->border_type == BorderType::FIXED)
+  {
+    n_edge_cells = engine->padding;
+  }
+
+  if (engine->n_cells > 2*n_edge_cells)
+  {
+    transition_cell_row(rule, row + n_edge_cells, engine->n_cells - 2*n_edge_cells, next_row + n_edge_cells);
+  }
+
+  ++engine->generation;
+
+  CellState *history_row = engine->history + ((engine->generation % engine->history_length) * engine->n_cells);
+
+  for (u32 cell_n = 0;
+       cell_n < engine->n_cells;
+       ++cell_n)
+  {
+    if (cell_n < n_edge_cells || cell_n + n_edge_cells >= engine->n_cells)
+    {
+      // The neighbours read the unloaded state, but the cell is shown as not simulated
+      next_row[cell_n] = engine->unloaded_state;
+      history_row[cell_n] = DEBUG_STATE;
+    }
+    else
+    {
+      history_row[cell_n] = next_row[cell_n];
+    }
+  }
+
+  CellState *swap = engine->row;
+  engine->row = engine->next_row;
+  engine->next_row = swap;
+}
+
+
+/// Returns the row of the history for a generation, or 0 if it is no longer in the history.
+CellState *
+get_one_dim_history_row(OneDimEngine *engine, u64 generation)
+{
+  CellState *result = 0;
+
+  if (generation <= engine->generation &&
+      engine->generation - generation < engine->history_length)
+  {
+    result = engine->history + ((generation % engine->history_length) * engine->n_cells);
+  }
+
+  return result;
+}
+
+
+/// Writes the generations in the history into the Universe as a space-time image.  Generation g is
+///   written to the row g cells below the engine's row, so the image extends downwards as the
+///   simulation runs.
+void
+copy_one_dim_history_to_universe(OneDimEngine *engine, Universe *universe, CellInitialisationOptions *cell_initialisation_options)
+{
+  s32 cell_block_dim = s32(universe->cell_block_dim);
+
+  u64 first_generation = 0;
+  if (engine->generation >= engine->history_length)
+  {
+    first_generation = engine->generation - engine->history_length + 1;
+  }
+
+  for (u64 generation = first_generation;
+       generation <= engine->generation;
+       ++generation)
+  {
+    CellState *history_row = get_one_dim_history_row(engine, generation);
+    s32 global_y = engine->origin.y + (s32)generation;
+
+    for (u32 cell_n = 0;
+         cell_n < engine->n_cells;
+         ++cell_n)
+    {
+      s32vec2 global_cell_position = {engine->origin.x + (s32)cell_n, global_y};
+      s32vec2 cell_block_position = {floor_divide(global_cell_position.x, cell_block_dim),
+                                     floor_divide(global_cell_position.y, cell_block_dim)};
+
+      CellBlock *cell_block = get_or_create_cell_block(universe, cell_initialisation_options, cell_block_position);
+
+      s32vec2 cell_position = vec2_subtract(global_cell_position, vec2_multiply(cell_block_position, cell_block_dim));
+      cell_block->cell_states[get_cell_index_in_block(universe, cell_position)] = history_row[cell_n];
+    }
+  }
+}
+
+
+void
+destroy_one_dim_engine(OneDimEngine *engine)
+{
+  if (engine->row != 0)
+  {
+    un_allocate(engine->row);
+    un_allocate(engine->next_row);
+    un_allocate(engine->history);
+
+    engine->row = 0;
+    engine->next_row = 0;
+    engine->history = 0;
+  }
+  engine->n_cells = 0;
+}
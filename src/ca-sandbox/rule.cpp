@@ -6,6 +6,7 @@
 #include "engine/maths.h"
 #include "engine/my-array.h"
 #include "engine/timing.h"
+#include "engine/profiler.h"
 
 #include "ca-sandbox/load-rule.h"
 #include "ca-sandbox/simulate.h"
@@ -13,6 +14,8 @@
 
 #include "imgui/imgui.h"
 
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
 
@@ -38,6 +41,36 @@ is_null_state(RuleConfiguration *rule_configuration, CellState state)
 }
 
 
+b32
+count_matching_comparison(ComparisonOp comparison, u32 count, u32 comparison_n)
+{
+  b32 result = false;
+
+  if (comparison == ComparisonOp::GREATER_THAN)
+  {
+    result = count > comparison_n;
+  }
+  else if (comparison == ComparisonOp::GREATER_THAN_EQUAL)
+  {
+    result = count >= comparison_n;
+  }
+  else if (comparison == ComparisonOp::EQUAL)
+  {
+    result = count == comparison_n;
+  }
+  else if (comparison == ComparisonOp::LESS_THAN_EQUAL)
+  {
+    result = count <= comparison_n;
+  }
+  else if (comparison == ComparisonOp::LESS_THAN)
+  {
+    result = count < comparison_n;
+  }
+
+  return result;
+}
+
+
 /// Matches the input against the RulePatterns, finds the first matching rule pattern and uses that
 ///   output.
 ///
@@ -169,27 +202,7 @@ use_rule_patterns_to_get_result(RuleConfiguration *config, u32 n_inputs, CellSta
       // Now test the wildcard constraints
       if (rule_pattern.count_matching.enabled)
       {
-        if (rule_pattern.count_matching.comparison == ComparisonOp::GREATER_THAN)
-        {
-          matches = number_of_neighbours_matching_count_matching_states > rule_pattern.count_matching.comparison_n;
-        }
-        else
-        if (rule_pattern.count_matching.comparison == ComparisonOp::GREATER_THAN_EQUAL)
-        {
-          matches = number_of_neighbours_matching_count_matching_states >= rule_pattern.count_matching.comparison_n;
-        }
-        else if (rule_pattern.count_matching.comparison == ComparisonOp::EQUAL)
-        {
-          matches = number_of_neighbours_matching_count_matching_states == rule_pattern.count_matching.comparison_n;
-        }
-        else if (rule_pattern.count_matching.comparison == ComparisonOp::LESS_THAN_EQUAL)
-        {
-          matches = number_of_neighbours_matching_count_matching_states <= rule_pattern.count_matching.comparison_n;
-        }
-        else if (rule_pattern.count_matching.comparison == ComparisonOp::LESS_THAN)
-        {
-          matches = number_of_neighbours_matching_count_matching_states < rule_pattern.count_matching.comparison_n;
-        }
+        matches = count_matching_comparison(rule_pattern.count_matching.comparison, number_of_neighbours_matching_count_matching_states, rule_pattern.count_matching.comparison_n);
       }
 
       // If any OR_STATE is used in the pattern, we must have matched against one or more of them
@@ -225,6 +238,256 @@ use_rule_patterns_to_get_result(RuleConfiguration *config, u32 n_inputs, CellSta
 }
 
 
+u64
+get_cell_state_group_mask(CellStateGroup *states_group)
+{
+  u64 result = 0;
+
+  for (u32 group_state_n = 0;
+       group_state_n < states_group->states_used;
+       ++group_state_n)
+  {
+    CellState state = states_group->states[group_state_n];
+    if (state < MAX_RULE_PATTERN_MASK_STATES)
+    {
+      result |= (u64)1 << state;
+    }
+  }
+
+  return result;
+}
+
+
+/// Compiles the RulePatterns into Rule.pattern_masks, used by get_rule_pattern_result().  Must be
+///   called after the patterns are changed.  Rules with more than MAX_RULE_PATTERN_MASK_STATES
+///   states are not compiled.
+///
+void
+compile_rule_patterns(Rule *rule)
+{
+  RuleConfiguration *config = &rule->config;
+
+  rule->pattern_masks_compiled = false;
+  Array::free_array(rule->pattern_masks);
+
+  if (config->named_states.states.n_elements <= MAX_RULE_PATTERN_MASK_STATES)
+  {
+    rule->pattern_masks.element_size = sizeof(RulePatternMasks) + (rule->n_inputs * sizeof(PatternInputMasks));
+    Array::new_position_for_n(rule->pattern_masks, config->rule_patterns.n_elements);
+
+    for (u32 pattern_n = 0;
+         pattern_n < config->rule_patterns.n_elements;
+         ++pattern_n)
+    {
+      RulePattern *rule_pattern = Array::get(config->rule_patterns, pattern_n);
+      RulePatternMasks *pattern_masks = Array::get(rule->pattern_masks, pattern_n);
+
+      pattern_masks->result = rule_pattern->result;
+      pattern_masks->count_matching_enabled = rule_pattern->count_matching.enabled;
+      pattern_masks->comparison = rule_pattern->count_matching.comparison;
+      pattern_masks->comparison_n = rule_pattern->count_matching.comparison_n;
+      pattern_masks->or_matching_enabled = false;
+
+      u64 count_matching_states = get_cell_state_group_mask(&rule_pattern->count_matching.states_group);
+
+      for (u32 input_n = 0;
+           input_n < rule->n_inputs;
+           ++input_n)
+      {
+        PatternCellState *pattern_input = &rule_pattern->cell_states[input_n];
+        PatternInputMasks *input_masks = &pattern_masks->inputs[input_n];
+
+        u64 group_states = get_cell_state_group_mask(&pattern_input->states_group);
+
+        input_masks->match_states = ~(u64)0;
+        input_masks->or_states = 0;
+        input_masks->count_matching_states = 0;
+
+        switch (pattern_input->type)
+        {
+          case (PatternCellStateType::STATE):
+          {
+            input_masks->match_states = group_states;
+          } break;
+
+          case (PatternCellStateType::NOT_STATE):
+          {
+            input_masks->match_states = ~group_states;
+          } break;
+
+          case (PatternCellStateType::OR_STATE):
+          {
+            pattern_masks->or_matching_enabled = true;
+            input_masks->or_states = group_states;
+          } break;
+
+          case (PatternCellStateType::WILDCARD):
+          {
+            if (rule_pattern->count_matching.enabled)
+            {
+              input_masks->count_matching_states = count_matching_states;
+            }
+          } break;
+        }
+      }
+    }
+
+    // Index the patterns which can match each state at each input
+    Array::clear(rule->input_state_patterns);
+    if (rule->pattern_masks.n_elements <= MAX_RULE_PATTERN_CANDIDATES)
+    {
+      u32 n_states = config->named_states.states.n_elements;
+      u64 *input_state_patterns = Array::add_n(rule->input_state_patterns, rule->n_inputs * n_states);
+
+      for (u32 input_n = 0;
+           input_n < rule->n_inputs;
+           ++input_n)
+      {
+        for (CellState state = 0;
+             state < n_states;
+             ++state)
+        {
+          u64 candidate_patterns = 0;
+
+          for (u32 pattern_n = 0;
+               pattern_n < rule->pattern_masks.n_elements;
+               ++pattern_n)
+          {
+            RulePatternMasks *pattern_masks = Array::get(rule->pattern_masks, pattern_n);
+            if (pattern_masks->inputs[input_n].match_states & ((u64)1 << state))
+            {
+              candidate_patterns |= (u64)1 << pattern_n;
+            }
+          }
+
+          input_state_patterns[input_n * n_states + state] = candidate_patterns;
+        }
+      }
+    }
+
+    rule->pattern_masks_compiled = true;
+  }
+}
+
+
+b32
+rule_pattern_masks_match(RulePatternMasks *pattern_masks, u32 n_inputs, u64 input_state_bits[])
+{
+  b32 result = true;
+
+  u32 n_count_matching = 0;
+  u32 n_or_matching = 0;
+
+  for (u32 input_n = 0;
+       input_n < n_inputs;
+       ++input_n)
+  {
+    u64 state_bit = input_state_bits[input_n];
+    PatternInputMasks *input_masks = &pattern_masks->inputs[input_n];
+
+    if (!(state_bit & input_masks->match_states))
+    {
+      result = false;
+      break;
+    }
+
+    n_count_matching += (state_bit & input_masks->count_matching_states) != 0;
+    n_or_matching += (state_bit & input_masks->or_states) != 0;
+  }
+
+  if (result && pattern_masks->count_matching_enabled)
+  {
+    result = count_matching_comparison(pattern_masks->comparison, n_count_matching, pattern_masks->comparison_n);
+  }
+
+  if (result && pattern_masks->or_matching_enabled)
+  {
+    result = n_or_matching > 0;
+  }
+
+  return result;
+}
+
+
+/// The same as use_rule_patterns_to_get_result(), using the Rule.pattern_masks if they are
+///   compiled.
+///
+CellState
+get_rule_pattern_result(Rule *rule, CellState inputs[])
+{
+  CellState result;
+
+  if (!rule->pattern_masks_compiled)
+  {
+    result = use_rule_patterns_to_get_result(&rule->config, rule->n_inputs, inputs);
+  }
+  else
+  {
+    u64 input_state_bits[rule->n_inputs];
+    for (u32 input_n = 0;
+         input_n < rule->n_inputs;
+         ++input_n)
+    {
+      input_state_bits[input_n] = (u64)1 << inputs[input_n];
+    }
+
+    b32 found_match = false;
+
+    if (rule->input_state_patterns.n_elements > 0)
+    {
+      // Only test the patterns which can match every input's state on its own, in pattern order
+      u32 n_states = rule->input_state_patterns.n_elements / rule->n_inputs;
+      u64 candidate_patterns = ~(u64)0;
+
+      for (u32 input_n = 0;
+           input_n < rule->n_inputs && candidate_patterns != 0;
+           ++input_n)
+      {
+        candidate_patterns &= rule->input_state_patterns[input_n * n_states + inputs[input_n]];
+      }
+
+      while (candidate_patterns != 0)
+      {
+        u32 pattern_n = __builtin_ctzll(candidate_patterns);
+        candidate_patterns &= candidate_patterns - 1;
+
+        RulePatternMasks *pattern_masks = Array::get(rule->pattern_masks, pattern_n);
+        if (rule_pattern_masks_match(pattern_masks, rule->n_inputs, input_state_bits))
+        {
+          found_match = true;
+          result = pattern_masks->result;
+          break;
+        }
+      }
+    }
+    else
+    {
+      for (u32 pattern_n = 0;
+           pattern_n < rule->pattern_masks.n_elements;
+           ++pattern_n)
+      {
+        RulePatternMasks *pattern_masks = Array::get(rule->pattern_masks, pattern_n);
+        if (rule_pattern_masks_match(pattern_masks, rule->n_inputs, input_state_bits))
+        {
+          found_match = true;
+          result = pattern_masks->result;
+          break;
+        }
+      }
+    }
+
+    if (!found_match)
+    {
+      // Default rule, keep previous state
+      u32 center_position = get_neighbourhood_region_centre_index(rule->config.neighbourhood_region_shape, rule->config.neighbourhood_region_size);
+      result = inputs[center_position];
+    }
+  }
+
+  return result;
+}
+
+
 /// Finds and returns the position of an existing RuleNode within the rule storage which matches the
 ///   RuleNode passed in.
 ///
@@ -271,6 +534,31 @@ find_node(Rule *rule, RuleNode *node)
 }
 
 
+/// Adds a finished node to the rule_nodes_table, unless it matches an existing node.
+///
+/// @returns  The position of the node in the rule_nodes_table
+u32
+add_or_find_rule_node(Rule *rule, RuleNode *node)
+{
+  u32 node_position;
+
+  // If it matches any existing nodes, use their index instead of creating a new node.
+  s32 existing_node_position = find_node(rule, node);
+  if (existing_node_position >= 0)
+  {
+    node_position = existing_node_position;
+  }
+  else
+  {
+    // Create new node
+    node_position = Array::new_position(rule->rule_nodes_table);
+    Array::set(rule->rule_nodes_table, node_position, node);
+  }
+
+  return node_position;
+}
+
+
 u32
 add_node_to_rule_tree(Rule *rule, u32 depth, CellState tree_path[], Array::Array<RuleNode, true>& current_node_path, Progress *progress)
 {
@@ -284,7 +572,7 @@ add_node_to_rule_tree(Rule *rule, u32 depth, CellState tree_path[], Array::Array
   if (depth == rule->n_inputs)
   {
     node->is_leaf = true;
-    node->leaf_value = use_rule_patterns_to_get_result(&rule->config, rule->n_inputs, tree_path);
+    node->leaf_value = get_rule_pattern_result(rule, tree_path);
 
     progress->done += 1;
 
@@ -315,82 +603,546 @@ add_node_to_rule_tree(Rule *rule, u32 depth, CellState tree_path[], Array::Array
     }
   }
 
-  // Optimise finished node
-
-  // If it matches any existing nodes, use their index instead of creating a new node.
-  s32 existing_node_position = find_node(rule, node);
-  if (existing_node_position >= 0)
-  {
-    node_position = existing_node_position;
-  }
-  else
-  {
-    // Create new node
-    node_position = Array::new_position(rule->rule_nodes_table);
-    Array::set(rule->rule_nodes_table, node_position, node);
-  }
+  node_position = add_or_find_rule_node(rule, node);
 
   return node_position;
 }
 
 
-/// Set Rule.config values before calling!
+/// Re-lays out the rule_nodes_table in breadth-first order from the root node, so the nodes near the
+///   top of the tree, which every traversal passes through, share cache lines.  Nodes are appended
+///   to the table as they are finished during the build, which scatters the nodes visited by a
+///   single traversal across the whole table.
+///
+/// If node_visits is given (from RuleTraversalStats), each node's children are queued most visited
+///   first, so the hot paths are packed at the start of each level of the tree.
+///
+/// The root node moves to position 0, and nodes which are not reachable from the root, left behind
+///   by rebuild_rule_tree_incrementally(), are removed.
+///
 void
-build_rule_tree(RuleCreationThread *rule_creation_thread)
+reorder_rule_tree(Rule *rule, Array::Array<u64> *node_visits)
 {
-  Rule *rule = rule_creation_thread->rule;
-
-  rule->rule_tree_built = false;
+  PROFILE_SCOPE("reorder_rule_tree");
 
+  u32 n_nodes = rule->rule_nodes_table.n_elements;
   u32 n_states = rule->config.named_states.states.n_elements;
-  rule->rule_nodes_table.element_size = sizeof(RuleNode) + (n_states * sizeof(u32));
-  Array::free_array(rule->rule_nodes_table);
 
-  rule->n_inputs = get_neighbourhood_region_n_cells(rule->config.neighbourhood_region_shape, rule->config.neighbourhood_region_size);
+  if (node_visits != 0 && node_visits->n_elements != n_nodes)
+  {
+    node_visits = 0;
+  }
 
-  rule_creation_thread->progress.total = ipow((u64)rule->config.named_states.states.n_elements, (u64)rule->n_inputs);
-  rule_creation_thread->progress.done = 0;
-  print("Building rule tree: %lu\n", rule_creation_thread->progress.total);
+  // new_positions[old position] is the new position + 1, or 0 if the node is not yet queued
+  u32 *new_positions = allocate(u32, n_nodes);
 
-  u64 build_start_time = get_us();
+  // node_order[new position] is the old position
+  u32 *node_order = allocate(u32, n_nodes);
+  u32 n_queued = 0;
 
-  // The tree_path is used to store the route taken through the tree to reach a leaf node.
-  CellState *tree_path = allocate(CellState, rule->n_inputs);
+  CellState *child_order = allocate(CellState, n_states);
 
-  // One node per depth of the tree used to store the currently being built nodes to get to the
-  //   current position in the tree.  One a node is finished, it is added to the
-  //   rule->rule_nodes_table, and the next sibling in the tree is able to use the current_node_path
-  //   node it was occupying.  Need n_inputs+1 for leaf "result node".
-  //
-  // Using an Array to make dealing with variable sized structs easy, need to pre-allocate all the
-  //   elements in the array
-  Array::Array<RuleNode, true> current_node_path = {};
-  current_node_path.element_size = rule->rule_nodes_table.element_size;
-  Array::new_position_for_n(current_node_path, rule->n_inputs + 1);
+  node_order[n_queued++] = rule->root_node;
+  new_positions[rule->root_node] = n_queued;
 
-  rule->root_node = add_node_to_rule_tree(rule, 0, tree_path, current_node_path, &rule_creation_thread->progress);
+  for (u32 queue_n = 0;
+       queue_n < n_queued;
+       ++queue_n)
+  {
+    RuleNode *node = Array::get(rule->rule_nodes_table, node_order[queue_n]);
+    if (!node->is_leaf)
+    {
+      for (u32 child_n = 0;
+           child_n < n_states;
+           ++child_n)
+      {
+        // Insertion sort, most visited child first
+        u32 i = child_n;
+        if (node_visits != 0)
+        {
+          u64 visits = (*node_visits)[node->children[child_n]];
+          while (i > 0 && (*node_visits)[node->children[child_order[i - 1]]] < visits)
+          {
+            child_order[i] = child_order[i - 1];
+            --i;
+          }
+        }
+        child_order[i] = child_n;
+      }
 
-  Array::free_array(current_node_path);
-  un_allocate(tree_path);
+      for (u32 child_n = 0;
+           child_n < n_states;
+           ++child_n)
+      {
+        u32 child_position = node->children[child_order[child_n]];
+        if (new_positions[child_position] == 0)
+        {
+          node_order[n_queued++] = child_position;
+          new_positions[child_position] = n_queued;
+        }
+      }
+    }
+  }
 
-  rule_creation_thread->last_build_total_time = get_us() - build_start_time;
+  Array::Array<RuleNode, true> old_nodes_table = {};
+  old_nodes_table.element_size = rule->rule_nodes_table.element_size;
+  Array::add_n(old_nodes_table, rule->rule_nodes_table.elements, n_nodes);
 
-  rule->rule_tree_built = true;
-  rule_creation_thread->currently_running = false;
-}
+  // Drop the nodes which are no longer reachable from the root
+  rule->rule_nodes_table.n_elements = n_queued;
 
+  for (u32 node_n = 0;
+       node_n < n_queued;
+       ++node_n)
+  {
+    RuleNode *node = Array::get(rule->rule_nodes_table, node_n);
+    Array::set(rule->rule_nodes_table, node_n, Array::get(old_nodes_table, node_order[node_n]));
 
-void *
-build_rule_tree_thread(void *rule_creation_thread)
-{
-  build_rule_tree((RuleCreationThread *)rule_creation_thread);
+    if (!node->is_leaf)
+    {
+      for (u32 child_n = 0;
+           child_n < n_states;
+           ++child_n)
+      {
+        node->children[child_n] = new_positions[node->children[child_n]] - 1;
+      }
+    }
+  }
 
-  return NULL;
+  rule->root_node = new_positions[rule->root_node] - 1;
+
+  Array::free_array(old_nodes_table);
+  un_allocate(child_order);
+  un_allocate(node_order);
+  un_allocate(new_positions);
 }
 
 
-b32
-start_build_rule_tree_thread(RuleCreationThread *rule_creation_thread, Rule *result)
+/// Creates a new node in a lazy rule tree, for the path given by the first depth inputs.  Nodes at
+///   the bottom of the tree are leaves, which are shared between all paths with the same result.
+///
+/// @returns  The position of the node in the rule_nodes_table
+u32
+materialise_rule_node(Rule *rule, u32 depth, CellState inputs[])
+{
+  u32 node_position;
+
+  if (depth == rule->n_inputs)
+  {
+    CellState leaf_value = get_rule_pattern_result(rule, inputs);
+
+    while (leaf_value >= rule->lazy_leaf_nodes.n_elements)
+    {
+      Array::add(rule->lazy_leaf_nodes, UNBUILT_RULE_NODE);
+    }
+
+    node_position = rule->lazy_leaf_nodes[leaf_value];
+    if (node_position == UNBUILT_RULE_NODE)
+    {
+      node_position = Array::new_position(rule->rule_nodes_table);
+      RuleNode *node = Array::get(rule->rule_nodes_table, node_position);
+      node->is_leaf = true;
+      node->leaf_value = leaf_value;
+
+      rule->lazy_leaf_nodes[leaf_value] = node_position;
+    }
+  }
+  else
+  {
+    node_position = Array::new_position(rule->rule_nodes_table);
+    RuleNode *node = Array::get(rule->rule_nodes_table, node_position);
+    node->is_leaf = false;
+
+    for (u32 child_n = 0;
+         child_n < rule->config.named_states.states.n_elements;
+         ++child_n)
+    {
+      node->children[child_n] = UNBUILT_RULE_NODE;
+    }
+  }
+
+  return node_position;
+}
+
+
+/// Returns false if no input with this state at the pattern cell's position can match the pattern.
+///   Only STATE and NOT_STATE cells restrict the state at their own position, count_matching and
+///   OR_STATE depend on the rest of the neighbourhood.
+///
+b32
+pattern_cell_may_match(PatternCellState *pattern_cell, CellState state)
+{
+  b32 result = true;
+
+  if (pattern_cell->type == PatternCellStateType::STATE ||
+      pattern_cell->type == PatternCellStateType::NOT_STATE)
+  {
+    b32 in_group = false;
+    for (u32 group_state_n = 0;
+         group_state_n < pattern_cell->states_group.states_used;
+         ++group_state_n)
+    {
+      if (pattern_cell->states_group.states[group_state_n] == state)
+      {
+        in_group = true;
+        break;
+      }
+    }
+
+    result = pattern_cell->type == PatternCellStateType::STATE ? in_group : !in_group;
+  }
+
+  return result;
+}
+
+
+/// Saves the current rule configuration as the Rule.tree_source, call after the rule tree has been
+///   built from it.
+///
+void
+save_rule_tree_source(Rule *rule)
+{
+  RuleTreeSource *source = &rule->tree_source;
+
+  source->neighbourhood_region_shape = rule->config.neighbourhood_region_shape;
+  source->neighbourhood_region_size = rule->config.neighbourhood_region_size;
+  source->n_states = rule->config.named_states.states.n_elements;
+
+  Array::free_array(source->rule_patterns);
+  source->rule_patterns.element_size = rule->config.rule_patterns.element_size;
+  Array::add_n(source->rule_patterns, rule->config.rule_patterns.elements, rule->config.rule_patterns.n_elements);
+
+  source->valid = true;
+}
+
+
+/// Maximum number of changed patterns for an incremental rebuild, one bit each in a u64
+const u32 MAX_INCREMENTAL_RULE_CHANGES = 64;
+
+
+/// Compares the rule configuration against the Rule.tree_source, listing the old and new versions of
+///   each changed pattern in changed_patterns.
+///
+/// Only inputs which match either version of a changed pattern can have a different result, so
+///   the rest of the rule tree can be kept.
+///
+/// @returns  false if the tree can't be rebuilt incrementally, because it isn't built, or the
+///             neighbourhood or states have changed, or patterns have been removed.
+b32
+find_changed_rule_patterns(Rule *rule, Array::Array<RulePattern *>& changed_patterns)
+{
+  RuleConfiguration *config = &rule->config;
+  RuleTreeSource *source = &rule->tree_source;
+
+  b32 result = (rule->rule_tree_built &&
+                !rule->lazy_rule_tree &&
+                source->valid &&
+                source->neighbourhood_region_shape == config->neighbourhood_region_shape &&
+                source->neighbourhood_region_size == config->neighbourhood_region_size &&
+                source->n_states == config->named_states.states.n_elements &&
+                source->rule_patterns.element_size == config->rule_patterns.element_size &&
+                source->rule_patterns.n_elements <= config->rule_patterns.n_elements);
+
+  if (result)
+  {
+    // The comment doesn't affect the result
+    u32 compare_offset = offsetof(RulePattern, result);
+    u32 compare_size = config->rule_patterns.element_size - compare_offset;
+
+    for (u32 pattern_n = 0;
+         pattern_n < config->rule_patterns.n_elements;
+         ++pattern_n)
+    {
+      RulePattern *new_pattern = Array::get(config->rule_patterns, pattern_n);
+
+      if (pattern_n >= source->rule_patterns.n_elements)
+      {
+        Array::add(changed_patterns, new_pattern);
+      }
+      else
+      {
+        RulePattern *old_pattern = Array::get(source->rule_patterns, pattern_n);
+        if (memcmp((u8 *)old_pattern + compare_offset, (u8 *)new_pattern + compare_offset, compare_size) != 0)
+        {
+          Array::add(changed_patterns, old_pattern);
+          Array::add(changed_patterns, new_pattern);
+        }
+      }
+    }
+
+    result &= changed_patterns.n_elements <= MAX_INCREMENTAL_RULE_CHANGES;
+  }
+
+  return result;
+}
+
+
+/// Re-evaluates the paths below old_node_position which could match any of the changed patterns
+///   flagged in possible_changes, and re-uses the old child nodes for the rest.
+///
+/// @returns  The position of the new node in the rule_nodes_table
+u32
+rebuild_rule_sub_tree(Rule *rule, u32 old_node_position, u32 depth, CellState tree_path[], Array::Array<RulePattern *>& changed_patterns, u64 possible_changes, Array::Array<RuleNode, true>& current_node_path, Progress *progress)
+{
+  u32 node_position;
+
+  // Temporary storage for the node
+  RuleNode *node = Array::get(current_node_path, depth);
+
+  if (depth == rule->n_inputs)
+  {
+    node->is_leaf = true;
+    node->leaf_value = get_rule_pattern_result(rule, tree_path);
+
+    progress->done += 1;
+  }
+  else
+  {
+    u32 n_states = rule->config.named_states.states.n_elements;
+
+    RuleNode *old_node = Array::get(rule->rule_nodes_table, old_node_position);
+    node->is_leaf = false;
+    memcpy(node->children, old_node->children, n_states * sizeof(u32));
+
+    for (CellState child_n = 0;
+         child_n < n_states;
+         ++child_n)
+    {
+      u64 child_possible_changes = 0;
+
+      for (u32 change_n = 0;
+           change_n < changed_patterns.n_elements;
+           ++change_n)
+      {
+        u64 change_bit = (u64)1 << change_n;
+        if ((possible_changes & change_bit) &&
+            pattern_cell_may_match(&changed_patterns[change_n]->cell_states[depth], child_n))
+        {
+          child_possible_changes |= change_bit;
+        }
+      }
+
+      if (child_possible_changes != 0)
+      {
+        tree_path[depth] = child_n;
+        node->children[child_n] = rebuild_rule_sub_tree(rule, node->children[child_n], depth + 1, tree_path, changed_patterns, child_possible_changes, current_node_path, progress);
+      }
+    }
+  }
+
+  node_position = add_or_find_rule_node(rule, node);
+
+  return node_position;
+}
+
+
+/// Rebuilds only the parts of the rule tree affected by the changed_patterns found by
+///   find_changed_rule_patterns().  New nodes are added to the end of the rule_nodes_table, and
+///   then reorder_rule_tree() removes the nodes which are no longer used.
+///
+void
+rebuild_rule_tree_incrementally(Rule *rule, Array::Array<RulePattern *>& changed_patterns, Progress *progress)
+{
+  // Upper bound on the number of leaves to re-evaluate
+  progress->total = 0;
+  progress->done = 0;
+  for (u32 change_n = 0;
+       change_n < changed_patterns.n_elements;
+       ++change_n)
+  {
+    u64 n_matching_inputs = 1;
+    for (u32 input_n = 0;
+         input_n < rule->n_inputs;
+         ++input_n)
+    {
+      u64 n_matching_states = 0;
+      for (CellState state = 0;
+           state < rule->config.named_states.states.n_elements;
+           ++state)
+      {
+        n_matching_states += pattern_cell_may_match(&changed_patterns[change_n]->cell_states[input_n], state);
+      }
+      n_matching_inputs *= n_matching_states;
+    }
+    progress->total += n_matching_inputs;
+  }
+
+  print("Rebuilding rule tree for %u changed patterns: %lu\n", changed_patterns.n_elements, progress->total);
+
+  compile_rule_patterns(rule);
+
+  CellState *tree_path = allocate(CellState, rule->n_inputs);
+
+  Array::Array<RuleNode, true> current_node_path = {};
+  current_node_path.element_size = rule->rule_nodes_table.element_size;
+  Array::new_position_for_n(current_node_path, rule->n_inputs + 1);
+
+  if (changed_patterns.n_elements > 0)
+  {
+    u64 all_changes = ((u64)-1) >> (MAX_INCREMENTAL_RULE_CHANGES - changed_patterns.n_elements);
+    rule->root_node = rebuild_rule_sub_tree(rule, rule->root_node, 0, tree_path, changed_patterns, all_changes, current_node_path, progress);
+  }
+
+  Array::free_array(current_node_path);
+  un_allocate(tree_path);
+
+  reorder_rule_tree(rule);
+  build_compact_rule_tree(rule);
+}
+
+
+/// Enumerates all the inputs to the transition function, building the full rule tree
+void
+enumerate_rule_tree(Rule *rule, Progress *progress)
+{
+  progress->total = ipow((u64)rule->config.named_states.states.n_elements, (u64)rule->n_inputs);
+  progress->done = 0;
+  print("Building rule tree: %lu\n", progress->total);
+
+  // The tree_path is used to store the route taken through the tree to reach a leaf node.
+  CellState *tree_path = allocate(CellState, rule->n_inputs);
+
+  // One node per depth of the tree used to store the currently being built nodes to get to the
+  //   current position in the tree.  One a node is finished, it is added to the
+  //   rule->rule_nodes_table, and the next sibling in the tree is able to use the current_node_path
+  //   node it was occupying.  Need n_inputs+1 for leaf "result node".
+  //
+  // Using an Array to make dealing with variable sized structs easy, need to pre-allocate all the
+  //   elements in the array
+  Array::Array<RuleNode, true> current_node_path = {};
+  current_node_path.element_size = rule->rule_nodes_table.element_size;
+  Array::new_position_for_n(current_node_path, rule->n_inputs + 1);
+
+  rule->root_node = add_node_to_rule_tree(rule, 0, tree_path, current_node_path, progress);
+
+  Array::free_array(current_node_path);
+  un_allocate(tree_path);
+
+  reorder_rule_tree(rule);
+  build_compact_rule_tree(rule);
+}
+
+
+/// Set Rule.config values before calling!
+/// Fills in the Rule's input_deltas and input_reach from its neighbourhood region, so the
+///   simulation doesn't have to work out each input's position per cell.
+///
+void
+build_rule_input_deltas(Rule *rule)
+{
+  Array::clear(rule->input_deltas);
+  rule->input_reach = {0, 0};
+
+  for (u32 input_n = 0;
+       input_n < rule->n_inputs;
+       ++input_n)
+  {
+    s32vec2 input_delta = get_neighbourhood_region_cell_delta(rule->config.neighbourhood_region_shape, rule->config.neighbourhood_region_size, input_n);
+    Array::add(rule->input_deltas, input_delta);
+
+    rule->input_reach = vec2_max(rule->input_reach, (s32vec2){abs(input_delta.x), abs(input_delta.y)});
+  }
+
+  // Invalidate the offsets for the old deltas
+  rule->input_offsets_block_dim = 0;
+}
+
+
+/// Re-calculates the Rule's input_offsets if they were calculated for a different cell_block_dim
+///
+void
+update_rule_input_offsets(Rule *rule, u32 cell_block_dim)
+{
+  if (rule->input_offsets_block_dim != cell_block_dim ||
+      rule->input_offsets.n_elements != rule->input_deltas.n_elements)
+  {
+    Array::clear(rule->input_offsets);
+
+    for (u32 input_n = 0;
+         input_n < rule->input_deltas.n_elements;
+         ++input_n)
+    {
+      s32vec2 input_delta = rule->input_deltas[input_n];
+      Array::add(rule->input_offsets, (input_delta.y * (s32)cell_block_dim) + input_delta.x);
+    }
+
+    rule->input_offsets_block_dim = cell_block_dim;
+  }
+}
+
+
+void
+build_rule_tree(RuleCreationThread *rule_creation_thread)
+{
+  PROFILE_SCOPE("build_rule_tree");
+
+  Rule *rule = rule_creation_thread->rule;
+
+  u64 build_start_time = get_us();
+
+  Array::Array<RulePattern *> changed_patterns = {};
+
+  if (!rule_creation_thread->build_lazily &&
+      find_changed_rule_patterns(rule, changed_patterns))
+  {
+    rule->rule_tree_built = false;
+    destroy_compact_rule_tree(&rule->compact_tree);
+
+    rebuild_rule_tree_incrementally(rule, changed_patterns, &rule_creation_thread->progress);
+  }
+  else
+  {
+    destroy_rule_tree(rule);
+
+    u32 n_states = rule->config.named_states.states.n_elements;
+    rule->rule_nodes_table.element_size = sizeof(RuleNode) + (n_states * sizeof(u32));
+
+    rule->n_inputs = get_neighbourhood_region_n_cells(rule->config.neighbourhood_region_shape, rule->config.neighbourhood_region_size);
+    build_rule_input_deltas(rule);
+
+    compile_rule_patterns(rule);
+
+    if (rule_creation_thread->build_lazily)
+    {
+      // Only the root node is created now, the rest of the tree is built by
+      //   execute_transition_function() as it is used.
+      print("Starting lazy rule tree\n");
+
+      rule->lazy_rule_tree = true;
+      rule->root_node = materialise_rule_node(rule, 0, 0);
+    }
+    else
+    {
+      enumerate_rule_tree(rule, &rule_creation_thread->progress);
+    }
+  }
+
+  // changed_patterns points into the old tree_source
+  Array::free_array(changed_patterns);
+
+  if (!rule->lazy_rule_tree)
+  {
+    save_rule_tree_source(rule);
+  }
+
+  rule_creation_thread->last_build_total_time = get_us() - build_start_time;
+
+  rule->rule_tree_built = true;
+  rule_creation_thread->currently_running = false;
+}
+
+
+void *
+build_rule_tree_thread(void *rule_creation_thread)
+{
+  build_rule_tree((RuleCreationThread *)rule_creation_thread);
+
+  return NULL;
+}
+
+
+b32
+start_build_rule_tree_thread(RuleCreationThread *rule_creation_thread, Rule *result)
 {
   b32 success = true;
 
@@ -418,11 +1170,186 @@ start_build_rule_tree_thread(RuleCreationThread *rule_creation_thread, Rule *res
 }
 
 
+/// Returns the CompactRuleTree child entry referring to the node at node_position
+u32
+get_compact_rule_entry(Rule *rule, u32 node_position, u32 compact_offsets[], u32 leaf_bit)
+{
+  u32 result;
+
+  RuleNode *node = Array::get(rule->rule_nodes_table, node_position);
+  if (node->is_leaf)
+  {
+    result = leaf_bit | node->leaf_value;
+  }
+  else
+  {
+    result = compact_offsets[node_position];
+  }
+
+  return result;
+}
+
+
+/// Builds the Rule.compact_tree from the rule_nodes_table.  If the tree is too big to encode, the
+///   compact tree is left un-built, and the rule_nodes_table is used instead.
+///
+void
+build_compact_rule_tree(Rule *rule)
+{
+  CompactRuleTree *compact_tree = &rule->compact_tree;
+  destroy_compact_rule_tree(compact_tree);
+
+  u32 n_nodes = rule->rule_nodes_table.n_elements;
+  u32 n_states = rule->config.named_states.states.n_elements;
+
+  // compact_offsets[node_n] is the offset of a non-leaf node's children in the compact tree
+  u32 *compact_offsets = allocate(u32, n_nodes);
+
+  u64 n_entries = 0;
+  CellState max_leaf_value = 0;
+
+  for (u32 node_n = 0;
+       node_n < n_nodes;
+       ++node_n)
+  {
+    RuleNode *node = Array::get(rule->rule_nodes_table, node_n);
+    if (node->is_leaf)
+    {
+      max_leaf_value = max(max_leaf_value, node->leaf_value);
+    }
+    else
+    {
+      compact_offsets[node_n] = n_entries;
+      n_entries += n_states;
+    }
+  }
+
+  if (n_nodes == 0 ||
+      n_entries > COMPACT_RULE_LEAF_BIT_32 || max_leaf_value >= COMPACT_RULE_LEAF_BIT_32)
+  {
+    print("Rule tree too large for the compact encoding, using the full rule nodes.\n");
+  }
+  else
+  {
+    compact_tree->narrow = n_entries <= COMPACT_RULE_LEAF_BIT_16 && max_leaf_value < COMPACT_RULE_LEAF_BIT_16;
+    u32 leaf_bit = compact_tree->narrow ? COMPACT_RULE_LEAF_BIT_16 : COMPACT_RULE_LEAF_BIT_32;
+
+    if (compact_tree->narrow)
+    {
+      Array::add_n(compact_tree->children_16, n_entries);
+    }
+    else
+    {
+      Array::add_n(compact_tree->children_32, n_entries);
+    }
+
+    for (u32 node_n = 0;
+         node_n < n_nodes;
+         ++node_n)
+    {
+      RuleNode *node = Array::get(rule->rule_nodes_table, node_n);
+      if (!node->is_leaf)
+      {
+        u32 offset = compact_offsets[node_n];
+
+        for (u32 child_n = 0;
+             child_n < n_states;
+             ++child_n)
+        {
+          u32 entry = get_compact_rule_entry(rule, node->children[child_n], compact_offsets, leaf_bit);
+          if (compact_tree->narrow)
+          {
+            compact_tree->children_16[offset + child_n] = entry;
+          }
+          else
+          {
+            compact_tree->children_32[offset + child_n] = entry;
+          }
+        }
+      }
+    }
+
+    compact_tree->root = get_compact_rule_entry(rule, rule->root_node, compact_offsets, leaf_bit);
+    compact_tree->built = true;
+  }
+
+  un_allocate(compact_offsets);
+}
+
+
+void
+destroy_compact_rule_tree(CompactRuleTree *compact_tree)
+{
+  compact_tree->built = false;
+  Array::free_array(compact_tree->children_16);
+  Array::free_array(compact_tree->children_32);
+}
+
+
+/// Returns the size of the compact tree's child entries in bytes
+u32
+get_compact_rule_tree_size(CompactRuleTree *compact_tree)
+{
+  u32 result = (compact_tree->children_16.n_elements * sizeof(u16) +
+                compact_tree->children_32.n_elements * sizeof(u32));
+  return result;
+}
+
+
 void
 destroy_rule_tree(Rule *rule)
 {
   rule->rule_tree_built = false;
   Array::free_array(rule->rule_nodes_table);
+  destroy_compact_rule_tree(&rule->compact_tree);
+
+  rule->lazy_rule_tree = false;
+  Array::free_array(rule->lazy_leaf_nodes);
+
+  rule->pattern_masks_compiled = false;
+  Array::free_array(rule->pattern_masks);
+  Array::free_array(rule->input_state_patterns);
+
+  rule->tree_source.valid = false;
+  Array::free_array(rule->tree_source.rule_patterns);
+}
+
+
+/// Zeros the RuleTraversalStats, and sizes them for the current rule tree.  Must be called after
+///   the rule tree is rebuilt for the stats to be recorded.
+///
+void
+reset_rule_traversal_stats(Rule *rule)
+{
+  RuleTraversalStats *stats = &rule->traversal_stats;
+
+  stats->n_traversals = 0;
+  stats->total_depth = 0;
+  stats->n_border_early_outs = 0;
+
+  Array::clear(stats->depth_histogram);
+  Array::clear(stats->node_visits);
+  Array::clear(stats->leaf_state_hits);
+
+  if (rule->rule_tree_built)
+  {
+    Array::add_n(stats->depth_histogram, rule->n_inputs + 1);
+    Array::add_n(stats->node_visits, rule->rule_nodes_table.n_elements);
+    Array::add_n(stats->leaf_state_hits, rule->config.named_states.states.n_elements);
+
+    memset(stats->depth_histogram.elements, 0, stats->depth_histogram.n_elements * sizeof(u64));
+    memset(stats->node_visits.elements, 0, stats->node_visits.n_elements * sizeof(u64));
+    memset(stats->leaf_state_hits.elements, 0, stats->leaf_state_hits.n_elements * sizeof(u64));
+  }
+}
+
+
+void
+free_rule_traversal_stats(RuleTraversalStats *stats)
+{
+  Array::free_array(stats->depth_histogram);
+  Array::free_array(stats->node_visits);
+  Array::free_array(stats->leaf_state_hits);
 }
 
 
@@ -471,72 +1398,281 @@ print_rule_tree(Rule *rule_tree)
 }
 
 
-/// Executes the transition function by traversing the rule tree taking inputs from the universe as
-///   needed
+/// The state used for an input whose cell isn't loaded.
 ///
-/// @param[in] border  Universe border config
-/// @param[in] universe  The universe
-/// @param[in] rule  The rule tree to use
-/// @param[in] cell_block_position  The position of the block containing the cell to transition
-/// @param[in] cell_position  The position of the cell to transition within the given cell block
-/// @param[in] null_state_0  The null state to use with this rule for cells which are not loaded
-CellState
-execute_transition_function(Border *border, Universe *universe, Rule *rule, s32vec2 cell_block_position, s32vec2 cell_position)
+/// A cell is not loaded because it is a null state, so the first null state is used.  If there
+///   are no null states, the cell should always exist as create_any_new_cell_blocks_needed will
+///   create all the cell blocks.
+inline CellState
+get_unloaded_input_state(Rule *rule)
+{
+  CellState result = 0;
+
+  if (rule->config.null_states.n_elements > 0)
+  {
+    result = rule->config.null_states[0];
+  }
+
+  return result;
+}
+
+
+/// Reads the inputs to the transition function for the cell being transitioned from the universe,
+///   using the Rule's input_deltas.
+///
+/// @returns  The number of inputs read.  This is less than n_inputs if an input is outside the
+///             simulation region border, in which case the cell should not be simulated.
+u32
+read_transition_function_inputs(Border *border, Universe *universe, Rule *rule, s32vec2 cell_block_position, s32vec2 cell_position, CellState inputs[])
+{
+  u32 result = 0;
+
+  CellState unloaded_state = get_unloaded_input_state(rule);
+
+  b32 inside_border = true;
+  while (inside_border && result < rule->n_inputs)
+  {
+    // get_neighbouring_cell_state doesn't set the state if the cell is not currently loaded
+    inputs[result] = unloaded_state;
+
+    inside_border = get_neighbouring_cell_state(border, universe, rule->input_deltas[result], cell_block_position, cell_position, inputs + result);
+    if (inside_border)
+    {
+      ++result;
+    }
+  }
+
+  return result;
+}
+
+
+/// Reads the inputs to the transition function for a cell whose inputs are all within its own
+///   CellBlock, and within the simulation region border, using the Rule's input_offsets.
+inline void
+read_transition_function_inputs_in_block(Rule *rule, CellState *cell_previous_states, u32 cell_index, CellState inputs[])
 {
-  // cell_states is an array of all the neighbours top-to-bottom left-to-right, including the
-  //   central cell.
+  CellState unloaded_state = get_unloaded_input_state(rule);
+
+  for (u32 input_n = 0;
+       input_n < rule->n_inputs;
+       ++input_n)
+  {
+    CellState input_state = cell_previous_states[cell_index + rule->input_offsets[input_n]];
+
+    if (input_state != DEBUG_STATE)
+    {
+      inputs[input_n] = input_state;
+    }
+    else
+    {
+      inputs[input_n] = unloaded_state;
+    }
+  }
+}
 
+
+/// Traverses the rule_nodes_table, recording RuleTraversalStats if enabled.
+CellState
+traverse_rule_nodes(Rule *rule, CellState inputs[], u32 n_inputs_read)
+{
   CellState result;
 
-  RuleNode *node = Array::get(rule->rule_nodes_table, rule->root_node);
+  RuleTraversalStats *stats = 0;
+  if (rule->collect_traversal_stats &&
+      rule->traversal_stats.node_visits.n_elements == rule->rule_nodes_table.n_elements)
+  {
+    stats = &rule->traversal_stats;
+  }
+
+  u32 node_position = rule->root_node;
+  RuleNode *node = Array::get(rule->rule_nodes_table, node_position);
 
   u32 input_n = 0;
   b32 reached_result = false;
   while (!reached_result)
   {
+    if (stats)
+    {
+      ++stats->node_visits[node_position];
+    }
+
     if (node->is_leaf)
     {
       reached_result = true;
     }
+    else if (input_n == n_inputs_read)
+    {
+      // Neighbour is outside the simulation region border, therefore do not simulate the cell.
+      break;
+    }
     else
     {
-      s32vec2 current_input_delta = get_neighbourhood_region_cell_delta(rule->config.neighbourhood_region_shape, rule->config.neighbourhood_region_size, input_n);
+      // Select the next node based on this input's state
+      node_position = node->children[inputs[input_n]];
+      node = Array::get(rule->rule_nodes_table, node_position);
+      ++input_n;
+    }
+  }
 
-      CellState current_state;
+  if (reached_result)
+  {
+    result = node->leaf_value;
+  }
+  else
+  {
+    result = DEBUG_STATE;
+  }
 
-      // If get_neighbouring_cell_state doesn't set current_state, the cell is not currently loaded
-      //   because it is a null state.  Therefore, use the first null state as the current state
-      //   instead.  If there are no null states, the cell should always exist as
-      //   create_any_new_cell_blocks_needed will create all the cell blocks.
-      if (rule->config.null_states.n_elements > 0)
-      {
-        current_state = rule->config.null_states[0];
-      }
+  if (stats)
+  {
+    ++stats->n_traversals;
+    stats->total_depth += input_n;
 
-      b32 simulate_cell = get_neighbouring_cell_state(border, universe, current_input_delta, cell_block_position, cell_position, &current_state);
+    if (input_n < stats->depth_histogram.n_elements)
+    {
+      ++stats->depth_histogram[input_n];
+    }
 
-      if (!simulate_cell)
-      {
-        // Neighbour is outside the simulation region border, therefore do not simulate the cell.
+    if (!reached_result)
+    {
+      ++stats->n_border_early_outs;
+    }
+    else if (result < stats->leaf_state_hits.n_elements)
+    {
+      ++stats->leaf_state_hits[result];
+    }
+  }
 
-        break;
-      }
+  return result;
+}
 
-      // Select the next node based on this input's state
-      u32 next_node_position = node->children[current_state];
-      node = Array::get(rule->rule_nodes_table, next_node_position);
-      ++input_n;
+
+/// Traverses a lazy rule tree, creating any nodes along the path which haven't been built yet.
+CellState
+traverse_lazy_rule_tree(Rule *rule, CellState inputs[])
+{
+  u32 node_position = rule->root_node;
+  RuleNode *node = Array::get(rule->rule_nodes_table, node_position);
+
+  u32 input_n = 0;
+  while (!node->is_leaf)
+  {
+    CellState current_state = inputs[input_n];
+    ++input_n;
+
+    u32 child_position = node->children[current_state];
+    if (child_position == UNBUILT_RULE_NODE)
+    {
+      child_position = materialise_rule_node(rule, input_n, inputs);
+
+      // Adding the node may have moved the rule_nodes_table
+      node = Array::get(rule->rule_nodes_table, node_position);
+      node->children[current_state] = child_position;
     }
+
+    node_position = child_position;
+    node = Array::get(rule->rule_nodes_table, node_position);
   }
 
-  if (reached_result)
+  CellState result = node->leaf_value;
+  return result;
+}
+
+
+/// Traverses the CompactRuleTree, with child entries of type ChildEntry using leaf_bit to mark
+///   leaves.
+template <typename ChildEntry, u32 leaf_bit>
+CellState
+traverse_compact_rule_tree(Rule *rule, ChildEntry *children, CellState inputs[])
+{
+  u32 entry = rule->compact_tree.root;
+
+  u32 input_n = 0;
+  while (!(entry & leaf_bit))
   {
-    result = node->leaf_value;
+    entry = children[entry + inputs[input_n]];
+    ++input_n;
   }
-  else
+
+  CellState result = entry & ~leaf_bit;
+  return result;
+}
+
+
+/// Looks up the transition function's result for the inputs in the rule tree
+///
+/// Uses the CompactRuleTree if it has been built, unless traversal stats are being collected.  Lazy
+///   rule trees are filled in as they are traversed.
+///
+/// @param[in] rule  The rule tree to use
+/// @param[in] inputs  The states of the cell's neighbourhood, in input order
+/// @param[in] n_inputs_read  The number of inputs read, before reaching the simulation border
+CellState
+get_rule_tree_result(Rule *rule, CellState inputs[], u32 n_inputs_read)
+{
+  CellState result;
+
+  CompactRuleTree *compact_tree = &rule->compact_tree;
+
+  if (!rule->lazy_rule_tree && (!compact_tree->built || rule->collect_traversal_stats))
   {
+    result = traverse_rule_nodes(rule, inputs, n_inputs_read);
+  }
+  else if (n_inputs_read < rule->n_inputs)
+  {
+    // Neighbour is outside the simulation region border, therefore do not simulate the cell.
     result = DEBUG_STATE;
   }
+  else if (rule->lazy_rule_tree)
+  {
+    result = traverse_lazy_rule_tree(rule, inputs);
+  }
+  else if (compact_tree->narrow)
+  {
+    result = traverse_compact_rule_tree<u16, COMPACT_RULE_LEAF_BIT_16>(rule, compact_tree->children_16.elements, inputs);
+  }
+  else
+  {
+    result = traverse_compact_rule_tree<u32, COMPACT_RULE_LEAF_BIT_32>(rule, compact_tree->children_32.elements, inputs);
+  }
+
+  return result;
+}
+
+
+/// Executes the transition function by traversing the rule tree taking inputs from the universe
+///
+/// @param[in] border  Universe border config
+/// @param[in] universe  The universe
+/// @param[in] rule  The rule tree to use
+/// @param[in] cell_block_position  The position of the block containing the cell to transition
+/// @param[in] cell_position  The position of the cell to transition within the given cell block
+CellState
+execute_transition_function(Border *border, Universe *universe, Rule *rule, s32vec2 cell_block_position, s32vec2 cell_position)
+{
+  CellState inputs[rule->n_inputs];
+  u32 n_inputs_read = read_transition_function_inputs(border, universe, rule, cell_block_position, cell_position, inputs);
 
+  CellState result = get_rule_tree_result(rule, inputs, n_inputs_read);
   return result;
-}
\ No newline at end of file
+}
+
+
+/// Executes the transition function for a cell at least input_reach from the edges of its
+///   CellBlock, and with its whole neighbourhood inside the simulation region border.
+///
+/// The inputs are read straight out of the block's cell_previous_states using the Rule's
+///   input_offsets, which must have been updated for the universe's cell_block_dim.
+///
+/// @param[in] rule  The rule tree to use
+/// @param[in] cell_previous_states  The cell_previous_states of the cell's CellBlock
+/// @param[in] cell_index  The index of the cell to transition within the CellBlock
+CellState
+execute_transition_function_in_block(Rule *rule, CellState *cell_previous_states, u32 cell_index)
+{
+  CellState inputs[rule->n_inputs];
+  read_transition_function_inputs_in_block(rule, cell_previous_states, cell_index, inputs);
+
+  CellState result = get_rule_tree_result(rule, inputs, rule->n_inputs);
+  return result;
+}
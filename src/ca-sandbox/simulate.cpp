@@ -2,6 +2,7 @@
 
 #include "engine/print.h"
 #include "engine/types.h"
+#include "engine/profiler.h"
 #include "engine/assert.h"
 #include "engine/allocate.h"
 
@@ -9,6 +10,8 @@
 #include "ca-sandbox/cell-block-coordinate-system.h"
 #include "ca-sandbox/rule.h"
 #include "ca-sandbox/border.h"
+#include "ca-sandbox/neighbourhood-region.h"
+#include "ca-sandbox/dense-grid.h"
 
 /// @file
 /// @brief Contains functions for running the CA simulation on the CellBlock%s.
@@ -33,29 +36,529 @@ default_simulation_options()
 
 /// Simulates one frame of a CellBlock using execute_transision_function(). Also implements the CA
 ///   bounds check.
+///
+/// Cells at least the rule's input_reach from the block's edges, with their whole neighbourhood
+///   inside the border, read their inputs straight from the block with
+///   execute_transition_function_in_block().  Only the cells around the edges need to look up
+///   their neighbours in the universe.
 void
 simulate_cell_block(SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, Rule *rule, Universe *universe, CellBlock *cell_block)
 {
+  Border& border = simulate_options->border;
+
+  s32 cell_block_dim = s32(universe->cell_block_dim);
+  s32vec2 input_reach = rule->input_reach;
+
+  s32vec2 interior_start = input_reach;
+  s32vec2 interior_end = vec2_subtract((s32vec2){cell_block_dim, cell_block_dim}, input_reach);
+
+  b32 block_inside_border = (check_border(border, cell_block->block_position, {0, 0}) &&
+                             check_border(border, cell_block->block_position, {cell_block_dim - 1, cell_block_dim - 1}));
+
   s32vec2 cell_position;
   for (cell_position.y = 0;
-       cell_position.y < universe->cell_block_dim;
+       cell_position.y < cell_block_dim;
        ++cell_position.y)
   {
+    b32 interior_row = cell_position.y >= interior_start.y && cell_position.y < interior_end.y;
+
     for (cell_position.x = 0;
-         cell_position.x < universe->cell_block_dim;
+         cell_position.x < cell_block_dim;
          ++cell_position.x)
     {
-      if (check_border(simulate_options->border, cell_block->block_position, cell_position))
+      if (check_border(border, cell_block->block_position, cell_position))
       {
         u32 subject_cell_index = get_cell_index_in_block(universe, cell_position);
         CellState *subject_cell_state = cell_block->cell_states + subject_cell_index;
-        *subject_cell_state = execute_transition_function(&simulate_options->border, universe, rule, cell_block->block_position, cell_position);
+
+        b32 inputs_in_block = (interior_row &&
+                               cell_position.x >= interior_start.x &&
+                               cell_position.x < interior_end.x &&
+                               (block_inside_border ||
+                                (check_border(border, cell_block->block_position, vec2_subtract(cell_position, input_reach)) &&
+                                 check_border(border, cell_block->block_position, vec2_add(cell_position, input_reach)))));
+
+        if (inputs_in_block)
+        {
+          *subject_cell_state = execute_transition_function_in_block(rule, cell_block->cell_previous_states, subject_cell_index);
+        }
+        else
+        {
+          *subject_cell_state = execute_transition_function(&border, universe, rule, cell_block->block_position, cell_position);
+        }
       }
     }
   }
 }
 
 
+/// The neighbourhood region constants used by the specialised simulation kernels, matching
+///   get_neighbourhood_region_n_cells() and build_rule_input_deltas().
+template <NeighbourhoodRegionShape shape, u32 size>
+struct SpecialisedNeighbourhood
+{
+  static const u32 n_inputs = (shape == NeighbourhoodRegionShape::MOORE ? (2*size + 1) * (2*size + 1) :
+                               shape == NeighbourhoodRegionShape::VON_NEUMANN ? 4*size + 1 :
+                                                                                2*size + 1);
+
+  static const s32 reach_x = size;
+  static const s32 reach_y = (shape == NeighbourhoodRegionShape::ONE_DIM ? 0 : size);
+};
+
+
+typedef void (*SimulateCellBlockFunction)(SimulateOptions *, CellInitialisationOptions *, Rule *, Universe *, CellBlock *);
+
+
+/// Transitions a region_size rectangle of cells, reading inputs from a tile which contains the
+///   region's neighbourhood.  tile points to the first cell of the region.
+typedef void (*TransitionTileRegionFunction)(Rule *rule, CellState *tile, s32 tile_width, s32vec2 region_size, CellState *output, s32 output_stride);
+
+
+/// The specialised kernels for a rule and border, 0 where there isn't one.
+struct SimulationKernels
+{
+  SimulateCellBlockFunction simulate_cell_block;
+  TransitionTileRegionFunction transition_tile_region;
+};
+
+
+/// Copies a CellBlock's cell_previous_states into the middle of a tile with a halo of reach_x and
+///   reach_y cells around it, filling the halo from the neighbouring cells in the universe.  Cells
+///   which aren't loaded or are DEBUG_STATE are replaced by the first null state, as in
+///   get_neighbouring_cell_state().
+///
+/// The block must be inside the border, so every halo cell is within the border or wraps around
+///   the torus.
+void
+fill_cell_block_halo_tile(SimulateOptions *simulate_options, Rule *rule, Universe *universe, CellBlock *cell_block, s32 reach_x, s32 reach_y, CellState tile[])
+{
+  s32 cell_block_dim = s32(universe->cell_block_dim);
+  s32 tile_width = cell_block_dim + 2*reach_x;
+  s32 tile_height = cell_block_dim + 2*reach_y;
+
+  CellState unloaded_state = 0;
+  if (rule->config.null_states.n_elements > 0)
+  {
+    unloaded_state = rule->config.null_states[0];
+  }
+
+  s32vec2 tile_position;
+  for (tile_position.y = 0;
+       tile_position.y < tile_height;
+       ++tile_position.y)
+  {
+    for (tile_position.x = 0;
+         tile_position.x < tile_width;
+         ++tile_position.x)
+    {
+      s32vec2 cell_position = vec2_subtract(tile_position, (s32vec2){reach_x, reach_y});
+      CellState *tile_cell = tile + (tile_position.y * tile_width) + tile_position.x;
+
+      b32 in_block = (cell_position.x >= 0 && cell_position.x < cell_block_dim &&
+                      cell_position.y >= 0 && cell_position.y < cell_block_dim);
+
+      if (in_block)
+      {
+        *tile_cell = cell_block->cell_previous_states[(cell_position.y * cell_block_dim) + cell_position.x];
+        if (*tile_cell == DEBUG_STATE)
+        {
+          *tile_cell = unloaded_state;
+        }
+      }
+      else
+      {
+        *tile_cell = unloaded_state;
+        get_neighbouring_cell_state(&simulate_options->border, universe, cell_position, cell_block->block_position, {0, 0}, tile_cell);
+      }
+    }
+  }
+}
+
+
+/// Transitions a region of cells from a tile, specialised for the neighbourhood region and
+///   CompactRuleTree child entry type, so the input loop is unrolled and there is no per-cell
+///   branching on the configuration.  Every input is read at a fixed offset in the tile and the
+///   CompactRuleTree is traversed directly.
+template <NeighbourhoodRegionShape shape, u32 size, typename ChildEntry, u32 leaf_bit>
+void
+transition_tile_region(Rule *rule, CellState *tile, s32 tile_width, s32vec2 region_size, CellState *output, s32 output_stride)
+{
+  typedef SpecialisedNeighbourhood<shape, size> Neighbourhood;
+
+  s32 tile_offsets[Neighbourhood::n_inputs];
+  for (u32 input_n = 0;
+       input_n < Neighbourhood::n_inputs;
+       ++input_n)
+  {
+    s32vec2 input_delta = rule->input_deltas[input_n];
+    tile_offsets[input_n] = (input_delta.y * tile_width) + input_delta.x;
+  }
+
+  ChildEntry *children;
+  if (sizeof(ChildEntry) == sizeof(u16))
+  {
+    children = (ChildEntry *)rule->compact_tree.children_16.elements;
+  }
+  else
+  {
+    children = (ChildEntry *)rule->compact_tree.children_32.elements;
+  }
+  u32 root = rule->compact_tree.root;
+
+  for (s32 cell_y = 0;
+       cell_y < region_size.y;
+       ++cell_y)
+  {
+    CellState *tile_row = tile + (cell_y * tile_width);
+    CellState *output_row = output + (cell_y * output_stride);
+
+    for (s32 cell_x = 0;
+         cell_x < region_size.x;
+         ++cell_x)
+    {
+      CellState *subject_tile_cell = tile_row + cell_x;
+
+      u32 entry = root;
+      for (u32 input_n = 0;
+           input_n < Neighbourhood::n_inputs;
+           ++input_n)
+      {
+        entry = children[entry + subject_tile_cell[tile_offsets[input_n]]];
+
+        if (entry & leaf_bit)
+        {
+          break;
+        }
+      }
+
+      output_row[cell_x] = entry & ~leaf_bit;
+    }
+  }
+}
+
+
+/// Returns the Universe's scratch halo tile, growing it to fit at least n_cells CellState%s.
+///
+/// The tile is kept on the heap rather than the stack, as its size depends on the cell_block_dim
+///   loaded from the cells file.
+CellState *
+get_halo_tile(Universe *universe, u32 n_cells)
+{
+  if (universe->halo_tile_size < n_cells)
+  {
+    if (universe->halo_tile != 0)
+    {
+      un_allocate(universe->halo_tile);
+    }
+    universe->halo_tile = allocate(CellState, n_cells);
+    universe->halo_tile_size = n_cells;
+  }
+
+  CellState *result = universe->halo_tile;
+  return result;
+}
+
+
+/// Simulates one frame of a CellBlock, specialised for the neighbourhood region, border type and
+///   CompactRuleTree child entry type.
+///
+/// The block and a halo of its neighbours are copied into a tile with fill_cell_block_halo_tile()
+///   to be transitioned by transition_tile_region().  Only used for blocks entirely inside the
+///   border, others fall back to simulate_cell_block().
+template <NeighbourhoodRegionShape shape, u32 size, BorderType border_type, typename ChildEntry, u32 leaf_bit>
+void
+simulate_cell_block_specialised(SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, Rule *rule, Universe *universe, CellBlock *cell_block)
+{
+  typedef SpecialisedNeighbourhood<shape, size> Neighbourhood;
+
+  s32 cell_block_dim = s32(universe->cell_block_dim);
+
+  b32 block_inside_border = (border_type == BorderType::INFINITE ||
+                             (check_border(simulate_options->border, cell_block->block_position, {0, 0}) &&
+                              check_border(simulate_options->border, cell_block->block_position, {cell_block_dim - 1, cell_block_dim - 1})));
+
+  if (!block_inside_border)
+  {
+    simulate_cell_block(simulate_options, cell_initialisation_options, rule, universe, cell_block);
+  }
+  else
+  {
+    s32 tile_width = cell_block_dim + 2*Neighbourhood::reach_x;
+    s32 tile_height = cell_block_dim + 2*Neighbourhood::reach_y;
+
+    CellState *tile = get_halo_tile(universe, u32(tile_width * tile_height));
+    fill_cell_block_halo_tile(simulate_options, rule, universe, cell_block, Neighbourhood::reach_x, Neighbourhood::reach_y, tile);
+
+    CellState *first_cell = tile + (Neighbourhood::reach_y * tile_width) + Neighbourhood::reach_x;
+    transition_tile_region<shape, size, ChildEntry, leaf_bit>(rule, first_cell, tile_width, (s32vec2){cell_block_dim, cell_block_dim}, cell_block->cell_states, cell_block_dim);
+  }
+}
+
+
+template <NeighbourhoodRegionShape shape, u32 size, typename ChildEntry, u32 leaf_bit>
+SimulationKernels
+get_specialised_kernels(BorderType border_type)
+{
+  SimulationKernels result = {};
+
+  result.transition_tile_region = transition_tile_region<shape, size, ChildEntry, leaf_bit>;
+
+  switch (border_type)
+  {
+    case (BorderType::INFINITE):
+    {
+      result.simulate_cell_block = simulate_cell_block_specialised<shape, size, BorderType::INFINITE, ChildEntry, leaf_bit>;
+    } break;
+
+    case (BorderType::TORUS):
+    {
+      result.simulate_cell_block = simulate_cell_block_specialised<shape, size, BorderType::TORUS, ChildEntry, leaf_bit>;
+    } break;
+
+    case (BorderType::FIXED):
+    {
+    } break;
+  }
+
+  return result;
+}
+
+
+template <NeighbourhoodRegionShape shape, u32 size>
+SimulationKernels
+get_specialised_kernels(BorderType border_type, b32 narrow)
+{
+  SimulationKernels result;
+
+  if (narrow)
+  {
+    result = get_specialised_kernels<shape, size, u16, COMPACT_RULE_LEAF_BIT_16>(border_type);
+  }
+  else
+  {
+    result = get_specialised_kernels<shape, size, u32, COMPACT_RULE_LEAF_BIT_32>(border_type);
+  }
+
+  return result;
+}
+
+
+/// Chooses the simulation kernels for this step.  Specialised kernels are used for the common
+///   neighbourhood regions when traversing a CompactRuleTree.  A specialised simulate_cell_block
+///   is only used with an INFINITE or TORUS border, otherwise the general simulate_cell_block() is
+///   used.
+SimulationKernels
+get_simulation_kernels(BorderType border_type, Rule *rule)
+{
+  SimulationKernels result = {};
+
+  RuleConfiguration *config = &rule->config;
+  CompactRuleTree *compact_tree = &rule->compact_tree;
+
+  s32vec2 specialised_reach = {(s32)config->neighbourhood_region_size, (s32)config->neighbourhood_region_size};
+  if (config->neighbourhood_region_shape == NeighbourhoodRegionShape::ONE_DIM)
+  {
+    specialised_reach.y = 0;
+  }
+
+  b32 can_specialise = (compact_tree->built &&
+                        !rule->lazy_rule_tree &&
+                        !rule->collect_traversal_stats &&
+                        rule->input_deltas.n_elements == rule->n_inputs &&
+                        vec2_eq(rule->input_reach, specialised_reach));
+
+  if (can_specialise)
+  {
+    b32 narrow = compact_tree->narrow;
+
+    switch (config->neighbourhood_region_shape)
+    {
+      case (NeighbourhoodRegionShape::MOORE):
+      {
+        if (config->neighbourhood_region_size == 1)
+        {
+          result = get_specialised_kernels<NeighbourhoodRegionShape::MOORE, 1>(border_type, narrow);
+        }
+        else if (config->neighbourhood_region_size == 2)
+        {
+          result = get_specialised_kernels<NeighbourhoodRegionShape::MOORE, 2>(border_type, narrow);
+        }
+      } break;
+
+      case (NeighbourhoodRegionShape::VON_NEUMANN):
+      {
+        if (config->neighbourhood_region_size == 1)
+        {
+          result = get_specialised_kernels<NeighbourhoodRegionShape::VON_NEUMANN, 1>(border_type, narrow);
+        }
+      } break;
+
+      case (NeighbourhoodRegionShape::ONE_DIM):
+      {
+        if (config->neighbourhood_region_size == 1)
+        {
+          result = get_specialised_kernels<NeighbourhoodRegionShape::ONE_DIM, 1>(border_type, narrow);
+        }
+      } break;
+    }
+  }
+
+  if (result.simulate_cell_block == 0)
+  {
+    result.simulate_cell_block = simulate_cell_block;
+  }
+
+  return result;
+}
+
+
+/// Transitions a row of cells with a ONE_DIM rule, writing the next generation into output.
+///
+/// row points to the first cell, and must have the rule's input_reach.x cells of padding either
+///   side.  Uses the specialised transition_tile_region() when there is one for the rule.
+void
+transition_cell_row(Rule *rule, CellState *row, u32 n_cells, CellState *output)
+{
+  SimulationKernels kernels = get_simulation_kernels(BorderType::INFINITE, rule);
+
+  if (kernels.transition_tile_region != 0)
+  {
+    kernels.transition_tile_region(rule, row, n_cells + 2*rule->input_reach.x, (s32vec2){(s32)n_cells, 1}, output, n_cells);
+  }
+  else
+  {
+    // Every input is on the same row, so the offsets are the input deltas whatever the width
+    u32 padding = rule->input_reach.x;
+    update_rule_input_offsets(rule, n_cells + 2*padding);
+
+    for (u32 cell_n = 0;
+         cell_n < n_cells;
+         ++cell_n)
+    {
+      output[cell_n] = execute_transition_function_in_block(rule, row - padding, padding + cell_n);
+    }
+  }
+}
+
+
+/// Sets the cells in a rectangle of a CellBlock's cell_states, given in global cell positions, to
+///   DEBUG_STATE.
+void
+set_cell_block_region_to_debug_state(Universe *universe, CellBlock *cell_block, s32vec2 start, s32vec2 end)
+{
+  s32 cell_block_dim = s32(universe->cell_block_dim);
+  s32vec2 block_origin = vec2_multiply(cell_block->block_position, cell_block_dim);
+
+  for (s32 global_y = start.y;
+       global_y < end.y;
+       ++global_y)
+  {
+    CellState *row = cell_block->cell_states + ((global_y - block_origin.y) * cell_block_dim) - block_origin.x;
+
+    for (s32 global_x = start.x;
+         global_x < end.x;
+         ++global_x)
+    {
+      row[global_x] = DEBUG_STATE;
+    }
+  }
+}
+
+
+/// Simulates the CellBlock%s inside a TORUS or FIXED border from the Universe's DenseGrid, so no
+///   cell needs a check_border() or a CellBlock lookup per neighbour.  Cells in CellBlock%s which
+///   don't exist are not simulated, as in the rest of simulate_cells().
+///
+/// - TORUS: The grid's halo is wrapped around the torus once per step.
+/// - FIXED: Only cells further than the input reach from the border are transitioned, the cells
+///     around the edge are set to DEBUG_STATE as their neighbourhood is outside the border.
+///
+/// @returns  false if the border doesn't contain any cells, and nothing was simulated.
+b32
+simulate_dense_grid(SimulateOptions *simulate_options, Rule *rule, Universe *universe, TransitionTileRegionFunction transition_tile_region, u64 current_frame)
+{
+  b32 success = true;
+
+  if (universe->dense_grid == 0)
+  {
+    universe->dense_grid = allocate(DenseGrid, 1);
+  }
+  DenseGrid *grid = universe->dense_grid;
+
+  CellState unloaded_state = 0;
+  if (rule->config.null_states.n_elements > 0)
+  {
+    unloaded_state = rule->config.null_states[0];
+  }
+
+  success &= update_dense_grid(grid, universe, &simulate_options->border, rule->input_reach, unloaded_state);
+
+  if (success)
+  {
+    s32 cell_block_dim = s32(universe->cell_block_dim);
+    s32vec2 grid_end = vec2_add(grid->origin, grid->size);
+
+    // The region which can be transitioned, in global cell positions
+    s32vec2 transition_start = grid->origin;
+    s32vec2 transition_end = grid_end;
+    if (simulate_options->border.type == BorderType::FIXED)
+    {
+      transition_start = vec2_add(transition_start, rule->input_reach);
+      transition_end = vec2_max(transition_start, vec2_subtract(transition_end, rule->input_reach));
+    }
+
+    for (s32 block_y = 0;
+         block_y < grid->n_blocks.y;
+         ++block_y)
+    {
+      for (s32 block_x = 0;
+           block_x < grid->n_blocks.x;
+           ++block_x)
+      {
+        CellBlock *cell_block = grid->blocks[(block_y * grid->n_blocks.x) + block_x];
+
+        if (cell_block != 0 &&
+            cell_block->last_simulated_on_frame != current_frame)
+        {
+          cell_block->last_simulated_on_frame = current_frame;
+
+          // Only the part of the block inside the border is simulated
+          s32vec2 block_origin = vec2_multiply(cell_block->block_position, cell_block_dim);
+          s32vec2 block_end = vec2_add(block_origin, cell_block_dim);
+
+          s32vec2 border_start = vec2_max(grid->origin, block_origin);
+          s32vec2 border_end = vec2_min(grid_end, block_end);
+
+          s32vec2 start = vec2_max(transition_start, block_origin);
+          s32vec2 end = vec2_min(transition_end, block_end);
+
+          if (start.x < end.x && start.y < end.y)
+          {
+            s32vec2 start_in_block = vec2_subtract(start, block_origin);
+            CellState *output = cell_block->cell_states + (start_in_block.y * cell_block_dim) + start_in_block.x;
+
+            transition_tile_region(rule, get_dense_grid_cell(grid, start), grid->width, vec2_subtract(end, start), output, cell_block_dim);
+
+            // The rest of the block inside the border: north, south, west and east of the
+            //   transitioned region.
+            set_cell_block_region_to_debug_state(universe, cell_block, border_start, (s32vec2){border_end.x, start.y});
+            set_cell_block_region_to_debug_state(universe, cell_block, (s32vec2){border_start.x, end.y}, border_end);
+            set_cell_block_region_to_debug_state(universe, cell_block, (s32vec2){border_start.x, start.y}, (s32vec2){start.x, end.y});
+            set_cell_block_region_to_debug_state(universe, cell_block, (s32vec2){end.x, start.y}, (s32vec2){border_end.x, end.y});
+          }
+          else
+          {
+            set_cell_block_region_to_debug_state(universe, cell_block, border_start, border_end);
+          }
+        }
+      }
+    }
+  }
+
+  return success;
+}
+
+
 b32
 null_state_in_block(RuleConfiguration *rule_configuration, Universe *universe, CellBlock *cell_block, s32vec2 cell_start_region, s32vec2 cell_end_region)
 {
@@ -97,10 +600,12 @@ null_state_in_block(RuleConfiguration *rule_configuration, Universe *universe, C
 ///     - Only create new CellBlock%s if an existing Cell __with a non-NULL state__ is within the
 ///         neighbourhood-region of any of its cells.
 b32
-create_any_new_cell_blocks_needed(SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, RuleConfiguration *rule_configuration, Universe *universe, CellBlock *subject_cell_block)
+create_any_new_cell_blocks_needed(SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, Rule *rule, Universe *universe, CellBlock *subject_cell_block)
 {
   b32 result = false;
 
+  RuleConfiguration *rule_configuration = &rule->config;
+
   Border& border = simulate_options->border;
 
   // Only check if the subject_cell_block is within the simulation border (<= because this is
@@ -111,25 +616,25 @@ create_any_new_cell_blocks_needed(SimulateOptions *simulate_options, CellInitial
        border.min_corner_block.y <= subject_cell_block->block_position.y &&
        border.max_corner_block.y >= subject_cell_block->block_position.y))
   {
-    // Check the neighbourhood region size of each edge and corner of the block for non-null cell
-    //   states.  If within the neighbourhood region of any neighbouring CellBlocks:  create the
-    //   CellBlock which can see this Cell.
+    // Check the input reach of each edge and corner of the block for non-null cell states.  If
+    //   within the neighbourhood region of any neighbouring CellBlocks:  create the CellBlock which
+    //   can see this Cell.
 
-    s32 neighbourhood_region_size = s32(rule_configuration->neighbourhood_region_size);
+    s32vec2 input_reach = rule->input_reach;
     s32 cell_block_dim = s32(universe->cell_block_dim);
 
-    s32 block_size_minus_neighbourhood = cell_block_dim - neighbourhood_region_size;
+    s32vec2 block_size_minus_reach = vec2_subtract((s32vec2){cell_block_dim, cell_block_dim}, input_reach);
 
     s32vec2 west_start_test_region  = {0, 0};
-    s32vec2 west_end_test_region    = {neighbourhood_region_size, cell_block_dim};
+    s32vec2 west_end_test_region    = {input_reach.x, cell_block_dim};
 
-    s32vec2 east_start_test_region  = {block_size_minus_neighbourhood, 0};
+    s32vec2 east_start_test_region  = {block_size_minus_reach.x, 0};
     s32vec2 east_end_test_region    = {cell_block_dim, cell_block_dim};
 
     s32vec2 north_start_test_region = {0, 0};
-    s32vec2 north_end_test_region   = {cell_block_dim, neighbourhood_region_size};
+    s32vec2 north_end_test_region   = {cell_block_dim, input_reach.y};
 
-    s32vec2 south_start_test_region = {0, block_size_minus_neighbourhood};
+    s32vec2 south_start_test_region = {0, block_size_minus_reach.y};
     s32vec2 south_end_test_region   = {cell_block_dim, cell_block_dim};
 
     s32vec2 north_west_start_test_region = vec2_max(north_start_test_region, west_start_test_region);
@@ -230,12 +735,12 @@ create_any_new_cell_blocks_needed(SimulateOptions *simulate_options, CellInitial
   {
     // Upper bound
     s32vec2 max_corner_block = simulate_options->border.max_corner_block;
-    s32vec2 max_corner_cell = vec2_subtract(simulate_options->border.max_corner_cell, rule_configuration->neighbourhood_region_size);
+    s32vec2 max_corner_cell = vec2_subtract(simulate_options->border.max_corner_cell, rule->input_reach);
     normalise_cell_coord(universe, &max_corner_block, &max_corner_cell);
 
     // Lower bound
     s32vec2 min_corner_block = simulate_options->border.min_corner_block;
-    s32vec2 min_corner_cell = vec2_add(simulate_options->border.min_corner_cell, rule_configuration->neighbourhood_region_size);
+    s32vec2 min_corner_cell = vec2_add(simulate_options->border.min_corner_cell, rule->input_reach);
     normalise_cell_coord(universe, &min_corner_block, &min_corner_cell);
 
     s32vec2 cell_position;
@@ -253,7 +758,7 @@ create_any_new_cell_blocks_needed(SimulateOptions *simulate_options, CellInitial
         if (!is_null_state(rule_configuration, cell_state) &&
             check_border(simulate_options->border, subject_cell_block->block_position, cell_position))
         {
-          // Check if the cell is within the neighbourhood_region_size of the border.
+          // Check if the cell is within the input reach of the border.
           b32 wrapping_north_needed = !cell_position_less_than(subject_cell_block->block_position.y, cell_position.y, max_corner_block.y, max_corner_cell.y);
           b32 wrapping_east_needed = !cell_position_greater_than_or_equal_to(subject_cell_block->block_position.x, cell_position.x, min_corner_block.x, min_corner_cell.x);
           b32 wrapping_south_needed = !cell_position_greater_than_or_equal_to(subject_cell_block->block_position.y, cell_position.y, min_corner_block.y, min_corner_cell.y);
@@ -335,51 +840,71 @@ create_any_new_cell_blocks_needed(SimulateOptions *simulate_options, CellInitial
 void
 simulate_cells(SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, Rule *rule, Universe *universe, u64 current_frame)
 {
+  PROFILE_SCOPE("simulate_cells");
+
   // First copy all Cell states into previous_state
   // Then initialise any new CellBlock%s needed.
 
-  b32 created_new_blocks = true;
-  while (created_new_blocks)
   {
-    created_new_blocks = false;
+    PROFILE_SCOPE("copy and create blocks");
 
-    for (u32 hash_slot = 0;
-         hash_slot < universe->hashmap_size;
-         ++hash_slot)
+    b32 created_new_blocks = true;
+    while (created_new_blocks)
     {
-      CellBlock *cell_block = universe->hashmap[hash_slot];
+      created_new_blocks = false;
 
-      while (cell_block != 0)
+      for (u32 hash_slot = 0;
+           hash_slot < universe->hashmap_size;
+           ++hash_slot)
       {
-        // Copy cell_states to cell_previous_states
-        memcpy(cell_block->cell_previous_states, cell_block->cell_states, cell_block_states_array_size(universe));
+        CellBlock *cell_block = universe->hashmap[hash_slot];
+
+        while (cell_block != 0)
+        {
+          // Copy cell_states to cell_previous_states
+          memcpy(cell_block->cell_previous_states, cell_block->cell_states, cell_block_states_array_size(universe));
 
-        created_new_blocks |= create_any_new_cell_blocks_needed(simulate_options, cell_initialisation_options, &rule->config, universe, cell_block);
+          created_new_blocks |= create_any_new_cell_blocks_needed(simulate_options, cell_initialisation_options, rule, universe, cell_block);
 
-        cell_block = cell_block->next_block;
+          cell_block = cell_block->next_block;
+        }
       }
     }
   }
 
   // Simulate all CellBlock%s
 
-  for (u32 hash_slot = 0;
-       hash_slot < universe->hashmap_size;
-       ++hash_slot)
   {
-    CellBlock *cell_block = universe->hashmap[hash_slot];
+    PROFILE_SCOPE("simulate blocks");
+
+    update_rule_input_offsets(rule, universe->cell_block_dim);
+    SimulationKernels kernels = get_simulation_kernels(simulate_options->border.type, rule);
 
-    while (cell_block != 0)
+    if (simulate_options->border.type != BorderType::INFINITE &&
+        kernels.transition_tile_region != 0)
     {
-      if (cell_block->last_simulated_on_frame != current_frame)
+      simulate_dense_grid(simulate_options, rule, universe, kernels.transition_tile_region, current_frame);
+    }
+
+    // Simulate the CellBlock%s not simulated from the DenseGrid
+    for (u32 hash_slot = 0;
+         hash_slot < universe->hashmap_size;
+         ++hash_slot)
+    {
+      CellBlock *cell_block = universe->hashmap[hash_slot];
+
+      while (cell_block != 0)
       {
-        cell_block->last_simulated_on_frame = current_frame;
+        if (cell_block->last_simulated_on_frame != current_frame)
+        {
+          cell_block->last_simulated_on_frame = current_frame;
 
-        simulate_cell_block(simulate_options, cell_initialisation_options, rule, universe, cell_block);
-      }
+          kernels.simulate_cell_block(simulate_options, cell_initialisation_options, rule, universe, cell_block);
+        }
 
-      // Follow any hashmap collision chains
-      cell_block = cell_block->next_block;
+        // Follow any hashmap collision chains
+        cell_block = cell_block->next_block;
+      }
     }
   }
-}
\ No newline at end of file
+}
@@ -59,6 +59,8 @@ do_named_states_ui(RuleConfiguration *rule_config, CellState *currently_active_s
         un_allocate((void*)state_name->start);
         state_name->start = new_state_buffer;
         state_name->end = state_name->start + new_state_length-1;
+
+        build_state_name_table(named_states);
       }
 
       b32 was_null_state = is_null_state(rule_config, named_state.value);
@@ -107,6 +109,7 @@ do_named_states_ui(RuleConfiguration *rule_config, CellState *currently_active_s
       };
 
       Array::new_element(named_states->states) = new_state;
+      build_state_name_table(named_states);
     }
   }
 }
\ No newline at end of file
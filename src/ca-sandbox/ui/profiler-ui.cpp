@@ -0,0 +1,299 @@
+#include "ca-sandbox/ui/profiler-ui.h"
+
+#include "engine/types.h"
+#include "engine/util.h"
+#include "engine/maths.h"
+#include "engine/my-array.h"
+#include "engine/profiler.h"
+
+#include "imgui/imgui.h"
+
+#include <stdio.h>
+
+/// @file
+/// @brief  Timeline and summary of the events recorded by the Profiler
+///
+
+
+/// Only the first threads to record events are shown in the timeline
+const u32 MAX_PROFILER_UI_THREADS = 16;
+
+/// Deeper events are drawn on the last row
+const u32 MAX_PROFILER_UI_DEPTH = 8;
+
+
+struct ProfileSummary
+{
+  const char *name;
+  u32 n_calls;
+  u64 total_duration;
+  u32 max_duration;
+};
+
+
+ImU32
+get_profile_event_colour(const char *name)
+{
+  // Names are string literals, so the pointer identifies the scope
+  u32 hash = (u32)(((uintptr_t)name * 2654435761u) >> 8);
+
+  r32 r, g, b;
+  ImGui::ColorConvertHSVtoRGB((hash % 360) / 360.0, 0.5, 0.8, r, g, b);
+
+  ImU32 result = ImGui::ColorConvertFloat4ToU32({r, g, b, 1});
+  return result;
+}
+
+
+ProfileEvent *
+get_profile_event(Profiler *profiler, u64 event_n)
+{
+  ProfileEvent *result = profiler->events + (event_n & (PROFILER_MAX_EVENTS - 1));
+  return result;
+}
+
+
+void
+do_profiler_timeline(ProfilerUI *profiler_ui, Profiler *profiler, u64 first_event, u32 n_events)
+{
+  u64 latest_end_time = 0;
+  u32 max_depths[MAX_PROFILER_UI_THREADS] = {};
+
+  for (u32 event_n = 0;
+       event_n < n_events;
+       ++event_n)
+  {
+    ProfileEvent *event = get_profile_event(profiler, first_event + event_n);
+    if (event->name != 0 && event->thread_id < MAX_PROFILER_UI_THREADS)
+    {
+      latest_end_time = max(latest_end_time, event->start_time + event->duration);
+      max_depths[event->thread_id] = max(max_depths[event->thread_id], min((u32)event->depth, MAX_PROFILER_UI_DEPTH - 1));
+    }
+  }
+
+  if (!profiler_ui->timeline_frozen)
+  {
+    profiler_ui->timeline_end_time = latest_end_time;
+  }
+
+  u64 timeline_length = profiler_ui->timeline_length_ms * 1000;
+  u64 timeline_end = profiler_ui->timeline_end_time;
+  u64 timeline_start = timeline_end > timeline_length ? timeline_end - timeline_length : 0;
+
+  u32 n_threads = min(profiler->n_threads, MAX_PROFILER_UI_THREADS);
+
+  r32 row_height = ImGui::GetTextLineHeight() + 2;
+  r32 thread_gap = 4;
+
+  r32 thread_offsets[MAX_PROFILER_UI_THREADS] = {};
+  r32 timeline_height = 0;
+  for (u32 thread_n = 0;
+       thread_n < n_threads;
+       ++thread_n)
+  {
+    thread_offsets[thread_n] = timeline_height;
+    timeline_height += (max_depths[thread_n] + 1) * row_height + thread_gap;
+  }
+
+  ImVec2 canvas_size = {ImGui::GetContentRegionAvailWidth(), max(timeline_height, row_height)};
+  ImVec2 canvas_min = ImGui::GetCursorScreenPos();
+  ImVec2 canvas_max = {canvas_min.x + canvas_size.x, canvas_min.y + canvas_size.y};
+
+  ImGui::InvisibleButton("##profiler timeline", canvas_size);
+  b32 timeline_hovered = ImGui::IsItemHovered();
+  ImVec2 mouse_pos = ImGui::GetMousePos();
+
+  ImDrawList *draw_list = ImGui::GetWindowDrawList();
+  draw_list->PushClipRect(canvas_min, canvas_max, true);
+  draw_list->AddRectFilled(canvas_min, canvas_max, ImGui::GetColorU32(ImGuiCol_FrameBg));
+
+  r32 pixels_per_us = canvas_size.x / max(timeline_length, (u64)1);
+
+  ProfileEvent *hovered_event = 0;
+
+  for (u32 event_n = 0;
+       event_n < n_events;
+       ++event_n)
+  {
+    ProfileEvent *event = get_profile_event(profiler, first_event + event_n);
+
+    u64 event_end = event->start_time + event->duration;
+    if (event->name != 0 &&
+        event->thread_id < n_threads &&
+        event_end >= timeline_start &&
+        event->start_time <= timeline_end)
+    {
+      u32 depth = min((u32)event->depth, MAX_PROFILER_UI_DEPTH - 1);
+
+      r32 x0 = canvas_min.x + ((s64)event->start_time - (s64)timeline_start) * pixels_per_us;
+      r32 x1 = canvas_min.x + ((s64)event_end - (s64)timeline_start) * pixels_per_us;
+      x1 = max(x1, x0 + 1);
+      r32 y0 = canvas_min.y + thread_offsets[event->thread_id] + depth * row_height;
+      r32 y1 = y0 + row_height - 1;
+
+      draw_list->AddRectFilled({x0, y0}, {x1, y1}, get_profile_event_colour(event->name));
+
+      if (x1 - x0 > ImGui::CalcTextSize(event->name).x + 4)
+      {
+        draw_list->AddText({x0 + 2, y0}, 0xFF000000, event->name);
+      }
+
+      if (timeline_hovered &&
+          mouse_pos.x >= x0 && mouse_pos.x < x1 &&
+          mouse_pos.y >= y0 && mouse_pos.y < y1)
+      {
+        hovered_event = event;
+      }
+    }
+  }
+
+  for (u32 thread_n = 0;
+       thread_n < n_threads;
+       ++thread_n)
+  {
+    char thread_label[32];
+    snprintf(thread_label, array_count(thread_label), "Thread %u", thread_n);
+
+    ImVec2 label_size = ImGui::CalcTextSize(thread_label);
+    draw_list->AddText({canvas_max.x - label_size.x - 2, canvas_min.y + thread_offsets[thread_n]}, ImGui::GetColorU32(ImGuiCol_TextDisabled), thread_label);
+  }
+
+  draw_list->PopClipRect();
+
+  if (hovered_event != 0)
+  {
+    ImGui::SetTooltip("%s\n%uus\nThread %u", hovered_event->name, hovered_event->duration, hovered_event->thread_id);
+  }
+}
+
+
+void
+do_profiler_summary(Profiler *profiler, u64 first_event, u32 n_events)
+{
+  Array::Array<ProfileSummary> summaries = {};
+
+  for (u32 event_n = 0;
+       event_n < n_events;
+       ++event_n)
+  {
+    ProfileEvent *event = get_profile_event(profiler, first_event + event_n);
+
+    if (event->name != 0)
+    {
+      ProfileSummary *summary = 0;
+      for (u32 summary_n = 0;
+           summary_n < summaries.n_elements;
+           ++summary_n)
+      {
+        if (summaries[summary_n].name == event->name)
+        {
+          summary = &summaries[summary_n];
+          break;
+        }
+      }
+
+      if (summary == 0)
+      {
+        summary = &Array::new_element(summaries);
+        summary->name = event->name;
+      }
+
+      summary->n_calls += 1;
+      summary->total_duration += event->duration;
+      summary->max_duration = max(summary->max_duration, event->duration);
+    }
+  }
+
+  // Sort by total duration, descending
+  for (u32 i = 1;
+       i < summaries.n_elements;
+       ++i)
+  {
+    ProfileSummary summary = summaries[i];
+
+    u32 j = i;
+    while (j > 0 && summaries[j - 1].total_duration < summary.total_duration)
+    {
+      summaries[j] = summaries[j - 1];
+      --j;
+    }
+    summaries[j] = summary;
+  }
+
+  ImGui::Columns(5, "profiler summary");
+  ImGui::Text("Scope");
+  ImGui::NextColumn();
+  ImGui::Text("Calls");
+  ImGui::NextColumn();
+  ImGui::Text("Total");
+  ImGui::NextColumn();
+  ImGui::Text("Average");
+  ImGui::NextColumn();
+  ImGui::Text("Max");
+  ImGui::NextColumn();
+  ImGui::Separator();
+
+  for (u32 summary_n = 0;
+       summary_n < summaries.n_elements;
+       ++summary_n)
+  {
+    ProfileSummary& summary = summaries[summary_n];
+
+    ImGui::Text("%s", summary.name);
+    ImGui::NextColumn();
+    ImGui::Text("%u", summary.n_calls);
+    ImGui::NextColumn();
+    ImGui::Text("%.2fms", summary.total_duration / 1000.0);
+    ImGui::NextColumn();
+    ImGui::Text("%.1fus", (r64)summary.total_duration / summary.n_calls);
+    ImGui::NextColumn();
+    ImGui::Text("%uus", summary.max_duration);
+    ImGui::NextColumn();
+  }
+
+  ImGui::Columns(1);
+
+  Array::free_array(summaries);
+}
+
+
+void
+do_profiler_ui(ProfilerUI *profiler_ui, Profiler *profiler)
+{
+  bool recording = !profiler->paused;
+  if (ImGui::Checkbox("Record", &recording))
+  {
+    profiler->paused = !recording;
+  }
+
+  ImGui::SameLine();
+  ImGui::Checkbox("Freeze timeline", (bool *)&profiler_ui->timeline_frozen);
+
+  ImGui::SameLine();
+  if (ImGui::Button("Clear"))
+  {
+    clear_profiler(profiler);
+  }
+
+  ImGui::SliderFloat("Timeline (ms)", &profiler_ui->timeline_length_ms, 1, 5000, "%.0f", 3);
+
+  ImGui::InputText("##export filename", profiler_ui->export_filename, array_count(profiler_ui->export_filename));
+  ImGui::SameLine();
+  if (ImGui::Button("Export Chrome trace"))
+  {
+    export_chrome_trace(profiler, profiler_ui->export_filename);
+  }
+
+  u64 first_event;
+  u32 n_events;
+  get_profile_events_range(profiler, &first_event, &n_events);
+
+  ImGui::Text("%u events, %u threads", n_events, profiler->n_threads);
+
+  do_profiler_timeline(profiler_ui, profiler, first_event, n_events);
+
+  if (ImGui::CollapsingHeader("Summary", ImGuiTreeNodeFlags_DefaultOpen))
+  {
+    do_profiler_summary(profiler, first_event, n_events);
+  }
+}
@@ -21,6 +21,7 @@
 #include "imgui/imgui.h"
 
 #include <stdio.h>
+#include <string.h>
 
 /// @file
 /// @brief  Provides GUI elements to modify the currently loaded Rule
@@ -464,11 +465,238 @@ display_rule_pattern(RuleConfiguration *rule_config, RulePattern *rule_pattern)
 
 /// Display the Rule UI window; contains the rule file selector, tree building, rule patterns editor
 ///
+/// Number of most-visited nodes listed in the traversal statistics
+const u32 N_HOTTEST_RULE_NODES = 8;
+
+
+/// Returns the number of nodes the sub-tree starting at node_position would have if identical
+///   sub-trees were not shared.  sub_tree_sizes memoises the result for each node, 0 meaning not yet
+///   calculated.
+///
+r64
+get_unshared_sub_tree_size(Rule *rule, u32 node_position, Array::Array<r64>& sub_tree_sizes)
+{
+  r64 result = sub_tree_sizes[node_position];
+
+  if (result == 0)
+  {
+    result = 1;
+
+    RuleNode& node = rule->rule_nodes_table[node_position];
+    if (!node.is_leaf)
+    {
+      for (u32 child_n = 0;
+           child_n < rule->config.named_states.states.n_elements;
+           ++child_n)
+      {
+        result += get_unshared_sub_tree_size(rule, node.children[child_n], sub_tree_sizes);
+      }
+    }
+
+    sub_tree_sizes[node_position] = result;
+  }
+
+  return result;
+}
+
+
+/// Counts the references between rule nodes, and the size the tree would be without sharing
+///   identical sub-trees, to show how well the DAG sharing works for this rule.
+///
+void
+analyse_rule_tree_sharing(RuleUI *rule_ui, Rule *rule)
+{
+  Array::Array<r64> sub_tree_sizes = {};
+  Array::add_n(sub_tree_sizes, rule->rule_nodes_table.n_elements);
+  memset(sub_tree_sizes.elements, 0, sub_tree_sizes.n_elements * sizeof(r64));
+
+  u64 n_child_references = 0;
+  for (u32 node_n = 0;
+       node_n < rule->rule_nodes_table.n_elements;
+       ++node_n)
+  {
+    if (!rule->rule_nodes_table[node_n].is_leaf)
+    {
+      n_child_references += rule->config.named_states.states.n_elements;
+    }
+  }
+
+  rule_ui->sharing_analysis_n_nodes = rule->rule_nodes_table.n_elements;
+  rule_ui->sharing_analysis_n_child_references = n_child_references;
+  rule_ui->sharing_analysis_unshared_tree_size = get_unshared_sub_tree_size(rule, rule->root_node, sub_tree_sizes);
+
+  Array::free_array(sub_tree_sizes);
+}
+
+
+r32
+get_depth_histogram_value(void *data, s32 idx)
+{
+  RuleTraversalStats *stats = (RuleTraversalStats *)data;
+  r32 result = stats->depth_histogram[idx];
+  return result;
+}
+
+
+/// Displays the RuleTraversalStats recorded whilst simulating, and the rule tree sharing analysis
+///
 void
-do_rule_ui(RuleUI *rule_ui, Rule *rule, RuleCreationThread *rule_creation_thread, FilesLoadedState *files_loaded_state)
+do_rule_traversal_stats_ui(RuleUI *rule_ui, Rule *rule)
+{
+  RuleTraversalStats *stats = &rule->traversal_stats;
+
+  // The stats need re-sizing when the rule tree is rebuilt or re-loaded
+  if (rule->collect_traversal_stats &&
+      stats->node_visits.n_elements != rule->rule_nodes_table.n_elements)
+  {
+    reset_rule_traversal_stats(rule);
+  }
+
+  if (ImGui::Checkbox("Collect traversal statistics", (bool *)&rule->collect_traversal_stats))
+  {
+    reset_rule_traversal_stats(rule);
+  }
+  if (ImGui::IsItemHovered())
+  {
+    ImGui::SetTooltip("Counts the rule tree nodes visited whilst simulating, this slows down the simulation");
+  }
+
+  ImGui::SameLine();
+  if (ImGui::Button("Reset"))
+  {
+    reset_rule_traversal_stats(rule);
+  }
+
+  CompactRuleTree *compact_tree = &rule->compact_tree;
+  if (compact_tree->built)
+  {
+    ImGui::Text("Compact tree: %u bytes, %s child entries", get_compact_rule_tree_size(compact_tree), compact_tree->narrow ? "u16" : "u32");
+  }
+
+  ImGui::Text("Traversals: %lu", stats->n_traversals);
+
+  if (stats->n_traversals > 0)
+  {
+    ImGui::Text("Average depth: %.2f / %u inputs", (r64)stats->total_depth / stats->n_traversals, rule->n_inputs);
+    ImGui::Text("FIXED border early-outs: %lu (%.2f%%)", stats->n_border_early_outs, 100.0 * stats->n_border_early_outs / stats->n_traversals);
+
+    ImGui::PlotHistogram("Depth", get_depth_histogram_value, stats, stats->depth_histogram.n_elements, 0, 0, 0, FLT_MAX, {0, 60});
+
+    ImGui::Text("Leaf hits by output state:");
+    for (u32 state = 0;
+         state < stats->leaf_state_hits.n_elements;
+         ++state)
+    {
+      u64 hits = stats->leaf_state_hits[state];
+      if (hits > 0)
+      {
+        String state_name = get_state_name(&rule->config.named_states, state);
+        ImGui::BulletText("%.*s: %lu (%.2f%%)", (s32)(state_name.end - state_name.start), state_name.start, hits, 100.0 * hits / stats->n_traversals);
+      }
+    }
+
+    // Find the most visited nodes, by insertion into a small sorted list
+    u32 hottest_nodes[N_HOTTEST_RULE_NODES];
+    u32 n_hottest_nodes = 0;
+    u32 n_visited_nodes = 0;
+
+    for (u32 node_n = 0;
+         node_n < stats->node_visits.n_elements;
+         ++node_n)
+    {
+      u64 visits = stats->node_visits[node_n];
+      if (visits > 0)
+      {
+        ++n_visited_nodes;
+
+        u32 i = min(n_hottest_nodes, N_HOTTEST_RULE_NODES - 1);
+        if (n_hottest_nodes < N_HOTTEST_RULE_NODES || visits > stats->node_visits[hottest_nodes[i]])
+        {
+          while (i > 0 && stats->node_visits[hottest_nodes[i - 1]] < visits)
+          {
+            hottest_nodes[i] = hottest_nodes[i - 1];
+            --i;
+          }
+          hottest_nodes[i] = node_n;
+          n_hottest_nodes = min(n_hottest_nodes + 1, N_HOTTEST_RULE_NODES);
+        }
+      }
+    }
+
+    ImGui::Text("Nodes visited: %u / %u", n_visited_nodes, stats->node_visits.n_elements);
+
+    ImGui::Columns(3, "hottest rule nodes");
+    ImGui::Text("Node");
+    ImGui::NextColumn();
+    ImGui::Text("Visits");
+    ImGui::NextColumn();
+    ImGui::Text("Per traversal");
+    ImGui::NextColumn();
+    ImGui::Separator();
+
+    for (u32 hot_node_n = 0;
+         hot_node_n < n_hottest_nodes;
+         ++hot_node_n)
+    {
+      u32 node_position = hottest_nodes[hot_node_n];
+      u64 visits = stats->node_visits[node_position];
+
+      ImGui::Text("%u%s", node_position, rule->rule_nodes_table[node_position].is_leaf ? " (leaf)" : "");
+      ImGui::NextColumn();
+      ImGui::Text("%lu", visits);
+      ImGui::NextColumn();
+      ImGui::Text("%.3f", (r64)visits / stats->n_traversals);
+      ImGui::NextColumn();
+    }
+
+    ImGui::Columns(1);
+
+    if (ImGui::Button("Reorder nodes by visits"))
+    {
+      reorder_rule_tree(rule, &stats->node_visits);
+      build_compact_rule_tree(rule);
+      reset_rule_traversal_stats(rule);
+    }
+    if (ImGui::IsItemHovered())
+    {
+      ImGui::SetTooltip("Re-lays out the rule tree so the most visited nodes are next to each other in memory");
+    }
+  }
+
+  ImGui::Spacing();
+
+  if (ImGui::Button("Analyse tree sharing"))
+  {
+    analyse_rule_tree_sharing(rule_ui, rule);
+  }
+
+  if (rule_ui->sharing_analysis_n_nodes != 0 &&
+      rule_ui->sharing_analysis_n_nodes == rule->rule_nodes_table.n_elements)
+  {
+    ImGui::Text("Unique nodes: %u (%u bytes)", rule_ui->sharing_analysis_n_nodes, rule_ui->sharing_analysis_n_nodes * rule->rule_nodes_table.element_size);
+    ImGui::Text("Child references: %lu", rule_ui->sharing_analysis_n_child_references);
+    ImGui::Text("Unshared tree size: %.4g nodes (%.4gx)", rule_ui->sharing_analysis_unshared_tree_size, rule_ui->sharing_analysis_unshared_tree_size / rule_ui->sharing_analysis_n_nodes);
+  }
+}
+
+
+void
+do_rule_ui(RuleUI *rule_ui, Rule *rule, RuleCreationThread *rule_creation_thread, FileLoadingThread *rule_loading_thread, FilesLoadedState *files_loaded_state)
 {
   ImGui::Text("Rule file: %.*s", rule_ui->file_picker.selected_file.n_elements, rule_ui->file_picker.selected_file.elements);
 
+  if (rule_loading_thread->currently_running || rule_loading_thread->finished)
+  {
+    ImGui::Text("Loading rule file: %s", rule_loading_thread->filename);
+
+    r64 fraction_loaded = 0;
+    if (rule_loading_thread->progress.total != 0)
+    {
+      fraction_loaded = (r64)rule_loading_thread->progress.done / (r64)rule_loading_thread->progress.total;
+    }
+    ImGui::ProgressBar(fraction_loaded);
+  }
+
   const char *rule_file_picker_name = "Rule file picker";
   if (ImGui::Button("Change rule file"))
   {
@@ -495,6 +723,16 @@ do_rule_ui(RuleUI *rule_ui, Rule *rule, RuleCreationThread *rule_creation_thread
       rule_ui->save_rule_file = true;
     }
 
+    ImGui::SameLine();
+    if (ImGui::Button("Save compiled rule file"))
+    {
+      rule_ui->save_compiled_rule_file = true;
+    }
+    if (ImGui::IsItemHovered())
+    {
+      ImGui::SetTooltip("Saves the rule and its built rule tree to a .rulec file, which loads without re-building the tree");
+    }
+
     const char *close_warning_window_name = "Close Rule File";
     if (ImGui::Button("Close rule file"))
     {
@@ -533,6 +771,13 @@ do_rule_ui(RuleUI *rule_ui, Rule *rule, RuleCreationThread *rule_creation_thread
     {
       start_build_rule_tree_thread(rule_creation_thread, rule);
     }
+
+    ImGui::SameLine();
+    ImGui::Checkbox("Lazy", (bool *)&rule_creation_thread->build_lazily);
+    if (ImGui::IsItemHovered())
+    {
+      ImGui::SetTooltip("Only build the parts of the rule tree used by the simulation, as they are needed.\nFor rules with too many states or neighbours to build the whole tree.");
+    }
   }
 
   if (rule_creation_thread->last_build_total_time != 0)
@@ -544,6 +789,15 @@ do_rule_ui(RuleUI *rule_ui, Rule *rule, RuleCreationThread *rule_creation_thread
     ImGui::Spacing();
   }
 
+  if (rule->rule_tree_built && rule->lazy_rule_tree)
+  {
+    ImGui::Text("Lazy rule tree: %u nodes built", rule->rule_nodes_table.n_elements);
+  }
+  else if (rule->rule_tree_built && ImGui::CollapsingHeader("Traversal statistics"))
+  {
+    do_rule_traversal_stats_ui(rule_ui, rule);
+  }
+
   // Display all rule patterns
   ImGui::TextWrapped(
 """Modify each of the patterns below by clicking on the state buttons to \
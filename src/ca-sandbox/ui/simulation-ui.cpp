@@ -21,7 +21,7 @@
 
 
 void
-do_simulation_ui(SimulationUI *simulation_ui, u64 frame_start, b32 rule_tree_built, FilesLoadedState *files_loaded_state, b32 *save_universe)
+do_simulation_ui(SimulationUI *simulation_ui, u64 frame_start, b32 rule_tree_built, FilesLoadedState *files_loaded_state, b32 *save_universe, CheckpointWriter *checkpoint_writer)
 {
   ImGui::Text("Mode: %s", simulation_ui->mode == Mode::Simulator ? "Simulator" : "Editor");
 
@@ -42,6 +42,7 @@ do_simulation_ui(SimulationUI *simulation_ui, u64 frame_start, b32 rule_tree_bui
       simulation_ui->simulating = false;
       simulation_ui->mode = Mode::Simulator;
       simulation_ui->simulation_step = 0;
+      simulation_ui->start_new_checkpoint_log = true;
     }
   }
   else if (simulation_ui->mode == Mode::Simulator)
@@ -90,6 +91,36 @@ do_simulation_ui(SimulationUI *simulation_ui, u64 frame_start, b32 rule_tree_bui
 
       r32 human_cumulative_sim_time = human_time(simulation_ui->simulation_delta_cumulative_average, &unit);
       ImGui::Text("Cumulative Moving Average Simulation Time: %.2f %s", human_cumulative_sim_time, unit);
+
+      if (ImGui::CollapsingHeader("Checkpoints"))
+      {
+        ImGui::Checkbox("Write checkpoints", (bool *)&simulation_ui->checkpointing);
+
+        ImGui::PushItemWidth(100);
+        ImGui::DragInt("Steps between checkpoints", &simulation_ui->checkpoint_interval, 1, 1, 1000000);
+        ImGui::PopItemWidth();
+
+        if (checkpoint_writer->log_started)
+        {
+          ImGui::TextWrapped("Log: %s", checkpoint_writer->filename);
+          ImGui::Text("Last checkpoint: step %lu", checkpoint_writer->last_checkpoint_step);
+          ImGui::Text("Changed blocks: %u, deleted blocks: %u", checkpoint_writer->last_n_changed_blocks, checkpoint_writer->last_n_deleted_blocks);
+
+          r32 human_last_write_time = human_time(checkpoint_writer->last_write_time, &unit);
+          ImGui::Text("Write time: %.2f %s", human_last_write_time, unit);
+
+          if (checkpoint_writer->error)
+          {
+            ImGui::Text("Error writing checkpoint log");
+          }
+
+          ImGui::PushItemWidth(100);
+          ImGui::DragInt("##restore step", &simulation_ui->restore_checkpoint_step, 1, 0, MAX_S32);
+          ImGui::PopItemWidth();
+          ImGui::SameLine();
+          simulation_ui->restore_checkpoint = ImGui::Button("Restore checkpoint");
+        }
+      }
     }
 
     b32 switch_to_editor = ImGui::Button("End simulation");
@@ -21,13 +21,25 @@
 /// The GUI elements for managing the .cells file, and the objects which its data fills.
 ///
 void
-do_universe_ui(UniverseUI *universe_ui, Universe **universe_ptr, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, NamedStates *named_states, FilesLoadedState *files_loaded_state)
+do_universe_ui(UniverseUI *universe_ui, Universe **universe_ptr, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, NamedStates *named_states, FilesLoadedState *files_loaded_state, FileLoadingThread *cells_loading_thread)
 {
   if (files_loaded_state->cells_file_loaded && *universe_ptr != 0)
   {
     ImGui::Text("Cells filename: %s", universe_ui->loaded_file_name);
   }
 
+  if (cells_loading_thread->currently_running)
+  {
+    ImGui::Text("Loading cells file: %s", cells_loading_thread->filename);
+
+    r64 fraction_loaded = 0;
+    if (cells_loading_thread->progress.total != 0)
+    {
+      fraction_loaded = (r64)cells_loading_thread->progress.done / (r64)cells_loading_thread->progress.total;
+    }
+    ImGui::ProgressBar(fraction_loaded);
+  }
+
   const char *cells_file_picker_name = "Cells file picker";
   if (ImGui::Button("Change cells file"))
   {
@@ -87,6 +99,8 @@ do_universe_ui(UniverseUI *universe_ui, Universe **universe_ptr, SimulateOptions
       *universe_ptr = new_universe;
     }
 
+    ImGui::Checkbox("Draw cells as textures", (bool *)&universe_ui->draw_cells_as_textures);
+
     if (ImGui::BeginPopupModal(close_warning_window_name))
     {
       ImGui::Text("Are you sure you want to close this cells file?");
@@ -1,5 +1,6 @@
 #include "ca-sandbox/view-panning.h"
 
+#include "engine/util.h"
 #include "engine/maths.h"
 #include "engine/vectors.h"
 
@@ -67,6 +68,42 @@ screen_position_to_universe_position(ViewPanning *view_panning, vec2 screen_mous
 }
 
 
+/// Finds the range of CellBlock positions visible on screen, inclusive.
+void
+get_visible_cell_blocks(ViewPanning *view_panning, s32vec2 *start_block, s32vec2 *end_block)
+{
+  vec2 screen_corners[] = {{-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+
+  vec2 lowest = screen_position_to_cell_block_fraction(view_panning->projection_matrix, screen_corners[0]);
+  vec2 highest = lowest;
+
+  for (u32 corner_n = 1;
+       corner_n < array_count(screen_corners);
+       ++corner_n)
+  {
+    vec2 corner = screen_position_to_cell_block_fraction(view_panning->projection_matrix, screen_corners[corner_n]);
+    lowest = vec2_min(lowest, corner);
+    highest = vec2_max(highest, corner);
+  }
+
+  *start_block = {(s32)floor(lowest.x), (s32)floor(lowest.y)};
+  *end_block = {(s32)floor(highest.x), (s32)floor(highest.y)};
+}
+
+
+/// The width of a CellBlock on screen, in pixels
+r32
+get_pixels_per_cell_block(ViewPanning *view_panning, s32vec2 window_size)
+{
+  vec4 origin = mat4x4MultiplyVector(view_panning->projection_matrix, (vec4){0, 0, 0, 1});
+  vec4 one_block = mat4x4MultiplyVector(view_panning->projection_matrix, (vec4){1, 0, 0, 1});
+
+  // Screen space is -1 to 1 across the window
+  r32 result = fabs(one_block.x - origin.x) * window_size.x * 0.5;
+  return result;
+}
+
+
 void
 update_view_scaling(ViewPanning *view_panning, vec2 screen_mouse_pos)
 {
@@ -76,7 +113,7 @@ update_view_scaling(ViewPanning *view_panning, vec2 screen_mouse_pos)
   const r32 scale_acceleration = 0.02;
   const r32 scale_deacceleration = 0.8;
   const r32 max_scale = 2.0;
-  const r32 min_scale = 0.003;
+  const r32 min_scale = 0.0001;
 
   if (!io.WantCaptureMouse)
   {
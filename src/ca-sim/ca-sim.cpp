@@ -0,0 +1,418 @@
+#include "engine/types.h"
+#include "engine/print.h"
+#include "engine/timing.h"
+#include "engine/profiler.h"
+#include "engine/my-array.h"
+#include "engine/maths.h"
+
+#include "ca-sandbox/rule.h"
+#include "ca-sandbox/load-rule.h"
+#include "ca-sandbox/compiled-rule.h"
+#include "ca-sandbox/load-universe.h"
+#include "ca-sandbox/save-universe.h"
+#include "ca-sandbox/simulate.h"
+#include "ca-sandbox/cell-blocks.h"
+#include "ca-sandbox/one-dim-engine.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/// @file
+/// @brief  ca-sim: Headless batch simulation, without SDL or OpenGL
+///
+/// Loads a .cells file and a .rule (or .rulec) file, runs the simulation for a number of steps, and
+///   optionally writes the resulting universe to a .cells file.
+///
+
+
+struct CA_SimOptions
+{
+  const char *cells_filename;
+  const char *rule_filename;
+  const char *output_filename;
+  const char *profile_filename;
+
+  u64 n_steps;
+
+  b32 override_border_type;
+  BorderType border_type;
+
+  b32 print_timing;
+  b32 lazy_rule_tree;
+
+  /// Simulate one row with the OneDimEngine, instead of the whole universe
+  b32 one_dim;
+  s32 one_dim_row;
+};
+
+
+void
+print_usage(const char *program_name)
+{
+  print("Usage: %s [options] <cells file> <rule file>\n", program_name);
+  print("\n");
+  print("Options:\n");
+  print("  -n, --steps <n>       Number of simulation steps to run (default 1)\n");
+  print("  -o, --output <file>   Save the resulting universe to a .cells file\n");
+  print("  -b, --border <type>   Override the border type from the cells file: fixed, infinite or torus.\n");
+  print("                          The border corners are still read from the cells file.\n");
+  print("  -t, --timing          Print load, build and simulation timings\n");
+  print("  -l, --lazy            Build the rule tree lazily, as the simulation uses it\n");
+  print("  -p, --profile <file>  Write the profiler events to a Chrome trace JSON file\n");
+  print("  -1, --one-dim <row>   Simulate one row with a ONE_DIM rule.  The output file holds the\n");
+  print("                          space-time history, one generation per row below <row>.\n");
+  print("  -h, --help            Print this message\n");
+}
+
+
+b32
+read_border_type_argument(const char *argument, BorderType *result)
+{
+  b32 success = true;
+
+  if (strcmp(argument, "fixed") == 0)
+  {
+    *result = BorderType::FIXED;
+  }
+  else if (strcmp(argument, "infinite") == 0)
+  {
+    *result = BorderType::INFINITE;
+  }
+  else if (strcmp(argument, "torus") == 0)
+  {
+    *result = BorderType::TORUS;
+  }
+  else
+  {
+    print("Error: Invalid border type \"%s\".\n", argument);
+    success &= false;
+  }
+
+  return success;
+}
+
+
+b32
+read_arguments(int argc, const char *argv[], CA_SimOptions *options)
+{
+  b32 success = true;
+
+  options->n_steps = 1;
+
+  u32 n_positional_arguments = 0;
+
+  for (s32 arg_n = 1;
+       arg_n < argc && success;
+       ++arg_n)
+  {
+    const char *argument = argv[arg_n];
+    b32 has_value = arg_n + 1 < argc;
+
+    if (strcmp(argument, "-h") == 0 || strcmp(argument, "--help") == 0)
+    {
+      success &= false;
+    }
+    else if (strcmp(argument, "-t") == 0 || strcmp(argument, "--timing") == 0)
+    {
+      options->print_timing = true;
+    }
+    else if (strcmp(argument, "-l") == 0 || strcmp(argument, "--lazy") == 0)
+    {
+      options->lazy_rule_tree = true;
+    }
+    else if (strcmp(argument, "-n") == 0 || strcmp(argument, "--steps") == 0)
+    {
+      if (has_value)
+      {
+        char *end;
+        options->n_steps = strtoull(argv[++arg_n], &end, 10);
+        if (*end != '\0')
+        {
+          print("Error: Invalid number of steps \"%s\".\n", argv[arg_n]);
+          success &= false;
+        }
+      }
+      else
+      {
+        print("Error: %s requires a value.\n", argument);
+        success &= false;
+      }
+    }
+    else if (strcmp(argument, "-o") == 0 || strcmp(argument, "--output") == 0)
+    {
+      if (has_value)
+      {
+        options->output_filename = argv[++arg_n];
+      }
+      else
+      {
+        print("Error: %s requires a value.\n", argument);
+        success &= false;
+      }
+    }
+    else if (strcmp(argument, "-p") == 0 || strcmp(argument, "--profile") == 0)
+    {
+      if (has_value)
+      {
+        options->profile_filename = argv[++arg_n];
+      }
+      else
+      {
+        print("Error: %s requires a value.\n", argument);
+        success &= false;
+      }
+    }
+    else if (strcmp(argument, "-1") == 0 || strcmp(argument, "--one-dim") == 0)
+    {
+      if (has_value)
+      {
+        char *end;
+        options->one_dim = true;
+        options->one_dim_row = strtol(argv[++arg_n], &end, 10);
+        if (*end != '\0')
+        {
+          print("Error: Invalid row \"%s\".\n", argv[arg_n]);
+          success &= false;
+        }
+      }
+      else
+      {
+        print("Error: %s requires a value.\n", argument);
+        success &= false;
+      }
+    }
+    else if (strcmp(argument, "-b") == 0 || strcmp(argument, "--border") == 0)
+    {
+      if (has_value)
+      {
+        options->override_border_type = true;
+        success &= read_border_type_argument(argv[++arg_n], &options->border_type);
+      }
+      else
+      {
+        print("Error: %s requires a value.\n", argument);
+        success &= false;
+      }
+    }
+    else if (argument[0] == '-')
+    {
+      print("Error: Unknown option \"%s\".\n", argument);
+      success &= false;
+    }
+    else
+    {
+      if (n_positional_arguments == 0)
+      {
+        options->cells_filename = argument;
+      }
+      else if (n_positional_arguments == 1)
+      {
+        options->rule_filename = argument;
+      }
+      ++n_positional_arguments;
+    }
+  }
+
+  if (success && n_positional_arguments != 2)
+  {
+    print("Error: Expected a cells file and a rule file.\n");
+    success &= false;
+  }
+
+  return success;
+}
+
+
+b32
+load_rule(const char *filename, Rule *rule, RuleCreationThread *rule_creation_thread)
+{
+  b32 success = true;
+
+  if (is_compiled_rule_filename(filename))
+  {
+    success &= load_compiled_rule_file(filename, rule);
+  }
+  else
+  {
+    success &= load_rule_file(filename, &rule->config);
+  }
+
+  if (success && !rule->rule_tree_built)
+  {
+    rule_creation_thread->rule = rule;
+    build_rule_tree(rule_creation_thread);
+  }
+
+  return success;
+}
+
+
+/// Runs the OneDimEngine on a row of the universe.  The universe is replaced by the space-time
+///   history, so it can be saved.
+b32
+simulate_one_dim(CA_SimOptions *options, SimulateOptions *simulate_options, CellInitialisationOptions *cell_initialisation_options, Rule *rule, Universe *universe)
+{
+  b32 success = true;
+
+  u32 history_length = min(options->n_steps + 1, (u64)DEFAULT_ONE_DIM_HISTORY_LENGTH);
+
+  OneDimEngine engine = {};
+  success &= init_one_dim_engine(&engine, rule, universe, &simulate_options->border, options->one_dim_row, history_length);
+
+  if (success)
+  {
+    u64 simulate_start_time = get_us();
+    for (u64 step = 1;
+         step <= options->n_steps;
+         ++step)
+    {
+      step_one_dim_engine(&engine, rule);
+    }
+    u64 simulate_total_time = get_us() - simulate_start_time;
+
+    print("\nSimulated %lu generations of %u cells\n", options->n_steps, engine.n_cells);
+
+    if (options->print_timing)
+    {
+      print("Simulation time: %luus\n", simulate_total_time);
+
+      if (options->n_steps > 0)
+      {
+        print("  per step: %.2fus\n", (r64)simulate_total_time / options->n_steps);
+        print("  per cell: %.4fus\n", (r64)simulate_total_time / (options->n_steps * engine.n_cells));
+      }
+    }
+
+    u32 cell_block_dim = universe->cell_block_dim;
+    destroy_cell_hashmap(universe);
+    init_cell_hashmap(universe);
+    universe->cell_block_dim = cell_block_dim;
+
+    copy_one_dim_history_to_universe(&engine, universe, cell_initialisation_options);
+  }
+
+  destroy_one_dim_engine(&engine);
+
+  return success;
+}
+
+
+int
+main(int argc, const char *argv[])
+{
+  s32 result = 0;
+
+  CA_SimOptions options = {};
+  b32 success = read_arguments(argc, argv, &options);
+
+  if (!success)
+  {
+    print_usage(argv[0]);
+    result = 1;
+  }
+  else
+  {
+    Rule rule = {};
+    RuleCreationThread rule_creation_thread = {};
+    rule_creation_thread.build_lazily = options.lazy_rule_tree;
+
+    u64 load_rule_start_time = get_us();
+    success &= load_rule(options.rule_filename, &rule, &rule_creation_thread);
+    u64 load_rule_total_time = get_us() - load_rule_start_time;
+
+    if (!success)
+    {
+      print("Error: Failed to load rule file %s.\n", options.rule_filename);
+      result = 1;
+    }
+    else
+    {
+      SimulateOptions simulate_options = default_simulation_options();
+      CellInitialisationOptions cell_initialisation_options = {};
+      default_cell_initialisation_options(&cell_initialisation_options);
+      Array::Array<char> error_message = {};
+
+      u64 load_cells_start_time = get_us();
+      Universe *universe = load_universe(options.cells_filename, &simulate_options, &cell_initialisation_options, &rule.config.named_states, error_message);
+      u64 load_cells_total_time = get_us() - load_cells_start_time;
+
+      if (universe == 0)
+      {
+        print("Error: Failed to load cells file %s: %.*s\n", options.cells_filename, error_message.n_elements, error_message.elements);
+        result = 1;
+      }
+      else
+      {
+        if (options.override_border_type)
+        {
+          simulate_options.border.type = options.border_type;
+        }
+
+        if (options.one_dim)
+        {
+          if (!simulate_one_dim(&options, &simulate_options, &cell_initialisation_options, &rule, universe))
+          {
+            result = 1;
+          }
+        }
+        else
+        {
+          u64 total_cell_blocks_simulated = 0;
+
+          u64 simulate_start_time = get_us();
+          for (u64 step = 1;
+               step <= options.n_steps;
+               ++step)
+          {
+            simulate_cells(&simulate_options, &cell_initialisation_options, &rule, universe, step);
+            total_cell_blocks_simulated += universe->n_cell_blocks_in_use;
+          }
+          u64 simulate_total_time = get_us() - simulate_start_time;
+
+          print("\nSimulated %lu steps, %u cell blocks in use\n", options.n_steps, universe->n_cell_blocks_in_use);
+
+          if (rule.lazy_rule_tree)
+          {
+            print("Lazy rule tree: %u nodes built\n", rule.rule_nodes_table.n_elements);
+          }
+
+          if (options.print_timing)
+          {
+            print("Rule load and build time: %luus (rule tree build: %uus)\n", load_rule_total_time, rule_creation_thread.last_build_total_time);
+            print("Cells load time: %luus\n", load_cells_total_time);
+            print("Simulation time: %luus\n", simulate_total_time);
+
+            if (options.n_steps > 0)
+            {
+              print("  per step: %.2fus\n", (r64)simulate_total_time / options.n_steps);
+            }
+            if (total_cell_blocks_simulated > 0)
+            {
+              print("  per cell block: %.3fus\n", (r64)simulate_total_time / total_cell_blocks_simulated);
+            }
+          }
+        }
+
+        if (options.profile_filename != 0)
+        {
+          if (!export_chrome_trace(&global_profiler, options.profile_filename))
+          {
+            result = 1;
+          }
+        }
+
+        if (options.output_filename != 0)
+        {
+          b32 saved = save_universe_to_file(options.output_filename, universe, &simulate_options, &cell_initialisation_options, &rule.config.named_states);
+          if (!saved)
+          {
+            print("Error: Failed to save cells file %s.\n", options.output_filename);
+            result = 1;
+          }
+        }
+      }
+    }
+  }
+
+  return result;
+}
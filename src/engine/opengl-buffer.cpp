@@ -32,6 +32,17 @@ create_opengl_buffer(OpenGL_Buffer *buffer, u32 element_size, GLenum binding_tar
   buffer->elements_used = 0;
   buffer->total_elements = max(size, INITIAL_GL_BUFFER_TOTAL_ELEMENTS);
 
+  buffer->first_element = 0;
+  buffer->streaming = false;
+  buffer->stream_region = 0;
+  for (u32 region_n = 0;
+       region_n < OPENGL_BUFFER_STREAM_REGIONS;
+       ++region_n)
+  {
+    buffer->stream_fences[region_n] = 0;
+  }
+  buffer->stream_mapping = 0;
+
   // TODO: Can we do without this?
   buffer->setup_attributes_function = 0;
 
@@ -44,6 +55,184 @@ create_opengl_buffer(OpenGL_Buffer *buffer, u32 element_size, GLenum binding_tar
 }
 
 
+/// @brief Creates an OpenGL_Buffer which is re-written in bulk each time it is used, through
+///          opengl_buffer_map_stream() and opengl_buffer_unmap_stream().
+///
+/// The buffer holds OPENGL_BUFFER_STREAM_REGIONS regions of `size` elements, and each mapping
+///   writes to the next region.  The region is mapped unsynchronised, so writing to it doesn't wait
+///   for draws from the other regions to finish.  Only wrapping round to a region which the GPU
+///   could still be reading waits, on the fence placed after that region was last used.
+///
+/// The other opengl_buffer_ functions are not for use with streaming buffers.
+///
+void
+create_opengl_stream_buffer(OpenGL_Buffer *buffer, u32 element_size, GLenum binding_target, u32 size)
+{
+  create_opengl_buffer(buffer, element_size, binding_target, GL_STREAM_DRAW, size);
+  buffer->streaming = true;
+
+  glBindBuffer(buffer->binding_target, buffer->id);
+  glBufferData(buffer->binding_target, buffer->element_size * buffer->total_elements * OPENGL_BUFFER_STREAM_REGIONS, NULL, GL_STREAM_DRAW);
+
+  opengl_print_errors();
+}
+
+
+void
+delete_opengl_stream_fences(OpenGL_Buffer *buffer)
+{
+  for (u32 region_n = 0;
+       region_n < OPENGL_BUFFER_STREAM_REGIONS;
+       ++region_n)
+  {
+    if (buffer->stream_fences[region_n] != 0)
+    {
+      glDeleteSync(buffer->stream_fences[region_n]);
+      buffer->stream_fences[region_n] = 0;
+    }
+  }
+}
+
+
+/// Deletes the OpenGL buffer object, and the fences of a streaming buffer.  The OpenGL_Buffer can
+///   then be re-created with create_opengl_buffer() or create_opengl_stream_buffer().
+void
+destroy_opengl_buffer(OpenGL_Buffer *buffer)
+{
+  assert(buffer->stream_mapping == 0);
+
+  delete_opengl_stream_fences(buffer);
+  glDeleteBuffers(1, &buffer->id);
+
+  buffer->id = 0;
+  buffer->elements_used = 0;
+  buffer->total_elements = 0;
+
+  opengl_print_errors();
+}
+
+
+/// @brief Maps the next region of a streaming OpenGL_Buffer for writing up to max_elements, the
+///          number actually written is passed to opengl_buffer_unmap_stream().
+///
+/// The current region is fenced first, so everything drawn from it since it was mapped completes
+///   before it is written again.  If the regions are too small they are re-allocated larger,
+///   without copying as every mapping is re-written in full.
+///
+/// @returns  A pointer to write the elements to, or 0 if the mapping failed.
+///
+void *
+opengl_buffer_map_stream(OpenGL_Buffer *buffer, u32 max_elements)
+{
+  assert(buffer->streaming);
+  assert(buffer->stream_mapping == 0);
+
+  void *result = 0;
+
+  glBindBuffer(buffer->binding_target, buffer->id);
+
+  if (max_elements > buffer->total_elements)
+  {
+    u32 new_total_elements = buffer->total_elements;
+    while (new_total_elements < max_elements)
+    {
+      assert(buffer->element_size * new_total_elements * OPENGL_BUFFER_STREAM_REGIONS < MAX_BUFFER_SIZE / 2);
+      new_total_elements *= 2;
+    }
+
+    print("Out of space in streaming OpenGL buffer, allocating %u elements per region.\n", new_total_elements);
+
+    // The new storage isn't being read by any draws, so none of the fences apply to it
+    glBufferData(buffer->binding_target, buffer->element_size * new_total_elements * OPENGL_BUFFER_STREAM_REGIONS, NULL, GL_STREAM_DRAW);
+    delete_opengl_stream_fences(buffer);
+
+    buffer->total_elements = new_total_elements;
+    buffer->stream_region = 0;
+
+    if (buffer->setup_attributes_function != 0)
+    {
+      buffer->setup_attributes_function(buffer);
+    }
+  }
+  else
+  {
+    if (buffer->stream_fences[buffer->stream_region] != 0)
+    {
+      glDeleteSync(buffer->stream_fences[buffer->stream_region]);
+    }
+    buffer->stream_fences[buffer->stream_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    buffer->stream_region = (buffer->stream_region + 1) % OPENGL_BUFFER_STREAM_REGIONS;
+
+    GLsync fence = buffer->stream_fences[buffer->stream_region];
+    if (fence != 0)
+    {
+      GLenum wait_result;
+      do
+      {
+        wait_result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+      }
+      while (wait_result == GL_TIMEOUT_EXPIRED);
+
+      if (wait_result == GL_WAIT_FAILED)
+      {
+        print("Error: Failed waiting for streaming OpenGL buffer region %u.\n", buffer->stream_region);
+      }
+
+      glDeleteSync(fence);
+      buffer->stream_fences[buffer->stream_region] = 0;
+    }
+  }
+
+  buffer->first_element = buffer->stream_region * buffer->total_elements;
+  buffer->elements_used = 0;
+
+  // Zero length mappings are an error
+  u32 n_elements_to_map = max(max_elements, 1u);
+
+  buffer->stream_mapping = glMapBufferRange(buffer->binding_target,
+                                            buffer->element_size * buffer->first_element,
+                                            buffer->element_size * n_elements_to_map,
+                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+
+  if (buffer->stream_mapping == 0)
+  {
+    print("Error: Failed to map streaming OpenGL buffer.\n");
+  }
+
+  result = buffer->stream_mapping;
+
+  opengl_print_errors();
+  return result;
+}
+
+
+/// Finishes writing the region mapped by opengl_buffer_map_stream(), which now holds n_elements.
+void
+opengl_buffer_unmap_stream(OpenGL_Buffer *buffer, u32 n_elements)
+{
+  if (buffer->stream_mapping != 0)
+  {
+    glBindBuffer(buffer->binding_target, buffer->id);
+
+    if (glUnmapBuffer(buffer->binding_target))
+    {
+      buffer->elements_used = n_elements;
+    }
+    else
+    {
+      // The contents were lost, e.g. by a display mode change, so draw nothing this time
+      print("Error: Streaming OpenGL buffer contents were corrupted whilst mapped.\n");
+      buffer->elements_used = 0;
+    }
+
+    buffer->stream_mapping = 0;
+  }
+
+  opengl_print_errors();
+}
+
+
 /// Re-allocate an OpenGL_Buffer object to hold at least n additional elements.
 ///
 /// Copies the old data into the new buffer, element indices remain intact.
@@ -54,6 +243,7 @@ opengl_buffer_extend(OpenGL_Buffer *buffer, u32 minimum_new_total_elements)
   print("Out of space in OpenGL buffer, allocating larger.\n");
 
   assert(buffer->total_elements != 0);
+  assert(!buffer->streaming);
 
   // At least one double, then as many more as needed to be greater than minimum_new_total_elements
   u32 new_total_elements = buffer->total_elements * 2;
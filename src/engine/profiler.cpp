@@ -0,0 +1,146 @@
+#include "engine/profiler.h"
+
+#include "engine/types.h"
+#include "engine/print.h"
+#include "engine/timing.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/// @file
+/// @brief  Scoped timing instrumentation, recorded into a ring buffer
+///
+
+
+Profiler global_profiler;
+
+
+/// 0 if the thread hasn't recorded an event yet, otherwise the thread id + 1.
+static __thread u32 profiler_thread_id_plus_one;
+
+/// The number of PROFILE_SCOPEs currently open on this thread.
+static __thread u32 profiler_depth;
+
+
+void
+clear_profiler(Profiler *profiler)
+{
+  profiler->n_events_recorded = 0;
+  memset(profiler->events, 0, sizeof(profiler->events));
+}
+
+
+u32
+get_profiler_thread_id(Profiler *profiler)
+{
+  if (profiler_thread_id_plus_one == 0)
+  {
+    profiler_thread_id_plus_one = __sync_add_and_fetch(&profiler->n_threads, 1);
+  }
+
+  u32 result = profiler_thread_id_plus_one - 1;
+  return result;
+}
+
+
+void
+get_profile_events_range(Profiler *profiler, u64 *first_event, u32 *n_events)
+{
+  u64 n_events_recorded = profiler->n_events_recorded;
+
+  if (n_events_recorded > PROFILER_MAX_EVENTS)
+  {
+    *first_event = n_events_recorded - PROFILER_MAX_EVENTS;
+    *n_events = PROFILER_MAX_EVENTS;
+  }
+  else
+  {
+    *first_event = 0;
+    *n_events = n_events_recorded;
+  }
+}
+
+
+ProfileScope::ProfileScope(const char *scope_name)
+{
+  name = scope_name;
+  recording = !global_profiler.paused;
+
+  if (recording)
+  {
+    ++profiler_depth;
+    start_time = get_us();
+  }
+}
+
+
+ProfileScope::~ProfileScope()
+{
+  if (recording)
+  {
+    u64 end_time = get_us();
+    --profiler_depth;
+
+    u64 event_n = __sync_fetch_and_add(&global_profiler.n_events_recorded, 1);
+    ProfileEvent *event = global_profiler.events + (event_n & (PROFILER_MAX_EVENTS - 1));
+
+    event->name = name;
+    event->start_time = start_time;
+    event->duration = end_time - start_time;
+    event->thread_id = get_profiler_thread_id(&global_profiler);
+    event->depth = profiler_depth;
+  }
+}
+
+
+/// Writes the events in the ring buffer in the Chrome trace event format, which can be opened in
+///   chrome://tracing or Perfetto.
+b32
+export_chrome_trace(Profiler *profiler, const char *filename)
+{
+  b32 success = true;
+
+  FILE *file = fopen(filename, "w");
+  if (file == 0)
+  {
+    print("Error: Failed to open %s for writing.\n", filename);
+    success &= false;
+  }
+  else
+  {
+    u64 first_event;
+    u32 n_events;
+    get_profile_events_range(profiler, &first_event, &n_events);
+
+    fprintf(file, "{\"traceEvents\": [");
+
+    b32 first_written = true;
+    for (u32 event_n = 0;
+         event_n < n_events;
+         ++event_n)
+    {
+      ProfileEvent *event = profiler->events + ((first_event + event_n) & (PROFILER_MAX_EVENTS - 1));
+
+      if (event->name != 0)
+      {
+        fprintf(file, "%s\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %lu, \"dur\": %u}",
+                first_written ? "" : ",", event->name, event->thread_id, event->start_time, event->duration);
+        first_written = false;
+      }
+    }
+
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0)
+    {
+      print("Error: Failed to write %s.\n", filename);
+      success &= false;
+    }
+    else
+    {
+      print("Exported %u profile events to %s\n", n_events, filename);
+    }
+  }
+
+  return success;
+}